@@ -0,0 +1,461 @@
+#include "audio_decoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#include "spdlog/spdlog.h"
+
+#ifdef STT_HAVE_LIBAV
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/error.h>
+#include <libavutil/log.h>
+#include <libavutil/mem.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+}
+#endif
+
+using sentiric::utils::DecodedAudio;
+
+namespace {
+constexpr int kTargetSampleRate = 16000;
+
+[[noreturn]] void throw_too_long(size_t max_samples) {
+  throw AudioTooLongException(
+      "Decoded audio exceeds " +
+      std::to_string(max_samples / kTargetSampleRate) + "s limit");
+}
+
+#ifdef STT_HAVE_LIBAV
+constexpr int kAvioBufferSize = 64 * 1024;
+
+struct MemoryInput {
+  const uint8_t* data;
+  size_t size;
+  size_t pos = 0;
+};
+
+int read_memory(void* opaque, uint8_t* buf, int buf_size) {
+  auto* in = static_cast<MemoryInput*>(opaque);
+  const size_t n =
+      std::min(static_cast<size_t>(std::max(0, buf_size)), in->size - in->pos);
+  if (n == 0) return AVERROR_EOF;
+  std::memcpy(buf, in->data + in->pos, n);
+  in->pos += n;
+  return static_cast<int>(n);
+}
+
+// M4A'da moov atomu dosya sonunda olabilir; demuxer ileri geri arar
+int64_t seek_memory(void* opaque, int64_t offset, int whence) {
+  auto* in = static_cast<MemoryInput*>(opaque);
+  if (whence & AVSEEK_SIZE) return static_cast<int64_t>(in->size);
+  int64_t target;
+  switch (whence & ~AVSEEK_FORCE) {
+    case SEEK_SET:
+      target = offset;
+      break;
+    case SEEK_CUR:
+      target = static_cast<int64_t>(in->pos) + offset;
+      break;
+    case SEEK_END:
+      target = static_cast<int64_t>(in->size) + offset;
+      break;
+    default:
+      return AVERROR(EINVAL);
+  }
+  if (target < 0 || target > static_cast<int64_t>(in->size))
+    return AVERROR(EINVAL);
+  in->pos = static_cast<size_t>(target);
+  return target;
+}
+
+std::string av_error(int code) {
+  char buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+  av_strerror(code, buf, sizeof(buf));
+  return buf;
+}
+
+// Tek çözümlemenin libav nesneleri (RAII)
+struct AvDecodeSession {
+  AVIOContext* io = nullptr;
+  AVFormatContext* format = nullptr;
+  AVCodecContext* codec = nullptr;
+  SwrContext* swr = nullptr;
+  AVPacket* packet = nullptr;
+  AVFrame* frame = nullptr;
+  size_t max_samples = 0;
+  bool too_long = false;
+
+  ~AvDecodeSession() {
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    swr_free(&swr);
+    avcodec_free_context(&codec);
+    // Özel IO'da pb kapatılmaz; tampon ve context ayrıca bırakılır
+    avformat_close_input(&format);
+    if (io) {
+      av_freep(&io->buffer);
+      avio_context_free(&io);
+    }
+  }
+};
+
+// in_samples kadar girişi (nullptr: dönüştürücüyü boşalt) 16kHz mono
+// float olarak pcm'in sonuna ekler
+bool convert(SwrContext* swr, const uint8_t** in, int in_samples,
+             std::vector<float>* pcm) {
+  const int max_out = swr_get_out_samples(swr, in_samples);
+  if (max_out <= 0) return max_out == 0;
+  const size_t offset = pcm->size();
+  pcm->resize(offset + static_cast<size_t>(max_out));
+  uint8_t* out = reinterpret_cast<uint8_t*>(pcm->data() + offset);
+  const int got = swr_convert(swr, &out, max_out, in, in_samples);
+  pcm->resize(offset + static_cast<size_t>(std::max(0, got)));
+  return got >= 0;
+}
+
+// Dönüştürücü ilk karenin gerçek biçimiyle kurulur (bazı codec'ler
+// kanal düzenini ancak çözümlemede bildirir)
+bool append_frame(AvDecodeSession& s, std::vector<float>* pcm,
+                  std::string* error) {
+  const AVFrame* frame = s.frame;
+  if (!s.swr) {
+    AVChannelLayout in_layout;
+    if (frame->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+      av_channel_layout_default(&in_layout, frame->ch_layout.nb_channels);
+    else
+      av_channel_layout_copy(&in_layout, &frame->ch_layout);
+    AVChannelLayout mono;
+    av_channel_layout_default(&mono, 1);
+    int ret = swr_alloc_set_opts2(
+        &s.swr, &mono, AV_SAMPLE_FMT_FLT, kTargetSampleRate, &in_layout,
+        static_cast<AVSampleFormat>(frame->format), frame->sample_rate, 0,
+        nullptr);
+    av_channel_layout_uninit(&in_layout);
+    // Stereo -> mono karışımında kırpılma olmasın
+    if (ret >= 0) {
+      av_opt_set_double(s.swr, "rematrix_maxval", 1.0, 0);
+      ret = swr_init(s.swr);
+    }
+    if (ret < 0) {
+      *error = "resampler init failed: " + av_error(ret);
+      return false;
+    }
+  }
+  if (!convert(s.swr, const_cast<const uint8_t**>(frame->extended_data),
+               frame->nb_samples, pcm)) {
+    *error = "resampling failed";
+    return false;
+  }
+  if (pcm->size() > s.max_samples) {
+    s.too_long = true;
+    *error = "decoded audio exceeds limit";
+    return false;
+  }
+  return true;
+}
+
+// Sihirli baytlardan bulunan biçimin demuxer'ları (format_whitelist)
+const char* demuxers_for(AudioFormat format) {
+  switch (format) {
+    case AudioFormat::kMp3:
+      return "mp3";
+    case AudioFormat::kAac:
+      return "aac";
+    case AudioFormat::kOgg:
+    case AudioFormat::kOpus:
+      return "ogg";
+    case AudioFormat::kFlac:
+      return "flac";
+    case AudioFormat::kM4a:
+      return "mov,mp4,m4a,3gp,3g2,mj2";
+    case AudioFormat::kWebm:
+      return "matroska,webm";
+    case AudioFormat::kWav:
+    case AudioFormat::kUnknown:
+      break;
+  }
+  return nullptr;
+}
+
+// Codec'te bekleyen tüm kareleri alır
+bool drain_frames(AvDecodeSession& s, std::vector<float>* pcm,
+                  std::string* error) {
+  for (;;) {
+    const int ret = avcodec_receive_frame(s.codec, s.frame);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return true;
+    if (ret < 0) {
+      *error = "decode failed: " + av_error(ret);
+      return false;
+    }
+    const bool ok = append_frame(s, pcm, error);
+    av_frame_unref(s.frame);
+    if (!ok) return false;
+  }
+}
+#endif
+}  // namespace
+
+const char* audio_format_name(AudioFormat format) {
+  switch (format) {
+    case AudioFormat::kWav:
+      return "wav";
+    case AudioFormat::kMp3:
+      return "mp3";
+    case AudioFormat::kAac:
+      return "aac";
+    case AudioFormat::kOgg:
+      return "ogg";
+    case AudioFormat::kOpus:
+      return "opus";
+    case AudioFormat::kFlac:
+      return "flac";
+    case AudioFormat::kM4a:
+      return "m4a";
+    case AudioFormat::kWebm:
+      return "webm";
+    case AudioFormat::kUnknown:
+      break;
+  }
+  return "unknown";
+}
+
+AudioFormat sniff_audio_format(const std::string& bytes) {
+  const auto* b = reinterpret_cast<const uint8_t*>(bytes.data());
+  const size_t n = bytes.size();
+  if (sentiric::utils::has_wav_header(bytes)) return AudioFormat::kWav;
+  if (n >= 4 && std::memcmp(b, "fLaC", 4) == 0) return AudioFormat::kFlac;
+  if (n >= 4 && std::memcmp(b, "OggS", 4) == 0)
+    return n >= 36 && std::memcmp(b + 28, "OpusHead", 8) == 0
+               ? AudioFormat::kOpus
+               : AudioFormat::kOgg;
+  if (n >= 8 && std::memcmp(b + 4, "ftyp", 4) == 0) return AudioFormat::kM4a;
+  if (n >= 4 && b[0] == 0x1A && b[1] == 0x45 && b[2] == 0xDF && b[3] == 0xA3)
+    return AudioFormat::kWebm;
+  if (n >= 3 && std::memcmp(b, "ID3", 3) == 0) return AudioFormat::kMp3;
+  // MPEG çerçeve eşlemesi: katman 00 ise ADTS (AAC), değilse MP3
+  if (n >= 2 && b[0] == 0xFF && (b[1] & 0xE0) == 0xE0)
+    return (b[1] & 0x06) == 0 ? AudioFormat::kAac : AudioFormat::kMp3;
+  return AudioFormat::kUnknown;
+}
+
+bool in_process_decoding_available() {
+#ifdef STT_HAVE_LIBAV
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool decode_audio_in_process(const std::string& bytes, AudioFormat format,
+                             size_t max_samples, std::vector<float>* pcm,
+                             std::string* error, bool* too_long) {
+  std::string local_error;
+  std::string& err = error ? *error : local_error;
+  pcm->clear();
+#ifndef STT_HAVE_LIBAV
+  (void)bytes;
+  (void)format;
+  (void)max_samples;
+  (void)too_long;
+  err = "built without libav";
+  return false;
+#else
+  // Yalnızca tanınan biçimler: istemci verisi tüm demuxer'lara açılmaz
+  const char* demuxers = demuxers_for(format);
+  if (!demuxers) {
+    err = std::string("no in-process demuxer for ") +
+          audio_format_name(format);
+    return false;
+  }
+  static std::once_flag log_once;
+  std::call_once(log_once, [] { av_log_set_level(AV_LOG_ERROR); });
+
+  MemoryInput input{reinterpret_cast<const uint8_t*>(bytes.data()),
+                    bytes.size()};
+  AvDecodeSession s;
+  s.max_samples = max_samples;
+  auto* buffer = static_cast<unsigned char*>(av_malloc(kAvioBufferSize));
+  if (!buffer) {
+    err = "out of memory";
+    return false;
+  }
+  s.io = avio_alloc_context(buffer, kAvioBufferSize, 0, &input, read_memory,
+                            nullptr, seek_memory);
+  s.format = avformat_alloc_context();
+  if (!s.io || !s.format) {
+    if (!s.io) av_free(buffer);
+    err = "out of memory";
+    return false;
+  }
+  s.format->pb = s.io;
+  s.format->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+  // Demuxer'lar sihirli baytların biçimiyle sınırlı; iç içe kaynak açan
+  // demuxer'lar (hls, concat...) için hiçbir protokole izin yok
+  AVDictionary* options = nullptr;
+  av_dict_set(&options, "format_whitelist", demuxers, 0);
+  av_dict_set(&options, "protocol_whitelist", "", 0);
+  // Başarısızlıkta avformat_open_input context'i kendisi bırakır
+  int ret = avformat_open_input(&s.format, nullptr, nullptr, &options);
+  av_dict_free(&options);
+  if (ret < 0) {
+    err = "unrecognized container: " + av_error(ret);
+    return false;
+  }
+  ret = avformat_find_stream_info(s.format, nullptr);
+  if (ret < 0) {
+    err = "stream info: " + av_error(ret);
+    return false;
+  }
+  const AVCodec* codec = nullptr;
+  const int stream_index =
+      av_find_best_stream(s.format, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+  if (stream_index < 0 || !codec) {
+    err = "no decodable audio stream";
+    return false;
+  }
+  const AVStream* stream = s.format->streams[stream_index];
+  s.codec = avcodec_alloc_context3(codec);
+  s.packet = av_packet_alloc();
+  s.frame = av_frame_alloc();
+  if (!s.codec || !s.packet || !s.frame) {
+    err = "out of memory";
+    return false;
+  }
+  ret = avcodec_parameters_to_context(s.codec, stream->codecpar);
+  if (ret >= 0) {
+    s.codec->pkt_timebase = stream->time_base;
+    ret = avcodec_open2(s.codec, codec, nullptr);
+  }
+  if (ret < 0) {
+    err = std::string("codec ") + codec->name + ": " + av_error(ret);
+    return false;
+  }
+
+  // Süre biliniyorsa çıktı bir kez ayrılır. Süre başlıktan (istemciden)
+  // geldiği için üst sınıra kırpılır.
+  if (s.format->duration > 0) {
+    const size_t expected =
+        static_cast<size_t>(s.format->duration / AV_TIME_BASE + 1) *
+        kTargetSampleRate;
+    pcm->reserve(std::min(expected, max_samples));
+  }
+
+  // Okuma hataları (kesik dosya) akış sonu sayılır; bozuk paketler
+  // atlanır (ffmpeg CLI davranışı)
+  bool ok = true;
+  while (ok && av_read_frame(s.format, s.packet) >= 0) {
+    if (s.packet->stream_index == stream_index) {
+      ret = avcodec_send_packet(s.codec, s.packet);
+      if (ret < 0 && ret != AVERROR_INVALIDDATA) {
+        err = "decode failed: " + av_error(ret);
+        ok = false;
+      } else {
+        ok = drain_frames(s, pcm, &err);
+      }
+    }
+    av_packet_unref(s.packet);
+  }
+  if (ok) {
+    avcodec_send_packet(s.codec, nullptr);
+    ok = drain_frames(s, pcm, &err);
+  }
+  if (ok && s.swr && !convert(s.swr, nullptr, 0, pcm)) {
+    err = "resampling failed";
+    ok = false;
+  }
+  if (ok && pcm->size() > max_samples) {
+    s.too_long = true;
+    err = "decoded audio exceeds limit";
+    ok = false;
+  }
+  if (ok && pcm->empty()) {
+    err = "no audio samples decoded";
+    ok = false;
+  }
+  if (too_long) *too_long = s.too_long;
+  if (!ok) {
+    pcm->clear();
+    pcm->shrink_to_fit();
+  }
+  return ok;
+#endif
+}
+
+DecodedAudio decode_audio(
+    const std::string& bytes, size_t max_samples,
+    prometheus::Family<prometheus::Histogram>* decode_seconds) {
+  const auto t_start = std::chrono::steady_clock::now();
+  const AudioFormat format = sniff_audio_format(bytes);
+  const char* decoder = "wav";
+  DecodedAudio result;
+
+  if (format == AudioFormat::kWav) {
+    result = sentiric::utils::parse_wav_robust(bytes);
+    // Sınır 16kHz örnek cinsinden; WAV kendi örnekleme hızındadır.
+    // parse_wav_robust çok kanallıyı çerçeve başına tek örneğe indirir
+    const double seconds = static_cast<double>(result.num_samples()) /
+                           std::max(1, result.sample_rate);
+    if (seconds * kTargetSampleRate > static_cast<double>(max_samples))
+      throw_too_long(max_samples);
+  } else {
+    std::string error;
+    bool too_long = false;
+    if (decode_audio_in_process(bytes, format, max_samples, &result.pcm_f32,
+                                &error, &too_long)) {
+      decoder = "libav";
+      result.sample_rate = kTargetSampleRate;
+      result.channels = 1;
+      result.is_valid = true;
+    } else if (in_process_decoding_available() &&
+               format != AudioFormat::kUnknown) {
+      spdlog::warn("In-process decode failed ({}): {}",
+                   audio_format_name(format), error);
+    }
+    // Sınırı aşan veri başka çözücüye verilmez
+    if (too_long) throw_too_long(max_samples);
+    // ffmpeg CLI aynı demuxer'ları kullanır: tanınmayan veride yalnızca
+    // süreç içi çözücü yoksa denenir
+    if (!result.is_valid && (format != AudioFormat::kUnknown ||
+                             !in_process_decoding_available())) {
+      spdlog::info("Attempting FFmpeg conversion ({})...",
+                   audio_format_name(format));
+      result.pcm_data =
+          sentiric::utils::decode_with_ffmpeg(bytes, max_samples, &too_long);
+      if (too_long) throw_too_long(max_samples);
+      if (!result.pcm_data.empty()) {
+        decoder = "ffmpeg";
+        result.sample_rate = kTargetSampleRate;
+        result.channels = 1;
+        result.is_valid = true;
+      }
+    }
+    if (!result.is_valid) {
+      spdlog::warn("No decoder accepted the data. Falling back to Raw PCM "
+                   "assumption.");
+      decoder = "raw";
+      // 16kHz mono 16-bit varsayımı: kopyalamadan önce sınır kontrolü
+      if (bytes.size() / 2 > max_samples) throw_too_long(max_samples);
+      result = sentiric::utils::raw_pcm16_audio(bytes);
+    }
+  }
+
+  if (decode_seconds) {
+    static const prometheus::Histogram::BucketBoundaries buckets{
+        0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0};
+    decode_seconds
+        ->Add({{"format", audio_format_name(format)}, {"decoder", decoder}},
+              buckets)
+        .Observe(std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - t_start)
+                     .count());
+  }
+  return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <prometheus/family.h>
+#include <prometheus/histogram.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+// Yüklenen sesin biçimi (sihirli baytlardan; metrik etiketi ve yedek
+// seçimi için)
+enum class AudioFormat {
+  kUnknown,
+  kWav,
+  kMp3,
+  kAac,
+  kOgg,
+  kOpus,
+  kFlac,
+  kM4a,
+  kWebm,
+};
+
+const char* audio_format_name(AudioFormat format);
+AudioFormat sniff_audio_format(const std::string& bytes);
+
+// libav* ile derlendiyse (STT_HAVE_LIBAV) true
+bool in_process_decoding_available();
+
+// Çözülmüş ses max_samples'ı aştı (sıkıştırma bombası / aşırı uzun yükleme)
+class AudioTooLongException : public std::runtime_error {
+ public:
+  AudioTooLongException(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+// [YENİ]: Bellekteki sıkıştırılmış sesi (MP3, OGG/Opus, FLAC, M4A, WebM...)
+// süreç içinde libav* ile doğrudan 16kHz mono float'a çözer; geçici dosya
+// ve süreç başlatma yoktur. Yalnızca format'a (sihirli baytlar) ait
+// demuxer'lar açılır, hiçbir protokol açılmaz. Çıktı max_samples'ı aşarsa
+// çözme durur ve *too_long işaretlenir. Başarısızsa false döner, *error
+// nedeni içerir.
+bool decode_audio_in_process(const std::string& bytes, AudioFormat format,
+                             size_t max_samples, std::vector<float>* pcm,
+                             std::string* error = nullptr,
+                             bool* too_long = nullptr);
+
+// [YENİ]: Sunucuların ses girişi. WAV doğrudan ayrıştırılır, diğer biçimler
+// süreç içinde çözülür; ffmpeg CLI yalnızca son çaredir. Hiçbiri olmazsa
+// ham 16-bit PCM varsayılır. Çözülmüş ses max_samples'ı aşarsa
+// AudioTooLongException fırlatılır. decode_seconds verilirse süre {format,
+// decoder: wav | libav | ffmpeg | raw} etiketleriyle gözlemlenir.
+sentiric::utils::DecodedAudio decode_audio(
+    const std::string& bytes, size_t max_samples,
+    prometheus::Family<prometheus::Histogram>* decode_seconds = nullptr);
@@ -0,0 +1,197 @@
+// audio_ctx kovalarının gecikme / doğruluk dengesini ölçen benchmark.
+//
+// Kullanım: stt_bench_audio_ctx <manifest.tsv> [language] [runs]
+// Manifest: her satırda "<wav_yolu>\t<referans metin>". Her klip tam pencere
+// (1500) ve klibe sığan her kova ile çözülür; kova başına ortalama/p95
+// gecikme, kelime hata oranı (WER) ve aynı kliplerde tam pencerenin WER'i
+// yazdırılır.
+// Model ve kovalar normal servis ortam değişkenlerinden okunur
+// (STT_WHISPER_SERVICE_MODEL_DIR, ..._AUDIO_CTX_BUCKETS vb.).
+
+#include <algorithm>
+#include <cctype>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "spdlog/spdlog.h"
+#include "stt_engine.h"
+#include "utils.h"
+
+namespace {
+
+struct Clip {
+  std::string path;
+  std::string reference;
+  std::vector<int16_t> pcm;
+  int sample_rate = 16000;
+};
+
+struct BucketStats {
+  std::vector<double> latencies_ms;
+  size_t word_errors = 0;
+  size_t full_word_errors = 0;  // Aynı kliplerde tam pencere hatası
+  size_t ref_words = 0;
+  size_t clips = 0;
+};
+
+// Küçük harf + noktalama temizliği. ASCII dışı baytlar (Türkçe harfler)
+// olduğu gibi korunur; kıyas iki tarafta aynı normalizasyonla yapılır.
+std::vector<std::string> normalize_words(const std::string& text) {
+  std::string clean;
+  clean.reserve(text.size());
+  for (unsigned char c : text) {
+    if (c >= 0x80 || std::isalnum(c))
+      clean.push_back(static_cast<char>(c < 0x80 ? std::tolower(c) : c));
+    else
+      clean.push_back(' ');
+  }
+  std::vector<std::string> words;
+  std::stringstream ss(clean);
+  std::string word;
+  while (ss >> word) words.push_back(word);
+  return words;
+}
+
+size_t edit_distance(const std::vector<std::string>& a,
+                     const std::vector<std::string>& b) {
+  std::vector<size_t> prev(b.size() + 1), cur(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); ++j) prev[j] = j;
+  for (size_t i = 1; i <= a.size(); ++i) {
+    cur[0] = i;
+    for (size_t j = 1; j <= b.size(); ++j) {
+      size_t sub = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+      cur[j] = std::min({prev[j] + 1, cur[j - 1] + 1, sub});
+    }
+    std::swap(prev, cur);
+  }
+  return prev[b.size()];
+}
+
+double percentile(std::vector<double> values, double p) {
+  if (values.empty()) return 0.0;
+  std::sort(values.begin(), values.end());
+  size_t idx = static_cast<size_t>(p * (values.size() - 1));
+  return values[idx];
+}
+
+std::vector<Clip> load_manifest(const std::string& path) {
+  std::vector<Clip> clips;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t tab = line.find('\t');
+    if (line.empty() || line[0] == '#' || tab == std::string::npos) continue;
+
+    Clip clip;
+    clip.path = line.substr(0, tab);
+    clip.reference = line.substr(tab + 1);
+
+    std::ifstream wav(clip.path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(wav)),
+                      std::istreambuf_iterator<char>());
+    sentiric::utils::DecodedAudio audio;
+    try {
+      audio = sentiric::utils::parse_wav_robust(bytes);
+    } catch (const std::exception& e) {
+      spdlog::warn("Skipping {}: {}", clip.path, e.what());
+      continue;
+    }
+    if (!audio.is_valid || audio.pcm_data.empty()) continue;
+    clip.pcm = std::move(audio.pcm_data);
+    clip.sample_rate = audio.sample_rate;
+    clips.push_back(std::move(clip));
+  }
+  return clips;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: stt_bench_audio_ctx <manifest.tsv> [language] [runs]"
+              << std::endl;
+    return 1;
+  }
+
+  Settings settings = load_settings();
+  settings.adaptive_audio_ctx = true;
+  // Ölçümü bozmamak için diğer paylaşım yolları kapalı
+  settings.coalesce_requests = false;
+  settings.long_audio_chunking = false;
+  settings.parallel_requests = 1;
+  if (argc > 2) settings.language = argv[2];
+  const int runs = (argc > 3) ? std::max(1, std::atoi(argv[3])) : 3;
+
+  std::vector<Clip> clips = load_manifest(argv[1]);
+  if (clips.empty()) {
+    spdlog::error("No usable clips in manifest: {}", argv[1]);
+    return 1;
+  }
+
+  SttEngine engine(settings);
+  std::vector<int> buckets = engine.audio_ctx_buckets();
+  buckets.insert(buckets.begin(), 0);  // 0 = tam pencere (referans)
+
+  std::map<int, BucketStats> stats;
+  for (const auto& clip : clips) {
+    const size_t n_16k = clip.pcm.size() * 16000 / clip.sample_rate;
+    const int auto_bucket = engine.select_audio_ctx(n_16k);
+    const std::vector<std::string> ref = normalize_words(clip.reference);
+    size_t full_errors = 0;  // buckets[0] = tam pencere, ilk çözülür
+
+    for (int bucket : buckets) {
+      // Klibe sığmayan kovalar otomatik modda hiç seçilmez
+      if (bucket != 0 && (auto_bucket == 0 || bucket < auto_bucket)) continue;
+
+      RequestOptions opts;
+      opts.audio_ctx = bucket;
+      BucketStats& st = stats[bucket];
+      std::string hyp_text;
+
+      // İlk koşu ısınma, ölçüme katılmaz
+      for (int r = 0; r <= runs; ++r) {
+        SttEngine::PerformanceMetrics perf{0, 0, 0};
+        auto results =
+            engine.transcribe_pcm16(clip.pcm, clip.sample_rate, opts, &perf);
+        if (r == 0) {
+          for (const auto& res : results) hyp_text += res.text;
+          continue;
+        }
+        st.latencies_ms.push_back(perf.processing_time_ms);
+      }
+
+      size_t errors = edit_distance(ref, normalize_words(hyp_text));
+      if (bucket == 0) full_errors = errors;
+      st.word_errors += errors;
+      st.full_word_errors += full_errors;
+      st.ref_words += ref.size();
+      ++st.clips;
+    }
+  }
+
+  std::cout << "language=" << settings.language << " clips=" << clips.size()
+            << " runs=" << runs << "\n";
+  std::cout << "bucket\tmax_s\tclips\tmean_ms\tp95_ms\tWER\tWER_full\n";
+  for (int bucket : buckets) {
+    const BucketStats& st = stats[bucket];
+    if (st.clips == 0) continue;
+    double mean = 0.0;
+    for (double v : st.latencies_ms) mean += v;
+    mean /= st.latencies_ms.size();
+    double wer = st.ref_words ? 100.0 * st.word_errors / st.ref_words : 0.0;
+    double wer_full =
+        st.ref_words ? 100.0 * st.full_word_errors / st.ref_words : 0.0;
+    std::cout << (bucket == 0 ? std::string("full") : std::to_string(bucket))
+              << "\t" << (bucket == 0 ? 30.0 : bucket * 0.02) << "\t"
+              << st.clips << "\t" << mean << "\t"
+              << percentile(st.latencies_ms, 0.95) << "\t" << wer << "%\t"
+              << wer_full << "%\n";
+  }
+  return 0;
+}
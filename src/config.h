@@ -20,6 +20,18 @@ struct Settings {
       "https://huggingface.co/ggerganov/whisper.cpp/resolve/main/"
       "ggml-{model_name}.bin";
   int model_load_timeout = 600;
+  // [YENİ]: Stream partial'ları için isteğe bağlı küçük model ve ayrı state
+  // havuzu (boş = kapalı). Finaller ve tekil istekler ana modelde kalır;
+  // artımlı stream'lerde final, cümlenin tamamını ana modelde yeniden çözer.
+  std::string fast_model_filename = "";
+  int fast_parallel_requests = 1;
+
+  // [YENİ]: /admin/model (hot swap) uç noktası için x-admin-token.
+  // Boşsa admin uç noktaları kapalıdır; SIGHUP her zaman çalışır.
+  std::string admin_token = "";
+  // SIGHUP'ta okunan dosya: ilk satır geçilecek model dosya adı.
+  // Varsayılan <model_dir>/active_model.
+  std::string model_swap_file = "";
 
   // --- VAD Settings (HARDENED DEFAULTS) ---
   std::string vad_model_filename = "ggml-silero-vad.bin";
@@ -36,10 +48,111 @@ struct Settings {
   // GÜNCELLEME: En az yarım saniye konuşma gerekli (Click/Pop seslerini eler)
   int vad_ms_min_duration = 500;
 
+  // [YENİ]: VAD context havuzu (whisper_state havuzundan bağımsız).
+  // Her context tek thread ile çalışır; sessizlik trafiği çekirdeklere yayılır.
+  // gRPC stream'lerinin ses işleme (ingest) havuzu da bu boyuttadır.
+  int vad_pool_size =
+      std::max(1, (int)std::thread::hardware_concurrency() / 2);
+  // Havuz doluysa bu süre sonunda VAD atlanır ve ses konuşma kabul edilir
+  int vad_queue_timeout_ms = 200;
+
+  // [YENİ]: VAD konuşma aralıkları dışındaki sessizliği decode öncesi kırp.
+  // Zaman damgaları orijinal sese geri eşlenir.
+  bool vad_trim_silence = false;
+  int vad_trim_pad_ms = 200;          // Her konuşma aralığına eklenen pay
+  int vad_trim_min_silence_ms = 500;  // Bundan kısa sessizlikler korunur
+
   // --- Performance & Batching ---
   int n_threads = std::min(4, (int)std::thread::hardware_concurrency());
   int parallel_requests = 2;
   int request_queue_timeout_ms = 5000;
+  // [YENİ]: gRPC decode iş havuzunun üst sınırı. Havuz state sayısıyla
+  // başlar, işler state kuyruğunda beklerken bu sınıra kadar büyür.
+  int executor_max_threads = 64;
+
+  // [YENİ]: Esnek state havuzu. parallel_requests başlangıç (ve en az)
+  // boyuttur; bekleyen varken state_pool_max'a kadar büyür, sonradan açılan
+  // state'ler state_pool_idle_ms boşta kalınca kapatılır. Üst sınır ayrıca
+  // cgroup bellek sınırının memory_fraction'ına sığacak state sayısıyla
+  // kısılır. state_bytes > 0 ölçülen state ayak izinin yerine kullanılır.
+  bool elastic_state_pool = false;
+  int state_pool_max = 8;
+  int state_pool_idle_ms = 60000;
+  float state_pool_memory_fraction = 0.85f;
+  long long state_bytes = 0;
+  // [YENİ]: Her state'e n_threads çekirdekten oluşan ayrık bir küme atanır;
+  // decode eden thread o state'i tuttuğu sürece bu çekirdeklere bağlanır.
+  // Toplam ihtiyaç CPU sayısını aşarsa kümeler sarar (uyarı loglanır).
+  // Elastik havuzda sonradan açılan state'ler bağlanmaz.
+  // ggml'in kendi thread havuzunu gerektirir (-DGGML_OPENMP=OFF); OpenMP'li
+  // derlemede başlangıçta hata loglanır ve bağlama yapılmaz.
+  bool state_cpu_affinity = false;
+
+  // [YENİ]: State havuzu öncelik sınıfları ve sınıf başına bekleme süresi.
+  // Unary varsayılanı request_queue_timeout_ms'dir.
+  int state_timeout_final_ms = 5000;
+  int state_timeout_partial_ms = 300;
+  int state_timeout_unary_ms = 5000;
+  int state_timeout_batch_ms = 60000;
+  int batch_priority_min_s = 60;    // Daha uzun tekil istekler batch sınıfında
+  bool state_drop_partials = true;  // Final beklerken partial'ları düşür
+
+  // [YENİ]: Yük uyarlamalı decode. Kuyruk derinliği veya son state bekleme
+  // ortalaması eşiği aşınca seviye 1: beam -> greedy, daha az sıcaklık
+  // fallback'i; seviye 2: fallback ve token zaman damgaları kapalı (artımlı
+  // stream decoder'ı hariç). Kuyruk low'a ve bekleme high/2'ye inince
+  // ayarlar geri gelir.
+  bool adaptive_decoding = false;
+  int degrade_queue_high = 2;
+  int degrade_queue_critical = 6;
+  int degrade_queue_low = 0;
+  int degrade_wait_high_ms = 300;
+  int degrade_wait_critical_ms = 1500;
+
+  // [YENİ]: Başlangıçta (ve hot swap'ta) her whisper_state ve VAD bağlamı
+  // sentetik sesle bir kez çalıştırılır; graph tahsisi, ilk dokunuş sayfa
+  // hataları ve soğuk önbellek ilk gerçek isteğe kalmaz. Bitene kadar servis
+  // hazır değildir (/health 503, gRPC health NOT_SERVING).
+  bool warmup_enabled = false;
+  int warmup_audio_ms = 2000;
+
+  // [YENİ]: State alındıktan sonra en uzun decode süresi (ms, 0 = sınırsız).
+  // Aşılırsa decode durdurulur, tamamlanan pencereler döner.
+  int max_decode_ms = 0;
+
+  // [YENİ]: Tenant kotaları: "tenant=eşzamanlı,hız,burst,ağırlık;..."
+  // (hız/burst ses saniyesi, "*" listede olmayan her tenant'ın varsayılan
+  // kotası, 0 sınırsız). Boş = kapalı.
+  std::string tenant_limits = "";
+  // Bellekte tutulan tenant durumu üst sınırı; dolunca en eski boştaki atılır
+  int tenant_max_tracked = 10000;
+
+  // [YENİ]: Sıkıştırılmış yüklemelerin çözülmüş ses süresi üst sınırı (sn).
+  // Küçük bir dosya çok uzun sese açılabilir; sınırı aşan istek reddedilir.
+  int max_audio_duration_s = 3600;
+
+  // [YENİ]: Uzun sesleri sessizlik sınırlarından ~30sn'lik parçalara bölüp
+  // boştaki whisper_state'lere paralel dağıt.
+  bool long_audio_chunking = false;
+  int long_audio_min_s = 60;    // Bu süreden uzun sesler parçalanır
+  int long_audio_chunk_s = 28;  // Hedef parça üst sınırı (Whisper penceresi)
+  // Parçaları çözen paylaşılan havuzun thread üst sınırı (tüm istekler)
+  int long_audio_max_threads = 8;
+
+  // [YENİ]: Kısa istekleri birleştirme (coalescing). Birkaç ms içinde gelen
+  // uyumlu kısa sesler sessizlik araları ile tek 30sn pencereye paketlenir ve
+  // tek encoder geçişiyle çözülür. Başka istek yokken pencere beklemez.
+  bool coalesce_requests = false;
+  int coalesce_max_wait_ms = 20;         // İsteğe eklenen en fazla gecikme
+  int coalesce_max_utterance_ms = 5000;  // Daha uzun sesler tek başına çözülür
+  int coalesce_gap_ms = 500;             // Sesler arasına konan sessizlik
+  int coalesce_max_batch = 8;
+
+  // [YENİ]: Kısa seslerde encoder bağlamını (audio_ctx) klibin süresine göre
+  // küçült. 1500 = 30sn; değer, state tamponları sabit kalsın diye listedeki
+  // en küçük uygun kovaya yuvarlanır. Hiçbiri yetmezse tam pencere kullanılır.
+  bool adaptive_audio_ctx = false;
+  std::string audio_ctx_buckets = "256,512,768,1024";
 
   std::string device = "auto";
   std::string compute_type = "int8";
@@ -53,6 +166,23 @@ struct Settings {
   float temperature = 0.0f;
   int best_of = 5;
 
+  // [YENİ]: Güven kapılı decode. beam_size > 1 iken önce greedy çözülür;
+  // yalnızca ortalama token olasılığı düşük ya da token entropisi düşük
+  // (tekrar döngüsü) segmentler aynı state'teki mel ile beam'le yeniden
+  // çözülür. Entropi kontrolü en az 16 token'lı segmentlere uygulanır.
+  bool confidence_gated_beam = false;
+  float gate_min_avg_prob = 0.70f;
+  float gate_min_entropy = 2.0f;
+
+  // [YENİ]: Kaçak decode koruyucusu. Ses saniyesi başına token bütçesi
+  // aşılınca decode durdurulur (tamamlanan pencereler kalır); en fazla
+  // loop_max_ngram uzunluktaki bir n-gram loop_min_tokens'ı dolduracak
+  // kadar tekrar ederse segment eot ile kesilir.
+  bool decode_guard = false;
+  float decode_max_tokens_per_s = 15.0f;
+  int decode_loop_max_ngram = 8;
+  int decode_loop_min_tokens = 12;
+
   // GÜNCELLEME: Halüsinasyonları engellemek için agresif varsayılanlar
   // Logprob ne kadar yüksekse (sıfıra yakın), model o kadar emin demektir.
   // -1.0 çok gevşekti, -0.7 yaparak "Emin değilsen sus" diyoruz.
@@ -75,6 +205,24 @@ struct Settings {
   // [YENİ]: Dinamik Stream Buffer Boyutu
   int stream_buffer_samples = 8000;  // Varsayılan 500ms (16000 * 0.5)
 
+  // [YENİ]: Artımlı (LocalAgreement) stream decoder. Kapalıyken her partial'da
+  // tüm tampon yeniden decode edilir (eski davranış). Açıkken is_final yine
+  // yalnızca cümle sonudur; partial'lar cümlenin tamamını, words alanında
+  // ise o adımda kesinleşen (artık değişmeyecek) kelimeleri taşır.
+  bool stream_incremental = false;
+  // Kesinleşmemiş ses penceresinin üst sınırı (partial maliyetini sınırlar)
+  int stream_max_window_ms = 10000;
+  // Kesinleşmiş metnin prompt olarak verilecek son kısmı (karakter)
+  int stream_prompt_max_chars = 200;
+
+  // [YENİ]: Sunucu taraflı söz sonu (endpoint) tespiti. Silero olasılıkları
+  // ile sondaki sessizlik süresi izlenir, eşik aşılınca is_final gönderilir.
+  // enable_vad=true gerektirir.
+  bool stream_vad_endpointing = false;
+  float stream_endpoint_threshold = 0.5f;  // Çerçeve konuşma olasılığı eşiği
+  int stream_endpoint_silence_ms = 700;    // Final için gereken sessizlik
+  int stream_endpoint_min_speech_ms = 250;  // Final öncesi en az konuşma
+
   std::string log_level = "info";
   std::string grpc_ca_path = "";
   std::string grpc_cert_path = "";
@@ -113,6 +261,15 @@ inline Settings load_settings() {
   s.model_filename =
       get_env("STT_WHISPER_SERVICE_MODEL_FILENAME", "ggml-" + size + ".bin");
 
+  std::string fast_size = get_env("STT_WHISPER_SERVICE_FAST_MODEL_SIZE", "");
+  s.fast_model_filename =
+      get_env("STT_WHISPER_SERVICE_FAST_MODEL_FILENAME",
+              fast_size.empty() ? "" : "ggml-" + fast_size + ".bin");
+  s.fast_parallel_requests = get_int(
+      "STT_WHISPER_SERVICE_FAST_PARALLEL_REQUESTS", s.fast_parallel_requests);
+  s.admin_token = get_env("STT_WHISPER_SERVICE_ADMIN_TOKEN", s.admin_token);
+  s.model_swap_file = get_env("STT_WHISPER_SERVICE_MODEL_SWAP_FILE",
+                              s.model_dir + "/active_model");
   s.vad_model_filename =
       get_env("STT_WHISPER_SERVICE_VAD_MODEL", s.vad_model_filename);
   s.vad_model_url = get_env("STT_WHISPER_SERVICE_VAD_URL", s.vad_model_url);
@@ -123,6 +280,16 @@ inline Settings load_settings() {
       get_float("STT_WHISPER_SERVICE_VAD_THRESHOLD", s.vad_threshold);
   s.vad_ms_min_duration =
       get_int("STT_WHISPER_SERVICE_VAD_MS_MIN_DURATION", s.vad_ms_min_duration);
+  s.vad_pool_size =
+      get_int("STT_WHISPER_SERVICE_VAD_POOL_SIZE", s.vad_pool_size);
+  s.vad_queue_timeout_ms = get_int("STT_WHISPER_SERVICE_VAD_QUEUE_TIMEOUT_MS",
+                                   s.vad_queue_timeout_ms);
+  s.vad_trim_silence =
+      get_bool("STT_WHISPER_SERVICE_VAD_TRIM_SILENCE", s.vad_trim_silence);
+  s.vad_trim_pad_ms =
+      get_int("STT_WHISPER_SERVICE_VAD_TRIM_PAD_MS", s.vad_trim_pad_ms);
+  s.vad_trim_min_silence_ms = get_int(
+      "STT_WHISPER_SERVICE_VAD_TRIM_MIN_SILENCE_MS", s.vad_trim_min_silence_ms);
 
   s.flash_attn = get_bool("STT_WHISPER_SERVICE_FLASH_ATTN", s.flash_attn);
   s.suppress_nst = get_bool("STT_WHISPER_SERVICE_SUPPRESS_NST", s.suppress_nst);
@@ -137,6 +304,83 @@ inline Settings load_settings() {
       get_int("STT_WHISPER_SERVICE_PARALLEL_REQUESTS", s.parallel_requests);
   s.request_queue_timeout_ms = get_int("STT_WHISPER_SERVICE_QUEUE_TIMEOUT_MS",
                                        s.request_queue_timeout_ms);
+  s.executor_max_threads = get_int("STT_WHISPER_SERVICE_EXECUTOR_MAX_THREADS",
+                                   s.executor_max_threads);
+  s.state_timeout_final_ms = get_int(
+      "STT_WHISPER_SERVICE_STATE_TIMEOUT_FINAL_MS", s.state_timeout_final_ms);
+  s.state_timeout_partial_ms =
+      get_int("STT_WHISPER_SERVICE_STATE_TIMEOUT_PARTIAL_MS",
+              s.state_timeout_partial_ms);
+  s.state_timeout_unary_ms = get_int(
+      "STT_WHISPER_SERVICE_STATE_TIMEOUT_UNARY_MS", s.request_queue_timeout_ms);
+  s.state_timeout_batch_ms = get_int(
+      "STT_WHISPER_SERVICE_STATE_TIMEOUT_BATCH_MS", s.state_timeout_batch_ms);
+  s.batch_priority_min_s = get_int("STT_WHISPER_SERVICE_BATCH_PRIORITY_MIN_S",
+                                   s.batch_priority_min_s);
+  s.state_drop_partials = get_bool("STT_WHISPER_SERVICE_STATE_DROP_PARTIALS",
+                                   s.state_drop_partials);
+  s.elastic_state_pool = get_bool("STT_WHISPER_SERVICE_ELASTIC_STATE_POOL",
+                                  s.elastic_state_pool);
+  s.state_pool_max =
+      get_int("STT_WHISPER_SERVICE_STATE_POOL_MAX", s.state_pool_max);
+  s.state_pool_idle_ms =
+      get_int("STT_WHISPER_SERVICE_STATE_POOL_IDLE_MS", s.state_pool_idle_ms);
+  s.state_pool_memory_fraction =
+      get_float("STT_WHISPER_SERVICE_STATE_POOL_MEMORY_FRACTION",
+                s.state_pool_memory_fraction);
+  s.state_bytes = std::atoll(
+      get_env("STT_WHISPER_SERVICE_STATE_BYTES", std::to_string(s.state_bytes))
+          .c_str());
+  s.state_cpu_affinity = get_bool("STT_WHISPER_SERVICE_STATE_CPU_AFFINITY",
+                                  s.state_cpu_affinity);
+  s.adaptive_decoding = get_bool("STT_WHISPER_SERVICE_ADAPTIVE_DECODING",
+                                 s.adaptive_decoding);
+  s.degrade_queue_high = get_int("STT_WHISPER_SERVICE_DEGRADE_QUEUE_HIGH",
+                                 s.degrade_queue_high);
+  s.degrade_queue_critical = get_int(
+      "STT_WHISPER_SERVICE_DEGRADE_QUEUE_CRITICAL", s.degrade_queue_critical);
+  s.degrade_queue_low =
+      get_int("STT_WHISPER_SERVICE_DEGRADE_QUEUE_LOW", s.degrade_queue_low);
+  s.degrade_wait_high_ms = get_int("STT_WHISPER_SERVICE_DEGRADE_WAIT_HIGH_MS",
+                                   s.degrade_wait_high_ms);
+  s.degrade_wait_critical_ms =
+      get_int("STT_WHISPER_SERVICE_DEGRADE_WAIT_CRITICAL_MS",
+              s.degrade_wait_critical_ms);
+  s.warmup_enabled =
+      get_bool("STT_WHISPER_SERVICE_WARMUP_ENABLED", s.warmup_enabled);
+  s.warmup_audio_ms =
+      get_int("STT_WHISPER_SERVICE_WARMUP_AUDIO_MS", s.warmup_audio_ms);
+  s.max_decode_ms =
+      get_int("STT_WHISPER_SERVICE_MAX_DECODE_MS", s.max_decode_ms);
+  s.tenant_limits =
+      get_env("STT_WHISPER_SERVICE_TENANT_LIMITS", s.tenant_limits);
+  s.tenant_max_tracked = get_int("STT_WHISPER_SERVICE_TENANT_MAX_TRACKED",
+                                 s.tenant_max_tracked);
+  s.max_audio_duration_s = get_int("STT_WHISPER_SERVICE_MAX_AUDIO_DURATION_S",
+                                   s.max_audio_duration_s);
+  s.long_audio_chunking = get_bool("STT_WHISPER_SERVICE_LONG_AUDIO_CHUNKING",
+                                   s.long_audio_chunking);
+  s.long_audio_min_s =
+      get_int("STT_WHISPER_SERVICE_LONG_AUDIO_MIN_S", s.long_audio_min_s);
+  s.long_audio_chunk_s =
+      get_int("STT_WHISPER_SERVICE_LONG_AUDIO_CHUNK_S", s.long_audio_chunk_s);
+  s.long_audio_max_threads = get_int(
+      "STT_WHISPER_SERVICE_LONG_AUDIO_MAX_THREADS", s.long_audio_max_threads);
+  s.coalesce_requests =
+      get_bool("STT_WHISPER_SERVICE_COALESCE_REQUESTS", s.coalesce_requests);
+  s.coalesce_max_wait_ms = get_int("STT_WHISPER_SERVICE_COALESCE_MAX_WAIT_MS",
+                                   s.coalesce_max_wait_ms);
+  s.coalesce_max_utterance_ms =
+      get_int("STT_WHISPER_SERVICE_COALESCE_MAX_UTTERANCE_MS",
+              s.coalesce_max_utterance_ms);
+  s.coalesce_gap_ms =
+      get_int("STT_WHISPER_SERVICE_COALESCE_GAP_MS", s.coalesce_gap_ms);
+  s.coalesce_max_batch =
+      get_int("STT_WHISPER_SERVICE_COALESCE_MAX_BATCH", s.coalesce_max_batch);
+  s.adaptive_audio_ctx =
+      get_bool("STT_WHISPER_SERVICE_ADAPTIVE_AUDIO_CTX", s.adaptive_audio_ctx);
+  s.audio_ctx_buckets =
+      get_env("STT_WHISPER_SERVICE_AUDIO_CTX_BUCKETS", s.audio_ctx_buckets);
 
   s.language = get_env("STT_WHISPER_SERVICE_LANGUAGE", s.language);
   s.translate = get_bool("STT_WHISPER_SERVICE_TRANSLATE", s.translate);
@@ -144,6 +388,22 @@ inline Settings load_settings() {
   s.beam_size = get_int("STT_WHISPER_SERVICE_BEAM_SIZE", s.beam_size);
   s.temperature = get_float("STT_WHISPER_SERVICE_TEMPERATURE", s.temperature);
   s.best_of = get_int("STT_WHISPER_SERVICE_BEST_OF", s.best_of);
+  s.confidence_gated_beam = get_bool(
+      "STT_WHISPER_SERVICE_CONFIDENCE_GATED_BEAM", s.confidence_gated_beam);
+  s.gate_min_avg_prob = get_float("STT_WHISPER_SERVICE_GATE_MIN_AVG_PROB",
+                                  s.gate_min_avg_prob);
+  s.gate_min_entropy =
+      get_float("STT_WHISPER_SERVICE_GATE_MIN_ENTROPY", s.gate_min_entropy);
+
+  s.decode_guard =
+      get_bool("STT_WHISPER_SERVICE_DECODE_GUARD", s.decode_guard);
+  s.decode_max_tokens_per_s =
+      get_float("STT_WHISPER_SERVICE_DECODE_MAX_TOKENS_PER_S",
+                s.decode_max_tokens_per_s);
+  s.decode_loop_max_ngram = get_int(
+      "STT_WHISPER_SERVICE_DECODE_LOOP_MAX_NGRAM", s.decode_loop_max_ngram);
+  s.decode_loop_min_tokens = get_int(
+      "STT_WHISPER_SERVICE_DECODE_LOOP_MIN_TOKENS", s.decode_loop_min_tokens);
 
   // Bu kısım UI da api lerde yada grpc de bir parametre olarak kullanıyormu?
   s.logprob_threshold =
@@ -162,6 +422,23 @@ inline Settings load_settings() {
   // [YENİ]: Çevresel değişkenden oku
   s.stream_buffer_samples = get_int("STT_WHISPER_SERVICE_STREAM_BUFFER_SAMPLES",
                                     s.stream_buffer_samples);
+  s.stream_incremental =
+      get_bool("STT_WHISPER_SERVICE_STREAM_INCREMENTAL", s.stream_incremental);
+  s.stream_max_window_ms = get_int("STT_WHISPER_SERVICE_STREAM_MAX_WINDOW_MS",
+                                   s.stream_max_window_ms);
+  s.stream_prompt_max_chars = get_int(
+      "STT_WHISPER_SERVICE_STREAM_PROMPT_MAX_CHARS", s.stream_prompt_max_chars);
+  s.stream_vad_endpointing = get_bool(
+      "STT_WHISPER_SERVICE_STREAM_VAD_ENDPOINTING", s.stream_vad_endpointing);
+  s.stream_endpoint_threshold =
+      get_float("STT_WHISPER_SERVICE_STREAM_ENDPOINT_THRESHOLD",
+                s.stream_endpoint_threshold);
+  s.stream_endpoint_silence_ms =
+      get_int("STT_WHISPER_SERVICE_STREAM_ENDPOINT_SILENCE_MS",
+              s.stream_endpoint_silence_ms);
+  s.stream_endpoint_min_speech_ms =
+      get_int("STT_WHISPER_SERVICE_STREAM_ENDPOINT_MIN_SPEECH_MS",
+              s.stream_endpoint_min_speech_ms);
 
   s.log_level = get_env("STT_WHISPER_SERVICE_LOG_LEVEL", s.log_level);
   s.grpc_ca_path = get_env("GRPC_TLS_CA_PATH", s.grpc_ca_path);
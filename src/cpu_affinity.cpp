@@ -0,0 +1,43 @@
+#include "cpu_affinity.h"
+
+#include <pthread.h>
+
+std::vector<int> usable_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+  return cpus;
+}
+
+std::vector<std::vector<int>> plan_core_sets(const std::vector<int>& cpus,
+                                             size_t n_sets, int n_threads,
+                                             bool* overlapping) {
+  std::vector<std::vector<int>> sets(n_sets);
+  const size_t per_set = static_cast<size_t>(n_threads > 0 ? n_threads : 1);
+  if (overlapping) *overlapping = n_sets * per_set > cpus.size();
+  if (cpus.empty()) return sets;
+  for (size_t i = 0; i < n_sets; ++i)
+    for (size_t k = 0; k < per_set; ++k)
+      sets[i].push_back(cpus[(i * per_set + k) % cpus.size()]);
+  return sets;
+}
+
+ScopedAffinity::~ScopedAffinity() {
+  if (bound_)
+    pthread_setaffinity_np(pthread_self(), sizeof(previous_), &previous_);
+}
+
+bool ScopedAffinity::bind(const std::vector<int>& cpus) {
+  if (bound_ || cpus.empty()) return false;
+  if (pthread_getaffinity_np(pthread_self(), sizeof(previous_), &previous_) !=
+      0)
+    return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) CPU_SET(cpu, &set);
+  bound_ = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+  return bound_;
+}
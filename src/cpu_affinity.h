@@ -0,0 +1,32 @@
+#pragma once
+#include <sched.h>
+
+#include <cstddef>
+#include <vector>
+
+// Sürecin çalışabildiği CPU'lar (sched_getaffinity; cgroup cpuset dahil)
+std::vector<int> usable_cpus();
+
+// n_sets adet n_threads'lik çekirdek kümesi: küme i, cpus içinde
+// [i*n_threads, (i+1)*n_threads) aralığıdır. CPU yetmezse kümeler sarar ve
+// çakışır; *overlapping bu durumda true olur.
+std::vector<std::vector<int>> plan_core_sets(const std::vector<int>& cpus,
+                                             size_t n_sets, int n_threads,
+                                             bool* overlapping = nullptr);
+
+// [YENİ]: Çağıran thread'i geçici olarak bir çekirdek kümesine bağlar;
+// yıkıcı önceki maskeyi geri yükler. Bağlama başarısızsa hiçbir şey yapmaz.
+class ScopedAffinity {
+ public:
+  ScopedAffinity() = default;
+  ~ScopedAffinity();
+
+  ScopedAffinity(const ScopedAffinity&) = delete;
+  ScopedAffinity& operator=(const ScopedAffinity&) = delete;
+
+  bool bind(const std::vector<int>& cpus);
+
+ private:
+  cpu_set_t previous_;
+  bool bound_ = false;
+};
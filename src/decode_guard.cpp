@@ -0,0 +1,157 @@
+#include "decode_guard.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "stt_engine.h"
+
+namespace {
+constexpr size_t kMinBudget = 48;
+}  // namespace
+
+bool DecodeGuard::ends_with_loop(const std::vector<whisper_token>& seq,
+                                 int max_ngram, int min_tokens) {
+  const size_t n = seq.size();
+  for (size_t p = 1; p <= static_cast<size_t>(max_ngram); ++p) {
+    const size_t reps = std::max<size_t>(3, (min_tokens + p - 1) / p);
+    if (reps * p > n) continue;
+    bool loop = true;
+    for (size_t i = n - (reps - 1) * p; i < n && loop; ++i)
+      loop = seq[i] == seq[i - p];
+    if (loop) return true;
+  }
+  return false;
+}
+
+DecodeGuard::DecodeGuard(size_t n_samples, float tokens_per_s, int max_ngram,
+                         int min_loop_tokens,
+                         std::function<bool()>* outer_abort)
+    : budget_(std::max(kMinBudget,
+                       static_cast<size_t>(std::ceil(
+                           tokens_per_s * static_cast<float>(n_samples) /
+                           WHISPER_SAMPLE_RATE)))),
+      max_ngram_(std::max(1, max_ngram)),
+      min_loop_tokens_(std::max(3, min_loop_tokens)),
+      outer_abort_(outer_abort) {}
+
+void DecodeGuard::install(whisper_full_params* wparams) {
+  wparams->abort_callback = abort_cb;
+  wparams->abort_callback_user_data = this;
+  wparams->logits_filter_callback = logits_cb;
+  wparams->logits_filter_callback_user_data = this;
+  wparams->new_segment_callback = new_segment_cb;
+  wparams->new_segment_callback_user_data = this;
+}
+
+void DecodeGuard::trip(GuardTrip reason) {
+  trip_.fetch_or(static_cast<int>(reason), std::memory_order_relaxed);
+}
+
+bool DecodeGuard::should_abort() const {
+  if (budget_exceeded()) return true;
+  return outer_abort_ && *outer_abort_ && (*outer_abort_)();
+}
+
+bool DecodeGuard::abort_cb(void* user_data) {
+  return static_cast<const DecodeGuard*>(user_data)->should_abort();
+}
+
+void DecodeGuard::logits_cb(struct whisper_context* ctx,
+                            struct whisper_state* /*state*/,
+                            const whisper_token_data* tokens, int n_tokens,
+                            float* logits, void* user_data) {
+  auto* self = static_cast<DecodeGuard*>(user_data);
+  if (n_tokens <= 0) return;
+
+  size_t len = static_cast<size_t>(n_tokens);
+  size_t prev = self->window_.load(std::memory_order_relaxed);
+  while (len > prev &&
+         !self->window_.compare_exchange_weak(prev, len,
+                                              std::memory_order_relaxed)) {
+  }
+  if (self->committed_.load(std::memory_order_relaxed) + len >
+      self->budget_) {
+    self->trip(GuardTrip::kTokenBudget);
+    return;  // Bir sonraki graph hesabında abort_cb durdurur
+  }
+
+  // Zaman damgası token'ları döngüyü bozar; yalnızca metin token'ları
+  const whisper_token eot = whisper_token_eot(ctx);
+  const size_t window =
+      static_cast<size_t>(self->max_ngram_) * self->min_loop_tokens_;
+  std::vector<whisper_token> text;
+  text.reserve(std::min(len, window));
+  for (int i = n_tokens - 1; i >= 0 && text.size() < window; --i)
+    if (tokens[i].id < eot) text.push_back(tokens[i].id);
+  std::reverse(text.begin(), text.end());
+  if (!ends_with_loop(text, self->max_ngram_, self->min_loop_tokens_))
+    return;
+
+  // Segment burada biter: yalnızca eot seçilebilir
+  const int n_vocab = whisper_n_vocab(ctx);
+  for (int i = 0; i < n_vocab; ++i)
+    if (i != eot) logits[i] = -INFINITY;
+  self->trip(GuardTrip::kRepetition);
+}
+
+void DecodeGuard::new_segment_cb(struct whisper_context* /*ctx*/,
+                                 struct whisper_state* state, int n_new,
+                                 void* user_data) {
+  auto* self = static_cast<DecodeGuard*>(user_data);
+  const int n_segments = whisper_full_n_segments_from_state(state);
+  size_t added = 0;
+  for (int i = std::max(0, n_segments - n_new); i < n_segments; ++i)
+    added += static_cast<size_t>(whisper_full_n_tokens_from_state(state, i));
+  self->committed_.fetch_add(added, std::memory_order_relaxed);
+  self->window_.store(0, std::memory_order_relaxed);
+}
+
+bool DecodeGuard::collapse_repetitions(DecodedSegment* seg) const {
+  std::vector<std::string> texts;
+  texts.reserve(seg->tokens.size());
+  for (const auto& tok : seg->tokens) texts.push_back(tok.text);
+
+  std::vector<TokenData> kept;
+  kept.reserve(seg->tokens.size());
+  size_t i = 0;
+  bool changed = false;
+  while (i < texts.size()) {
+    // i'den başlayan ve döngü eşiğini dolduran en kısa n-gram
+    size_t skip_to = i;
+    size_t loop_p = 0;
+    for (size_t p = 1; p <= static_cast<size_t>(max_ngram_); ++p) {
+      if (i + p > texts.size()) break;
+      size_t end = i + p;
+      while (end + p <= texts.size() &&
+             std::equal(texts.begin() + i, texts.begin() + i + p,
+                        texts.begin() + end))
+        end += p;
+      if ((end - i) / p >= 3 &&
+          end - i >= static_cast<size_t>(min_loop_tokens_)) {
+        skip_to = end;
+        loop_p = p;
+        break;
+      }
+    }
+    if (loop_p == 0) {
+      kept.push_back(std::move(seg->tokens[i]));
+      ++i;
+      continue;
+    }
+    // İlk örnek kalır; son token döngünün bitişini taşır
+    const int64_t loop_end = seg->tokens[skip_to - 1].t1;
+    for (size_t k = i; k < i + loop_p; ++k)
+      kept.push_back(std::move(seg->tokens[k]));
+    kept.back().t1 = loop_end;
+    i = skip_to;
+    changed = true;
+  }
+  if (!changed) return false;
+
+  seg->tokens = std::move(kept);
+  seg->text.clear();
+  for (const auto& tok : seg->tokens) seg->text += tok.text;
+  return true;
+}
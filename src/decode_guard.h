@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "whisper.h"
+
+struct DecodedSegment;
+
+// Koruyucunun devreye girme nedenleri (bit bayrakları; ikisi birden olabilir)
+enum class GuardTrip : int {
+  kNone = 0,
+  kTokenBudget = 1,  // Ses saniyesi başına token bütçesi aşıldı (abort)
+  kRepetition = 2,   // n-gram tekrar döngüsü (segment eot ile kesildi)
+};
+
+// [YENİ]: whisper_full sırasında kaçak decode koruyucusu. Gürültüde
+// Whisper aynı n-gram'ı yüzlerce kez üretebilir; bu token'lar sonradan
+// is_hallucination / olasılık filtresiyle atılsa da state saniyelerce
+// tutulur. Koruyucu whisper callback'lerine takılır:
+//  - logits filtresi: decoder dizisinin sonunda min_loop_tokens'ı dolduran
+//    (en az 3 kez) tekrar eden bir n-gram varsa yalnızca eot bırakılır ve
+//    segment orada kesilir.
+//  - yeni segment + abort: üretilen token sayısı
+//    max(min_budget, tokens_per_s * ses süresi)'ni aşınca decode durdurulur;
+//    o ana kadar tamamlanan pencereler sonuç olarak kalır.
+// Logits filtresi beam decoder'ları için paralel çağrılabilir; paylaşılan
+// sayaçlar atomiktir.
+class DecodeGuard {
+ public:
+  DecodeGuard(size_t n_samples, float tokens_per_s, int max_ngram,
+              int min_loop_tokens, std::function<bool()>* outer_abort);
+
+  // wparams'ın abort / logits filtresi / yeni segment callback'lerini
+  // koruyucuya bağlar; dış abort (istemci iptali) korunur.
+  void install(whisper_full_params* wparams);
+
+  bool tripped(GuardTrip reason) const {
+    return (trip_.load(std::memory_order_relaxed) &
+            static_cast<int>(reason)) != 0;
+  }
+  bool budget_exceeded() const { return tripped(GuardTrip::kTokenBudget); }
+
+  // Nedeni işaretler. Nedenler birbirini ezmez: tekrar döngüsü kesildikten
+  // sonra aşılan bütçe de abort'u tetikler.
+  void trip(GuardTrip reason);
+  // abort_callback kararı: bütçe aşıldı ya da dış abort (istemci) istendi
+  bool should_abort() const;
+
+  // Sonuçta kalan tekrarları (ör. eot'tan hemen önceki döngü) tek örneğe
+  // indirir ve segment metnini token'lardan yeniden kurar.
+  bool collapse_repetitions(DecodedSegment* seg) const;
+
+  // seq'in sonunda en az 3 kez ve toplam min_tokens'ı dolduracak şekilde
+  // art arda tekrar eden, en fazla max_ngram uzunlukta bir n-gram var mı
+  static bool ends_with_loop(const std::vector<whisper_token>& seq,
+                             int max_ngram, int min_tokens);
+
+ private:
+  static bool abort_cb(void* user_data);
+  static void logits_cb(struct whisper_context* ctx,
+                        struct whisper_state* state,
+                        const whisper_token_data* tokens, int n_tokens,
+                        float* logits, void* user_data);
+  static void new_segment_cb(struct whisper_context* ctx,
+                             struct whisper_state* state, int n_new,
+                             void* user_data);
+
+  const size_t budget_;
+  const int max_ngram_;
+  const int min_loop_tokens_;
+  std::function<bool()>* outer_abort_;
+
+  std::atomic<int> trip_{0};  // GuardTrip bitleri
+  std::atomic<size_t> committed_{0};  // Tamamlanan segmentlerin token'ları
+  std::atomic<size_t> window_{0};     // Aktif penceredeki en uzun dizi
+};
@@ -0,0 +1,63 @@
+#include "engine_executor.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "suts_logger.h"
+
+EngineExecutor::EngineExecutor(int n_workers, int max_workers) {
+  if (n_workers < 1) n_workers = 1;
+  max_workers_ = static_cast<size_t>(std::max(n_workers, max_workers));
+  std::lock_guard<std::mutex> lock(mutex_);
+  workers_.reserve(max_workers_);
+  for (int i = 0; i < n_workers; ++i)
+    workers_.emplace_back([this] { worker_loop(); });
+}
+
+EngineExecutor::~EngineExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  for (auto& w : workers_)
+    if (w.joinable()) w.join();
+}
+
+void EngineExecutor::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push(std::move(task));
+    // Sıradaki her iş için boşta worker yoksa yenisi açılır
+    if (!stopping_ && tasks_.size() > idle_ && workers_.size() < max_workers_)
+      workers_.emplace_back([this] { worker_loop(); });
+  }
+  cv_.notify_one();
+}
+
+size_t EngineExecutor::pending() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tasks_.size();
+}
+
+void EngineExecutor::worker_loop() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++idle_;
+      cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      --idle_;
+      // Kapanışta kuyruk boşaltılır: bekleyen reactor'lar Finish almalı
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    try {
+      task();
+    } catch (const std::exception& e) {
+      SUTS_ERROR("ENGINE_EXECUTOR_ERROR", "", "", "",
+                 "Unhandled exception in engine task: {}", e.what());
+    }
+  }
+}
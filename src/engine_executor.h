@@ -0,0 +1,38 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// [YENİ]: Decode işleri için iş havuzu.
+// gRPC callback thread'leri asla whisper içinde bloklanmaz; ağır iş buraya
+// devredilir. Havuz n_workers thread ile başlar ve boşta worker yokken
+// max_workers'a kadar büyür: işler burada FIFO beklemek yerine hemen
+// StateScheduler::acquire'a ulaşır, böylece öncelik sınıfları, zaman
+// aşımları, partial düşürme, WFQ, degrade eşikleri ve esnek havuz gRPC
+// trafiğine de uygulanır. Açılan thread'ler kapanışa kadar yaşar.
+class EngineExecutor {
+ public:
+  EngineExecutor(int n_workers, int max_workers);
+  ~EngineExecutor();
+
+  EngineExecutor(const EngineExecutor&) = delete;
+  EngineExecutor& operator=(const EngineExecutor&) = delete;
+
+  void submit(std::function<void()> task);
+  size_t pending() const;
+
+ private:
+  void worker_loop();
+
+  size_t max_workers_ = 1;
+  size_t idle_ = 0;  // Görev bekleyen worker sayısı
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+};
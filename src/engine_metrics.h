@@ -0,0 +1,62 @@
+#pragma once
+
+#include <prometheus/counter.h>
+#include <prometheus/family.h>
+#include <prometheus/gauge.h>
+#include <prometheus/histogram.h>
+
+// Motor (SttEngine) içinden beslenen metrikler. main.cpp'de kayıt edilir ve
+// engine'e verilir; engine metriksiz (nullptr) de çalışabilir.
+struct EngineMetrics {
+  // --- VAD Context Havuzu ---
+  prometheus::Gauge& vad_pool_size;
+  prometheus::Gauge& vad_pool_in_use;
+  prometheus::Histogram& vad_wait_seconds;
+  prometheus::Counter& vad_acquire_timeouts_total;
+
+  // --- İstek Birleştirme (Coalescing) ---
+  prometheus::Histogram& coalesce_batch_size;
+  prometheus::Counter& coalesced_requests_total;
+
+  // --- Encoder Bağlamı (audio_ctx) ---
+  // bucket etiketi: kullanılan audio_ctx değeri veya tam pencere için "full"
+  prometheus::Family<prometheus::Counter>& audio_ctx_bucket_total;
+
+  // --- State Havuzu Öncelik Sınıfları (class etiketi) ---
+  prometheus::Family<prometheus::Gauge>& state_queue_depth;
+  prometheus::Family<prometheus::Histogram>& state_wait_seconds;
+  prometheus::Family<prometheus::Counter>& state_queue_timeouts_total;
+  prometheus::Family<prometheus::Counter>& state_dropped_total;
+
+  // --- Esnek State Havuzu (event: grow | grow_failed | shrink) ---
+  prometheus::Gauge& state_pool_size;
+  prometheus::Gauge& state_pool_max;
+  prometheus::Gauge& state_bytes;
+  prometheus::Family<prometheus::Counter>& state_pool_events_total;
+
+  // --- Tenant Kotaları (tenant etiketi; reddedilenlerde reason) ---
+  prometheus::Family<prometheus::Counter>& tenant_rejected_total;
+  prometheus::Family<prometheus::Gauge>& tenant_active_requests;
+  prometheus::Family<prometheus::Counter>& tenant_audio_seconds_total;
+
+  // --- Yük Uyarlamalı Decode ---
+  prometheus::Gauge& decode_degrade_level;
+  // level etiketi: isteğe uygulanan ucuzlatma seviyesi (1, 2)
+  prometheus::Family<prometheus::Counter>& decode_degraded_total;
+
+  // --- Güven Kapılı Decode (outcome: accepted | rescored | kept) ---
+  prometheus::Family<prometheus::Counter>& decode_gate_segments_total;
+
+  // --- Kaçak Decode Koruyucusu (reason: token_budget | repetition) ---
+  prometheus::Family<prometheus::Counter>& decode_guard_total;
+
+  // --- İptal Edilen Decode (reason: client | max_decode_time) ---
+  prometheus::Family<prometheus::Counter>& decode_aborted_total;
+
+  // --- Isınma (pool: main | fast | vad, state: havuz içi sıra) ---
+  prometheus::Family<prometheus::Gauge>& warmup_seconds;
+
+  // --- Model Yükleme (model etiketi: dosya adı) ---
+  prometheus::Family<prometheus::Gauge>& model_load_seconds;
+  prometheus::Gauge& process_rss_bytes;
+};
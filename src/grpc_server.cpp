@@ -1,62 +1,781 @@
 // Dosya: src/grpc_server.cpp
 #include "grpc_server.h"
 
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <functional>
+#include <mutex>
 #include <vector>
 
+#include "audio_decoder.h"
+#include "stream_audio_input.h"
+#include "stream_endpointer.h"
+#include "streaming_decoder.h"
 #include "suts_logger.h"
+#include "tenant_limiter.h"
 #include "utils.h"
 
 using namespace sentiric::utils;
+using sentiric::stt::v1::WhisperTranscribeStreamRequest;
+using sentiric::stt::v1::WhisperTranscribeStreamResponse;
+
+namespace {
+struct TraceContext {
+  std::string trace_id = "unknown";
+  std::string span_id = "unknown";
+  std::string tenant_id = "unknown";
+};
+
+TraceContext read_trace_context(const grpc::CallbackServerContext* context) {
+  TraceContext tc;
+  const auto& metadata = context->client_metadata();
+  if (auto it = metadata.find("x-trace-id"); it != metadata.end())
+    tc.trace_id = std::string(it->second.data(), it->second.length());
+  if (auto it = metadata.find("x-span-id"); it != metadata.end())
+    tc.span_id = std::string(it->second.data(), it->second.length());
+  if (auto it = metadata.find("x-tenant-id"); it != metadata.end())
+    tc.tenant_id = std::string(it->second.data(), it->second.length());
+  return tc;
+}
+
+// [YENİ]: x-audio-encoding / x-sample-rate metadata'sından stream giriş
+// biçimi. Varsayılan (pcm16, 16kHz) için *input boş kalır. Geçersiz
+// değerde hata mesajıyla false döner.
+bool read_stream_audio_input(const grpc::CallbackServerContext* context,
+                             std::unique_ptr<StreamAudioInput>* input,
+                             std::string* error) {
+  const auto& metadata = context->client_metadata();
+  StreamEncoding encoding = StreamEncoding::kPcm16;
+  int sample_rate = 16000;
+  if (auto it = metadata.find("x-audio-encoding"); it != metadata.end()) {
+    const std::string value(it->second.data(), it->second.length());
+    if (!parse_stream_encoding(value, &encoding)) {
+      *error = "Unsupported x-audio-encoding: " + value;
+      return false;
+    }
+  }
+  if (auto it = metadata.find("x-sample-rate"); it != metadata.end()) {
+    const std::string value(it->second.data(), it->second.length());
+    sample_rate = std::atoi(value.c_str());
+    if (sample_rate < StreamAudioInput::kMinSampleRate ||
+        sample_rate > StreamAudioInput::kMaxSampleRate) {
+      *error = "Unsupported x-sample-rate: " + value;
+      return false;
+    }
+  }
+  if (encoding == StreamEncoding::kPcm16 && sample_rate == 16000) return true;
+  try {
+    *input = std::make_unique<StreamAudioInput>(encoding, sample_rate);
+  } catch (const std::exception& e) {
+    *error = e.what();
+    return false;
+  }
+  return true;
+}
+
+// Son segmentin duygu durumunu ve konuşmacı vektörünü yanıta yazar
+void set_stream_affective(WhisperTranscribeStreamResponse& response,
+                          const TranscriptionResult& res) {
+  const auto& aff = res.affective;
+  response.set_gender_proxy(aff.gender_proxy);
+  response.set_emotion_proxy(aff.emotion_proxy);
+  response.set_arousal(aff.arousal);
+  response.set_valence(aff.valence);
+  response.set_pitch_mean(aff.pitch_mean);
+  response.set_pitch_std(aff.pitch_std);
+  response.set_energy_mean(aff.energy_mean);
+  response.set_energy_std(aff.energy_std);
+  response.set_spectral_centroid(aff.spectral_centroid);
+  response.set_zero_crossing_rate(aff.zero_crossing_rate);
+  response.clear_speaker_vec();
+  for (float v : aff.speaker_vec) response.add_speaker_vec(v);
+  response.set_speaker_id(res.speaker_id);
+}
+
+// Token'ları kelime zaman bilgisi olarak yanıta ekler (centisaniye -> sn)
+void add_stream_words(WhisperTranscribeStreamResponse& response,
+                      const std::vector<TokenData>& tokens) {
+  for (const auto& token : tokens) {
+    auto* word_data = response.add_words();
+    word_data->set_word(token.text);
+    word_data->set_start(static_cast<float>(token.t0) / 100.0f);
+    word_data->set_end(static_cast<float>(token.t1) / 100.0f);
+    word_data->set_probability(token.p);
+  }
+}
+
+// Artımlı decoder sonucunu yanıta çevirir. is_final eski anlamını korur
+// (cümle sonu); partial metni cümlenin tamamıdır. Kesinleşen kelimeler ayrı
+// alanda (words) taşınır: partial'da yalnızca bu adımda kesinleşenler
+// (kararlı, geri alınmaz), finalde cümlenin tüm kelimeleri.
+void append_incremental_response(
+    const StreamUpdate& update, bool is_final,
+    std::vector<WhisperTranscribeStreamResponse>& out) {
+  if (update.text.empty()) return;
+  WhisperTranscribeStreamResponse response;
+  response.set_transcription(update.text);
+  response.set_is_final(is_final);
+  add_stream_words(response, update.committed_tokens);
+  const TranscriptionResult* latest = nullptr;
+  for (const auto& res : update.results)
+    if (!res.text.empty()) latest = &res;
+  if (latest) set_stream_affective(response, *latest);
+  out.push_back(std::move(response));
+}
+
+// Hatalı istekleri decode kuyruğuna sokmadan hemen kapatan reactor
+class RejectedStreamReactor
+    : public grpc::ServerBidiReactor<WhisperTranscribeStreamRequest,
+                                     WhisperTranscribeStreamResponse> {
+ public:
+  explicit RejectedStreamReactor(const grpc::Status& status) {
+    Finish(status);
+  }
+  void OnDone() override { delete this; }
+};
+
+// [MİMARİ]: Stream başına durum makinesi.
+// Okuma -> parça kuyruğu -> (VAD varsa ingest havuzunda) ses işleme ->
+// (gerekirse) decode işi executor'a -> yanıtlar yazma kuyruğuna. Kuyruğu
+// aynı anda tek iş (ya da decode) işler; bu sıralamayı korur. Kuyruk
+// dolunca okuma durur ve HTTP/2 akış kontrolüyle istemciye geri basınç
+// uygulanır.
+class TranscribeStreamReactor
+    : public grpc::ServerBidiReactor<WhisperTranscribeStreamRequest,
+                                     WhisperTranscribeStreamResponse> {
+ public:
+  // audio_input: 16kHz s16le dışı giriş için çözücü (nullptr = doğrudan)
+  // ingest_executor: VAD/söz sonu işleri; state beklemez, decode'lardan ayrı
+  TranscribeStreamReactor(std::shared_ptr<SttEngine> engine,
+                          AppMetrics& metrics, EngineExecutor& executor,
+                          EngineExecutor& ingest_executor, TraceContext tc,
+                          TenantLimiter::Lease lease,
+                          std::unique_ptr<StreamAudioInput> audio_input)
+      : engine_(std::move(engine)),
+        metrics_(metrics),
+        executor_(executor),
+        ingest_executor_(ingest_executor),
+        tc_(std::move(tc)),
+        lease_(std::move(lease)),
+        audio_input_(std::move(audio_input)),
+        dynamic_buffer_size_(engine_->get_settings().stream_buffer_samples),
+        model_(engine_->current_model()) {
+    const Settings& settings = engine_->get_settings();
+    // [YENİ]: Artımlı VAD oturumu. Hem endpointing hem de engine'in sessizlik
+    // kapısı aynı çerçeve olasılıklarını kullanır; ses tekrar taranmaz.
+    if (engine_->has_vad())
+      vad_session_ = std::make_unique<VadSession>(*engine_);
+    // [YENİ]: Artımlı modda tampon yerine stream'e özel decoder durumu
+    if (settings.stream_incremental) {
+      RequestOptions options;
+      options.tenant_id = tc_.tenant_id;
+      options.model = model_;
+      options.vad_session = vad_session_.get();
+      options.should_abort = [this] { return abort_.load(); };
+      decoder_ = std::make_unique<StreamingDecoder>(*engine_, options);
+    }
+    // [YENİ]: Sunucu taraflı söz sonu tespiti (istemci EOS'una ek olarak)
+    if (settings.stream_vad_endpointing && vad_session_)
+      endpointer_ = std::make_unique<StreamEndpointer>(settings);
+    metrics_.active_streams.Increment();
+    StartRead(&request_);
+  }
+
+  void OnReadDone(bool ok) override {
+    std::unique_lock<std::mutex> lock(mu_);
+    reading_ = false;
+    if (!ok || finished_ || write_failed_ || cancelled_) {
+      reading_done_ = true;
+      // Kuyruktaki ses işlenmeye devam eder; iş bitince stream kapanır
+      if (!processing_) MaybeFinishLocked(lock);
+      return;
+    }
+
+    // [YENİ]: Ses parçaları kuyruğa alınır ve okuma hemen sürer (kuyruk
+    // kMaxPendingChunks'a kadar). Kuyruğu tek bir iş sırayla boşaltır;
+    // bekleyen ardışık parçalar tek Ingest'te birleştiği için VAD (ve
+    // bağlam çerçevelerinin yeniden ısıtılması) parça başına değil, parti
+    // başına bir kez çalışır.
+    pending_chunks_.push_back(std::move(*request_.mutable_audio_chunk()));
+    const bool drain = !processing_;
+    if (drain) processing_ = true;
+    const bool read = ResumeReadLocked();
+    lock.unlock();
+    if (read) StartRead(&request_);
+    if (drain) ScheduleDrain();
+  }
+
+  void OnWriteDone(bool ok) override {
+    std::unique_lock<std::mutex> lock(mu_);
+    write_queue_.pop_front();
+    if (!ok) {
+      // İstemci bağlantıyı kapattı; sync sürümdeki gibi OK ile bitir
+      write_failed_ = true;
+      abort_ = true;
+      write_queue_.clear();
+    }
+    if (!write_queue_.empty()) {
+      const WhisperTranscribeStreamResponse* next = &write_queue_.front();
+      lock.unlock();
+      StartWrite(next);
+      return;
+    }
+    writing_ = false;
+    MaybeFinishLocked(lock);
+  }
+
+  void OnCancel() override {
+    std::unique_lock<std::mutex> lock(mu_);
+    cancelled_ = true;
+    abort_ = true;  // Süren decode beklenmeden durur
+    MaybeFinishLocked(lock);
+  }
+
+  void OnDone() override {
+    metrics_.active_streams.Decrement();
+    SUTS_INFO("STT_STREAM_COMPLETED", tc_.trace_id, tc_.span_id, tc_.tenant_id,
+              "✅ gRPC Stream Connection closed cleanly.");
+    delete this;
+  }
+
+ private:
+  enum class Action { kNone, kPartial, kFinal };
+
+  // Sesi tampona/decoder'a yazar, decode yapmaz. VAD yoksa gRPC thread'inde,
+  // varsa (çıkarım yapıldığı için) ingest havuzunda çalışır.
+  Action Ingest(const std::string& chunk) {
+    // [YENİ]: EOS SİNYALİ (İstemci Sustuğunda Tetiklenir)
+    if (chunk.empty()) {
+      // Yeniden örnekleyicide kalan söz sonu da bu cümleye girer
+      if (audio_input_) {
+        converted_.clear();
+        audio_input_->flush(&converted_);
+        Append(converted_.data(), converted_.size());
+      }
+      if (endpointer_) endpointer_->reset();
+      endpoint_cut_ = 0;  // EOS'ta cümle tamponun tamamıdır
+      if (decoder_)
+        return decoder_->empty() ? Action::kNone
+                                 : PrepareDecode(Action::kFinal);
+      return buffer_.empty() ? Action::kNone : PrepareDecode(Action::kFinal);
+    }
+
+    const uint8_t* data_ptr = reinterpret_cast<const uint8_t*>(chunk.data());
+    size_t data_len = chunk.size();
+
+    if (is_first_chunk_) {
+      if (has_wav_header(chunk)) {
+        is_wav_container_ = true;
+        if (chunk.size() > 44) wav_header_skip_ = 44;
+      }
+      is_first_chunk_ = false;
+    }
+
+    if (is_wav_container_ && wav_header_skip_ > 0) {
+      if (data_len >= wav_header_skip_) {
+        data_ptr += wav_header_skip_;
+        data_len -= wav_header_skip_;
+        wav_header_skip_ = 0;
+      } else {
+        wav_header_skip_ -= data_len;
+        data_len = 0;
+      }
+    }
+
+    // [YENİ]: G.711 / 8kHz girişi 16kHz s16le'ye çevrilir; sonraki tüm
+    // aşamalar (VAD, tampon, decoder) değişmeden çalışır
+    if (audio_input_) {
+      converted_.clear();
+      audio_input_->decode(data_ptr, data_len, &converted_);
+      data_ptr = reinterpret_cast<const uint8_t*>(converted_.data());
+      data_len = converted_.size() * 2;
+    }
+
+    const bool endpoint =
+        Append(reinterpret_cast<const int16_t*>(data_ptr), data_len / 2);
+    if (endpoint) {
+      SUTS_DEBUG("STT_ENDPOINT_DETECTED", tc_.trace_id, tc_.span_id,
+                 tc_.tenant_id,
+                 "Server-side end of utterance (silence >= {}ms).",
+                 engine_->get_settings().stream_endpoint_silence_ms);
+    }
+
+    if (decoder_) {
+      // Eski yoldaki 30sn sınırı gibi: susmadan konuşulsa da cümle kapanır
+      const bool overflow = decoder_->utterance_samples() > kMaxBufferSize;
+      if ((endpoint || overflow) && !decoder_->empty())
+        return PrepareDecode(Action::kFinal);
+      return decoder_->pending_samples() >= dynamic_buffer_size_
+                 ? PrepareDecode(Action::kPartial)
+                 : Action::kNone;
+    }
+
+    if (endpoint && !buffer_.empty()) return PrepareDecode(Action::kFinal);
+
+    // [YENİ]: TAMPONU TEMİZLEMEDEN (Partial) İŞLEME
+    return buffer_.size() - last_processed_size_ >= dynamic_buffer_size_
+               ? PrepareDecode(Action::kPartial)
+               : Action::kNone;
+  }
+
+  // 16kHz örnekleri kotaya, VAD'e ve tampona/decoder'a yazar. Sunucu taraflı
+  // söz sonu tespit edildiyse true döner.
+  bool Append(const int16_t* samples, size_t n_samples) {
+    if (n_samples == 0) return false;
+    // Stream açılışta kabul edildi; gelen ses kovaya borç olarak yazılır
+    engine_->tenant_limiter().charge(tc_.tenant_id, n_samples / 16000.0);
+
+    bool endpoint = false;
+    if (vad_session_) {
+      vad_session_->push(samples, n_samples);
+      endpoint = endpointer_ && endpointer_->update(*vad_session_);
+      if (endpoint) endpoint_cut_ = endpointer_->endpoint_sample();
+    }
+
+    if (decoder_) {
+      decoder_->append(samples, n_samples);
+    } else {
+      size_t current_size = buffer_.size();
+      buffer_.resize(current_size + n_samples);
+      std::memcpy(buffer_.data() + current_size, samples, n_samples * 2);
+    }
+    return endpoint;
+  }
+
+  // Decode öncesi bekleyen VAD çerçevelerini değerlendirir; engine tamponun
+  // tamamı için hazır olasılık bulur.
+  Action PrepareDecode(Action action) {
+    if (vad_session_) vad_session_->flush();
+    return action;
+  }
+
+  RequestOptions BufferOptions(RequestPriority priority) const {
+    RequestOptions options;
+    options.priority = priority;
+    options.tenant_id = tc_.tenant_id;
+    options.model = model_;
+    options.vad_session = vad_session_.get();
+    options.vad_sample_offset = buffer_origin_;
+    options.should_abort = [this] { return abort_.load(); };
+    return options;
+  }
+
+  // Cümle bitince tamponu sıfırlar ve eski VAD olasılıklarını bırakır
+  void ResetBuffer() {
+    buffer_origin_ += buffer_.size();
+    buffer_.clear();
+    last_processed_size_ = 0;
+    if (vad_session_) vad_session_->discard_before(buffer_origin_);
+  }
+
+  // [YENİ]: VAD çıkarımı (Silero) VAD havuzunu beklerken bloklanabilir;
+  // gRPC callback thread'i tutulmasın diye VAD'lı stream'lerin sesi ingest
+  // havuzunda işlenir. State bekleyen decode'lar ayrı havuzda olduğundan
+  // gerçek zamanlı stream'lerin VAD'ı batch decode'ların arkasında sıraya
+  // girmez. VAD yoksa Ingest ucuzdur ve çağıran thread'de çalışır.
+  void ScheduleDrain() {
+    if (vad_session_)
+      ingest_executor_.submit([this] { DrainChunks(); });
+    else
+      DrainChunks();
+  }
+
+  // Kuyruğu sırayla işler. Decode gerekirse (state beklediği için) decode
+  // executor'una devredilir ve kalan parçalar decode bitince işlenir.
+  void DrainChunks() {
+    for (;;) {
+      std::string batch;
+      bool read = false;
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (cancelled_ || write_failed_) pending_chunks_.clear();
+        if (pending_chunks_.empty()) break;
+        batch = std::move(pending_chunks_.front());
+        pending_chunks_.pop_front();
+        // EOS (boş parça) tek başına işlenir
+        while (!batch.empty() && !pending_chunks_.empty() &&
+               !pending_chunks_.front().empty()) {
+          batch += pending_chunks_.front();
+          pending_chunks_.pop_front();
+        }
+        read = ResumeReadLocked();
+      }
+      if (read) StartRead(&request_);
+
+      Action action = Action::kNone;
+      try {
+        action = Ingest(batch);
+      } catch (const std::exception& e) {
+        SUTS_ERROR("STT_STREAM_ERROR", tc_.trace_id, tc_.span_id,
+                   tc_.tenant_id, "Streaming error: {}", e.what());
+      }
+      if (action != Action::kNone) {
+        executor_.submit([this, action] { RunDecode(action); });
+        return;
+      }
+    }
+    OnDecodeDone({});
+  }
+
+  // Executor thread'inde çalışır. Decode sürerken kuyruk işlenmediği için
+  // (processing_) tampon/decoder durumuna kilitsiz erişmek güvenlidir.
+  void RunDecode(Action action) {
+    std::vector<WhisperTranscribeStreamResponse> out;
+    try {
+      if (decoder_) {
+        DecodeIncremental(action == Action::kFinal, out);
+      } else if (action == Action::kFinal) {
+        DecodeFinal(out);
+      } else {
+        DecodePartial(out);
+      }
+    } catch (const PartialDroppedException&) {
+      // Havuz dolu ve final bekliyor: bu partial atlanır, sonraki gelir
+      SUTS_DEBUG("STT_PARTIAL_DROPPED", tc_.trace_id, tc_.span_id,
+                 tc_.tenant_id, "Partial dropped under pool pressure");
+    } catch (const std::exception& e) {
+      SUTS_ERROR("STT_STREAM_ERROR", tc_.trace_id, tc_.span_id, tc_.tenant_id,
+                 "Streaming error: {}", e.what());
+    }
+    OnDecodeDone(std::move(out));
+  }
+
+  void DecodeIncremental(bool is_final,
+                         std::vector<WhisperTranscribeStreamResponse>& out) {
+    // Pencere stream_max_window_ms ile sınırlı olduğu için 30sn OOM
+    // koruması artımlı modda gerekmez.
+    if (is_final) {
+      // Söz sonundan sonra gelen ses (aynı partide) yeni cümleye taşınır
+      std::vector<int16_t> carry = decoder_->take_after(endpoint_cut_);
+      endpoint_cut_ = 0;
+      StreamUpdate update = decoder_->finalize();
+      if (!carry.empty()) decoder_->append(carry.data(), carry.size());
+      if (vad_session_)
+        vad_session_->discard_before(decoder_->retained_origin());
+      if (!update.text.empty()) {
+        SUTS_INFO("STT_TRANSCRIPT_FINALIZED", tc_.trace_id, tc_.span_id,
+                  tc_.tenant_id, "✅ Final Sentence: '{}'", update.text);
+      }
+      append_incremental_response(update, true, out);
+      return;
+    }
+    StreamUpdate update = decoder_->decode_partial();
+    if (vad_session_)
+      vad_session_->discard_before(decoder_->retained_origin());
+    append_incremental_response(update, false, out);
+  }
+
+  void DecodeFinal(std::vector<WhisperTranscribeStreamResponse>& out) {
+    SUTS_DEBUG("STT_EOS_RECEIVED", tc_.trace_id, tc_.span_id, tc_.tenant_id,
+               "EOS signal received. Finalizing {} samples.", buffer_.size());
+    // Söz sonundan sonra gelen ses (aynı partide) yeni cümleye taşınır
+    std::vector<int16_t> carry;
+    if (endpoint_cut_ > buffer_origin_ &&
+        endpoint_cut_ - buffer_origin_ < buffer_.size()) {
+      const auto cut = buffer_.begin() + (endpoint_cut_ - buffer_origin_);
+      carry.assign(cut, buffer_.end());
+      buffer_.erase(cut, buffer_.end());
+    }
+    endpoint_cut_ = 0;
+    auto results = engine_->transcribe_pcm16(
+        buffer_, 16000, BufferOptions(RequestPriority::kRealtimeFinal));
+    // Cümle bitince yeni cümle için tamponu sıfırla
+    ResetBuffer();
+    buffer_ = std::move(carry);
+
+    for (const auto& res : results) {
+      if (res.text.empty()) continue;
+      WhisperTranscribeStreamResponse response;
+      response.set_transcription(res.text);
+      // [KRİTİK]: Cümle Bitti!
+      response.set_is_final(true);
+      set_stream_affective(response, res);
+      add_stream_words(response, res.tokens);
+      out.push_back(std::move(response));
+      SUTS_INFO("STT_TRANSCRIPT_FINALIZED", tc_.trace_id, tc_.span_id,
+                tc_.tenant_id, "✅ Final Sentence: '{}' [Spk: {}]", res.text,
+                res.speaker_id);
+    }
+  }
+
+  void DecodePartial(std::vector<WhisperTranscribeStreamResponse>& out) {
+    SttEngine::PerformanceMetrics perf;
+    auto results = engine_->transcribe_pcm16(
+        buffer_, 16000, BufferOptions(RequestPriority::kRealtimePartial),
+        &perf);
+    last_processed_size_ = buffer_.size();
+
+    // [MİMARİ DÜZELTME]: Partial mesajlarda (Kullanıcı hala konuşurken)
+    // Whisper birden fazla segment bulursa, UI bunları tek tek alıp ezmesin
+    // diye Hepsini tek bir string olarak birleştirip gönderiyoruz.
+    std::string combined_partial_text;
+    WhisperTranscribeStreamResponse combined_response;
+    bool has_valid_data = false;
+
+    for (const auto& res : results) {
+      if (!res.text.empty()) {
+        combined_partial_text += res.text + " ";
+        has_valid_data = true;
+        // Son segmentin duygu durumunu ve vektörünü al (En güncel olan)
+        set_stream_affective(combined_response, res);
+      }
+    }
+
+    if (has_valid_data) {
+      combined_response.set_transcription(combined_partial_text);
+      combined_response.set_is_final(false);  // Hala konuşuyor
+      out.push_back(std::move(combined_response));
+    }
+
+    // [KRİTİK VERİ KAYBI ÇÖZÜMÜ]: OOM Koruması (30 Saniye Sınırı)
+    // Kullanıcı 30sn susmadan konuşursa, buffer'ı silmeden önce her şeyi
+    // FINAL olarak kaydet!
+    if (buffer_.size() > kMaxBufferSize) {
+      SUTS_WARN("STT_BUFFER_OVERFLOW", tc_.trace_id, tc_.span_id,
+                tc_.tenant_id,
+                "User spoke for 30s without breathing. Forcing "
+                "finalization to prevent data loss.");
+
+      for (const auto& res : results) {
+        if (res.text.empty()) continue;
+        WhisperTranscribeStreamResponse final_resp;
+        final_resp.set_transcription(res.text);
+        final_resp.set_is_final(true);  // ZORLA FİNAL YAP
+        set_stream_affective(final_resp, res);
+        out.push_back(std::move(final_resp));
+      }
+      ResetBuffer();
+    }
+  }
+
+  // Decode ya da kuyruk işi bitince çağrılır. Decode sırasında biriken
+  // parçalar varsa kuyruk işi yeniden başlatılır.
+  void OnDecodeDone(std::vector<WhisperTranscribeStreamResponse> out) {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (!write_failed_) {
+      for (auto& r : out) write_queue_.push_back(std::move(r));
+    }
+
+    const WhisperTranscribeStreamResponse* to_write = nullptr;
+    if (!writing_ && !write_queue_.empty()) {
+      writing_ = true;
+      to_write = &write_queue_.front();
+    }
+    const bool drain =
+        !pending_chunks_.empty() && !cancelled_ && !write_failed_;
+    processing_ = drain;
+    const bool read = ResumeReadLocked();
+    if (!drain) {
+      MaybeFinishLocked(lock);
+      if (!lock.owns_lock()) return;
+    }
+    lock.unlock();
+
+    // deque::push_back referansları geçersiz kılmaz; front() güvenlidir
+    if (to_write) StartWrite(to_write);
+    if (read) StartRead(&request_);
+    if (drain) ScheduleDrain();
+  }
+
+  // Okuma duruyorsa ve kuyrukta yer varsa yeni okuma hakkı alır
+  bool ResumeReadLocked() {
+    if (reading_ || reading_done_ || cancelled_ || write_failed_ ||
+        pending_chunks_.size() >= kMaxPendingChunks)
+      return false;
+    reading_ = true;
+    return true;
+  }
+
+  // Stream ancak decode ve yazma bittiğinde kapatılabilir. gRPC çağrıları
+  // kilit dışında yapılır (callback'ler inline tetiklenebilir).
+  void MaybeFinishLocked(std::unique_lock<std::mutex>& lock) {
+    bool stop_requested = reading_done_ || cancelled_ || write_failed_;
+    if (finished_ || !stop_requested || processing_ || writing_) return;
+    finished_ = true;
+    grpc::Status status =
+        cancelled_ ? grpc::Status::CANCELLED : grpc::Status::OK;
+    lock.unlock();
+    Finish(status);
+  }
+
+  static constexpr size_t kMaxBufferSize = 16000 * 30;  // 30 Saniye
+  // İşlenmeyi bekleyen parça sınırı; dolunca okuma durur (geri basınç)
+  static constexpr size_t kMaxPendingChunks = 32;
+
+  std::shared_ptr<SttEngine> engine_;
+  AppMetrics& metrics_;
+  EngineExecutor& executor_;
+  EngineExecutor& ingest_executor_;
+  TraceContext tc_;
+  TenantLimiter::Lease lease_;  // Stream süresince eşzamanlılık payı
+  std::unique_ptr<StreamAudioInput> audio_input_;
+  std::vector<int16_t> converted_;  // audio_input_ çıktısı (tekrar kullanılır)
+  const size_t dynamic_buffer_size_;
+  // Stream boyunca sabit model; hot swap'ta stream eski modelde biter
+  std::shared_ptr<LoadedModel> model_;
+
+  WhisperTranscribeStreamRequest request_;
+
+  // [YENİ MİMARİ]: Kesintisiz tampon yönetimi
+  std::vector<int16_t> buffer_;
+  size_t last_processed_size_ = 0;
+  size_t buffer_origin_ = 0;  // buffer_[0]'ın stream içindeki mutlak konumu
+  // Sunucu taraflı söz sonunun mutlak örnek konumu (0: yok / EOS)
+  size_t endpoint_cut_ = 0;
+  std::unique_ptr<VadSession> vad_session_;
+  std::unique_ptr<StreamingDecoder> decoder_;
+  std::unique_ptr<StreamEndpointer> endpointer_;
+
+  bool is_first_chunk_ = true;
+  bool is_wav_container_ = false;
+  size_t wav_header_skip_ = 0;
+
+  std::mutex mu_;
+  std::deque<WhisperTranscribeStreamResponse> write_queue_;
+  std::deque<std::string> pending_chunks_;  // Okunmuş, işlenmemiş ses
+  bool reading_ = true;  // Bekleyen StartRead var
+  bool reading_done_ = false;
+  // Kuyruk ya da decode işi stream'in ses durumunun sahibi
+  bool processing_ = false;
+  bool writing_ = false;
+  bool write_failed_ = false;
+  bool cancelled_ = false;
+  bool finished_ = false;
+  // Decode thread'inden okunur (RequestOptions::should_abort)
+  std::atomic<bool> abort_{false};
+};
+}  // namespace
 
 GrpcServer::GrpcServer(std::shared_ptr<SttEngine> engine, AppMetrics& metrics)
-    : engine_(std::move(engine)), metrics_(metrics) {}
+    : engine_(std::move(engine)),
+      metrics_(metrics),
+      executor_(engine_->get_settings().parallel_requests +
+                    (engine_->has_fast_model()
+                         ? engine_->get_settings().fast_parallel_requests
+                         : 0),
+                engine_->get_settings().executor_max_threads),
+      // Her ingest işi bir VAD context'i tutar; fazlası havuzda beklerdi
+      ingest_executor_(engine_->get_settings().vad_pool_size,
+                       engine_->get_settings().vad_pool_size) {
+  if (engine_->get_settings().stream_vad_endpointing && !engine_->has_vad()) {
+    SUTS_WARN("STT_ENDPOINTING_DISABLED", "", "", "",
+              "⚠️ Stream VAD endpointing requested but VAD model is not "
+              "loaded (enable_vad=false). Falling back to client EOS.");
+  }
+}
 
-grpc::Status GrpcServer::WhisperTranscribe(
-    grpc::ServerContext* context,
+grpc::ServerUnaryReactor* GrpcServer::WhisperTranscribe(
+    grpc::CallbackServerContext* context,
     const sentiric::stt::v1::WhisperTranscribeRequest* request,
     sentiric::stt::v1::WhisperTranscribeResponse* response) {
-  std::string trace_id = "unknown", span_id = "unknown", tenant_id = "unknown";
-  auto metadata = context->client_metadata();
+  auto* reactor = context->DefaultReactor();
+  TraceContext tc = read_trace_context(context);
 
-  if (auto it = metadata.find("x-trace-id"); it != metadata.end())
-    trace_id = std::string(it->second.data(), it->second.length());
-  if (auto it = metadata.find("x-span-id"); it != metadata.end())
-    span_id = std::string(it->second.data(), it->second.length());
-  if (auto it = metadata.find("x-tenant-id"); it != metadata.end())
-    tenant_id = std::string(it->second.data(), it->second.length());
-
-  if (tenant_id == "unknown" || tenant_id.empty()) {
-    SUTS_ERROR("MISSING_TENANT_ID", trace_id, span_id, tenant_id,
+  if (tc.tenant_id == "unknown" || tc.tenant_id.empty()) {
+    SUTS_ERROR("MISSING_TENANT_ID", tc.trace_id, tc.span_id, tc.tenant_id,
                "Tenant ID is missing in gRPC metadata. Request rejected.");
-    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
-                        "tenant_id is strictly required for isolation");
+    reactor->Finish(
+        grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                     "tenant_id is strictly required for isolation"));
+    return reactor;
   }
 
   metrics_.requests_total.Increment();
-  auto start_time = std::chrono::steady_clock::now();
-  SUTS_INFO("STT_UNARY_REQUEST", trace_id, span_id, tenant_id,
+  SUTS_INFO("STT_UNARY_REQUEST", tc.trace_id, tc.span_id, tc.tenant_id,
             "📡 Unary gRPC Transcribe requested.");
 
-  if (!engine_->is_ready())
-    return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Model not ready");
+  if (!engine_->is_ready()) {
+    reactor->Finish(
+        grpc::Status(grpc::StatusCode::UNAVAILABLE, "Model not ready"));
+    return reactor;
+  }
+
+  // request/response, Finish çağrılana kadar geçerlidir
+  executor_.submit([this, context, reactor, tc, request, response] {
+    grpc::Status status;
+    try {
+      status = transcribe_unary(context, tc.trace_id, tc.span_id,
+                                tc.tenant_id, request, response);
+    } catch (const TenantQuotaException& e) {
+      SUTS_WARN("TENANT_QUOTA_EXCEEDED", tc.trace_id, tc.span_id, tc.tenant_id,
+                "Tenant quota exceeded: {}", e.reason());
+      status = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, e.what(),
+                            "tenant_quota:" + e.reason());
+    } catch (const EngineBusyException& e) {
+      status = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, e.what());
+    } catch (const std::exception& e) {
+      SUTS_ERROR("TRANSCRIPTION_ERROR", tc.trace_id, tc.span_id, tc.tenant_id,
+                 "Transcription error: {}", e.what());
+      status = grpc::Status(grpc::StatusCode::INTERNAL, e.what());
+    }
+    reactor->Finish(status);
+  });
+  return reactor;
+}
 
+grpc::Status GrpcServer::transcribe_unary(
+    grpc::CallbackServerContext* context, const std::string& trace_id,
+    const std::string& span_id, const std::string& tenant_id,
+    const sentiric::stt::v1::WhisperTranscribeRequest* request,
+    sentiric::stt::v1::WhisperTranscribeResponse* response) {
   DecodedAudio audio;
   try {
-    audio = parse_wav_robust(request->audio_data());
+    audio = decode_audio(
+        request->audio_data(),
+        static_cast<size_t>(engine_->get_settings().max_audio_duration_s) *
+            16000,
+        &metrics_.audio_decode_seconds);
+  } catch (const AudioTooLongException& e) {
+    SUTS_WARN("STT_AUDIO_TOO_LONG", trace_id, span_id, tenant_id,
+              "Request rejected: {}", e.what());
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
   } catch (...) {
     SUTS_ERROR("STT_INVALID_AUDIO", trace_id, span_id, tenant_id,
                "Invalid audio format received.");
     return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid audio");
   }
 
+  auto lease = engine_->tenant_limiter().admit(
+      tenant_id, static_cast<double>(audio.num_samples()) /
+                     static_cast<double>(audio.sample_rate));
+
+  // Deadline aşımı veya istemci iptalinde decode durur, state havuza döner
   RequestOptions options;
+  options.tenant_id = tenant_id;
+  options.should_abort = [context, deadline = context->deadline()] {
+    return context->IsCancelled() ||
+           std::chrono::system_clock::now() >= deadline;
+  };
+  if (options.should_abort()) {
+    SUTS_WARN("STT_CLIENT_GONE", trace_id, span_id, tenant_id,
+              "Deadline passed before decode; request dropped.");
+    return grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                        "Deadline exceeded before decode");
+  }
   if (request->has_language()) options.language = request->language();
 
+  SttEngine::PerformanceMetrics perf;
   auto results =
-      engine_->transcribe_pcm16(audio.pcm_data, audio.sample_rate, options);
+      audio.pcm_f32.empty()
+          ? engine_->transcribe_pcm16(audio.pcm_data, audio.sample_rate,
+                                      options, &perf)
+          : engine_->transcribe(audio.pcm_f32, audio.sample_rate, options,
+                                &perf);
+  if (options.should_abort()) {
+    SUTS_WARN("STT_CLIENT_GONE", trace_id, span_id, tenant_id,
+              "Client cancelled or deadline passed; result discarded.");
+    return context->IsCancelled()
+               ? grpc::Status::CANCELLED
+               : grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                              "Deadline exceeded");
+  }
+  // Yük nedeniyle ucuzlatılmış decode istemciye bildirilir
+  if (perf.degrade_level > 0)
+    context->AddTrailingMetadata("x-stt-degrade-level",
+                                 std::to_string(perf.degrade_level));
 
   if (!results.empty()) {
     response->set_transcription(results[0].text);
@@ -95,216 +814,53 @@ grpc::Status GrpcServer::WhisperTranscribe(
   return grpc::Status::OK;
 }
 
-grpc::Status GrpcServer::WhisperTranscribeStream(
-    grpc::ServerContext* context,
-    grpc::ServerReaderWriter<sentiric::stt::v1::WhisperTranscribeStreamResponse,
-                             sentiric::stt::v1::WhisperTranscribeStreamRequest>*
-        stream) {
-  std::string trace_id = "unknown", span_id = "unknown", tenant_id = "unknown";
-  auto metadata = context->client_metadata();
-
-  if (auto it = metadata.find("x-trace-id"); it != metadata.end())
-    trace_id = std::string(it->second.data(), it->second.length());
-  if (auto it = metadata.find("x-span-id"); it != metadata.end())
-    span_id = std::string(it->second.data(), it->second.length());
-  if (auto it = metadata.find("x-tenant-id"); it != metadata.end())
-    tenant_id = std::string(it->second.data(), it->second.length());
+grpc::ServerBidiReactor<WhisperTranscribeStreamRequest,
+                        WhisperTranscribeStreamResponse>*
+GrpcServer::WhisperTranscribeStream(grpc::CallbackServerContext* context) {
+  TraceContext tc = read_trace_context(context);
 
-  if (tenant_id == "unknown" || tenant_id.empty()) {
-    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
-                        "tenant_id is strictly required for isolation");
+  if (tc.tenant_id == "unknown" || tc.tenant_id.empty()) {
+    return new RejectedStreamReactor(
+        grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                     "tenant_id is strictly required for isolation"));
   }
 
   metrics_.requests_total.Increment();
-  SUTS_INFO("STT_STREAM_STARTED", trace_id, span_id, tenant_id,
+  SUTS_INFO("STT_STREAM_STARTED", tc.trace_id, tc.span_id, tc.tenant_id,
             "📡 New gRPC Stream Connection started.");
 
-  if (!engine_->is_ready())
-    return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Model not ready");
-
-  sentiric::stt::v1::WhisperTranscribeStreamRequest request;
-  std::vector<int16_t> buffer;
-
-  // [YENİ MİMARİ]: Kesintisiz tampon yönetimi
-  size_t last_processed_size = 0;
-  const size_t DYNAMIC_BUFFER_SIZE =
-      engine_->get_settings().stream_buffer_samples;
-  const size_t MAX_BUFFER_SIZE = 16000 * 30;  // 30 Saniye maksimum sınır
-
-  bool is_first_chunk = true;
-  bool is_wav_container = false;
-  size_t wav_header_skip = 0;
-
-  while (stream->Read(&request)) {
-    if (context->IsCancelled()) return grpc::Status::CANCELLED;
-
-    const std::string& chunk = request.audio_chunk();
-
-    // [YENİ]: EOS SİNYALİ (İstemci Sustuğunda Tetiklenir)
-    if (chunk.empty()) {
-      if (!buffer.empty()) {
-        SUTS_DEBUG("STT_EOS_RECEIVED", trace_id, span_id, tenant_id,
-                   "EOS signal received. Finalizing {} samples.",
-                   buffer.size());
-        RequestOptions options;
-        auto results = engine_->transcribe_pcm16(buffer, 16000, options);
-        for (const auto& res : results) {
-          if (!res.text.empty()) {
-            sentiric::stt::v1::WhisperTranscribeStreamResponse response;
-            response.set_transcription(res.text);
-            // [KRİTİK]: Cümle Bitti!
-            response.set_is_final(true);
-
-            const auto& aff = res.affective;
-            response.set_gender_proxy(aff.gender_proxy);
-            response.set_emotion_proxy(aff.emotion_proxy);
-            response.set_arousal(aff.arousal);
-            response.set_valence(aff.valence);
-            response.set_pitch_mean(aff.pitch_mean);
-            response.set_pitch_std(aff.pitch_std);
-            response.set_energy_mean(aff.energy_mean);
-            response.set_energy_std(aff.energy_std);
-            response.set_spectral_centroid(aff.spectral_centroid);
-            response.set_zero_crossing_rate(aff.zero_crossing_rate);
-            for (float v : aff.speaker_vec) response.add_speaker_vec(v);
-            response.set_speaker_id(res.speaker_id);
-
-            for (const auto& token : res.tokens) {
-              auto* word_data = response.add_words();
-              word_data->set_word(token.text);
-              word_data->set_start(static_cast<float>(token.t0) / 100.0f);
-              word_data->set_end(static_cast<float>(token.t1) / 100.0f);
-              word_data->set_probability(token.p);
-            }
-            stream->Write(response);
-            SUTS_INFO("STT_TRANSCRIPT_FINALIZED", trace_id, span_id, tenant_id,
-                      "✅ Final Sentence: '{}' [Spk: {}]", res.text,
-                      res.speaker_id);
-          }
-        }
-        // Cümle bitince yeni cümle için tamponu sıfırla
-        buffer.clear();
-        last_processed_size = 0;
-      }
-      continue;
-    }
-
-    const uint8_t* data_ptr = reinterpret_cast<const uint8_t*>(chunk.data());
-    size_t data_len = chunk.size();
-
-    if (is_first_chunk) {
-      if (has_wav_header(chunk)) {
-        is_wav_container = true;
-        if (chunk.size() > 44) wav_header_skip = 44;
-      }
-      is_first_chunk = false;
-    }
-
-    if (is_wav_container && wav_header_skip > 0) {
-      if (data_len >= wav_header_skip) {
-        data_ptr += wav_header_skip;
-        data_len -= wav_header_skip;
-        wav_header_skip = 0;
-      } else {
-        wav_header_skip -= data_len;
-        data_len = 0;
-      }
-    }
-
-    if (data_len > 0) {
-      size_t samples = data_len / 2;
-      size_t current_size = buffer.size();
-      buffer.resize(current_size + samples);
-      std::memcpy(buffer.data() + current_size, data_ptr, samples * 2);
-    }
-
-    // [YENİ]: TAMPONU TEMİZLEMEDEN (Partial) İŞLEME
-    if (buffer.size() - last_processed_size >= DYNAMIC_BUFFER_SIZE) {
-      RequestOptions options;
-      SttEngine::PerformanceMetrics perf;
-
-      try {
-        auto results = engine_->transcribe_pcm16(buffer, 16000, options, &perf);
-        last_processed_size = buffer.size();
-
-        // [MİMARİ DÜZELTME]: Partial mesajlarda (Kullanıcı hala konuşurken)
-        // Whisper birden fazla segment bulursa, UI bunları tek tek alıp ezmesin
-        // diye Hepsini tek bir string olarak birleştirip gönderiyoruz.
-        std::string combined_partial_text;
-        sentiric::stt::v1::WhisperTranscribeStreamResponse combined_response;
-        bool has_valid_data = false;
-
-        for (const auto& res : results) {
-          if (!res.text.empty()) {
-            combined_partial_text += res.text + " ";
-            has_valid_data = true;
-
-            // Son segmentin duygu durumunu ve vektörünü al (En güncel olan)
-            const auto& aff = res.affective;
-            combined_response.set_gender_proxy(aff.gender_proxy);
-            combined_response.set_emotion_proxy(aff.emotion_proxy);
-            combined_response.set_arousal(aff.arousal);
-            combined_response.set_valence(aff.valence);
-            combined_response.set_pitch_mean(aff.pitch_mean);
-            combined_response.set_pitch_std(aff.pitch_std);
-            combined_response.set_energy_mean(aff.energy_mean);
-            combined_response.set_energy_std(aff.energy_std);
-            combined_response.set_spectral_centroid(aff.spectral_centroid);
-            combined_response.set_zero_crossing_rate(aff.zero_crossing_rate);
-
-            combined_response.clear_speaker_vec();
-            for (float v : aff.speaker_vec)
-              combined_response.add_speaker_vec(v);
-
-            combined_response.set_speaker_id(res.speaker_id);
-          }
-        }
-
-        if (has_valid_data) {
-          combined_response.set_transcription(combined_partial_text);
-          combined_response.set_is_final(false);  // Hala konuşuyor
-          if (!stream->Write(combined_response)) {
-            return grpc::Status::OK;
-          }
-        }
+  std::unique_ptr<StreamAudioInput> audio_input;
+  std::string format_error;
+  if (!read_stream_audio_input(context, &audio_input, &format_error)) {
+    SUTS_WARN("STT_INVALID_AUDIO", tc.trace_id, tc.span_id, tc.tenant_id,
+              "Stream rejected: {}", format_error);
+    return new RejectedStreamReactor(
+        grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, format_error));
+  }
+  if (audio_input) {
+    SUTS_INFO("STT_STREAM_AUDIO_FORMAT", tc.trace_id, tc.span_id, tc.tenant_id,
+              "Stream input: {} @ {} Hz",
+              stream_encoding_name(audio_input->encoding()),
+              audio_input->sample_rate());
+  }
 
-        // [KRİTİK VERİ KAYBI ÇÖZÜMÜ]: OOM Koruması (30 Saniye Sınırı)
-        // Kullanıcı 30sn susmadan konuşursa, buffer'ı silmeden önce her şeyi
-        // FINAL olarak kaydet!
-        if (buffer.size() > MAX_BUFFER_SIZE) {
-          SUTS_WARN("STT_BUFFER_OVERFLOW", trace_id, span_id, tenant_id,
-                    "User spoke for 30s without breathing. Forcing "
-                    "finalization to prevent data loss.");
-
-          for (const auto& res : results) {
-            if (!res.text.empty()) {
-              sentiric::stt::v1::WhisperTranscribeStreamResponse final_resp;
-              final_resp.set_transcription(res.text);
-              final_resp.set_is_final(true);  // ZORLA FİNAL YAP
-
-              const auto& aff = res.affective;
-              final_resp.set_gender_proxy(aff.gender_proxy);
-              final_resp.set_emotion_proxy(aff.emotion_proxy);
-              final_resp.set_arousal(aff.arousal);
-              final_resp.set_valence(aff.valence);
-              final_resp.set_speaker_id(res.speaker_id);
-              for (float v : aff.speaker_vec) final_resp.add_speaker_vec(v);
-
-              stream->Write(final_resp);
-            }
-          }
-          buffer.clear();
-          last_processed_size = 0;
-        }
+  if (!engine_->is_ready()) {
+    return new RejectedStreamReactor(
+        grpc::Status(grpc::StatusCode::UNAVAILABLE, "Model not ready"));
+  }
 
-      } catch (const std::exception& e) {
-        SUTS_ERROR("STT_STREAM_ERROR", trace_id, span_id, tenant_id,
-                   "Streaming error: {}", e.what());
-      }
-    }
+  TenantLimiter::Lease lease;
+  try {
+    lease = engine_->tenant_limiter().admit(tc.tenant_id, 0.0);
+  } catch (const TenantQuotaException& e) {
+    SUTS_WARN("TENANT_QUOTA_EXCEEDED", tc.trace_id, tc.span_id, tc.tenant_id,
+              "Stream rejected, tenant quota exceeded: {}", e.reason());
+    return new RejectedStreamReactor(
+        grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, e.what(),
+                     "tenant_quota:" + e.reason()));
   }
 
-  SUTS_INFO("STT_STREAM_COMPLETED", trace_id, span_id, tenant_id,
-            "✅ gRPC Stream Connection closed cleanly.");
-  return grpc::Status::OK;
-}
\ No newline at end of file
+  return new TranscribeStreamReactor(engine_, metrics_, executor_,
+                                     ingest_executor_, std::move(tc),
+                                     std::move(lease), std::move(audio_input));
+}
@@ -4,28 +4,39 @@
 
 #include <memory>
 
+#include "engine_executor.h"
 #include "http_server.h"  // AppMetrics için
 #include "sentiric/stt/v1/whisper.grpc.pb.h"
 #include "stt_engine.h"
 
-class GrpcServer final : public sentiric::stt::v1::SttWhisperService::Service {
+// [MİMARİ]: Callback (Reactor) API. Okuma/yazma işlemleri bloklamaz; decode
+// işleri EngineExecutor'a devredilir. Boşta bekleyen stream'ler thread tutmaz.
+class GrpcServer final
+    : public sentiric::stt::v1::SttWhisperService::CallbackService {
  public:
   explicit GrpcServer(std::shared_ptr<SttEngine> engine, AppMetrics& metrics);
 
   // Tekil Dosya Transkripsiyonu
-  grpc::Status WhisperTranscribe(
-      grpc::ServerContext* context,
+  grpc::ServerUnaryReactor* WhisperTranscribe(
+      grpc::CallbackServerContext* context,
       const sentiric::stt::v1::WhisperTranscribeRequest* request,
       sentiric::stt::v1::WhisperTranscribeResponse* response) override;
 
   // Akış (Streaming) Transkripsiyonu
-  grpc::Status WhisperTranscribeStream(
-      grpc::ServerContext* context,
-      grpc::ServerReaderWriter<
-          sentiric::stt::v1::WhisperTranscribeStreamResponse,
-          sentiric::stt::v1::WhisperTranscribeStreamRequest>* stream) override;
+  grpc::ServerBidiReactor<sentiric::stt::v1::WhisperTranscribeStreamRequest,
+                          sentiric::stt::v1::WhisperTranscribeStreamResponse>*
+  WhisperTranscribeStream(grpc::CallbackServerContext* context) override;
 
  private:
+  grpc::Status transcribe_unary(
+      grpc::CallbackServerContext* context, const std::string& trace_id,
+      const std::string& span_id, const std::string& tenant_id,
+      const sentiric::stt::v1::WhisperTranscribeRequest* request,
+      sentiric::stt::v1::WhisperTranscribeResponse* response);
+
   std::shared_ptr<SttEngine> engine_;
   AppMetrics& metrics_;
-};
\ No newline at end of file
+  EngineExecutor executor_;  // Decode işleri (state kuyruğunda bekler)
+  // [YENİ]: Stream ses işleme (VAD, söz sonu); decode'lardan bağımsız
+  EngineExecutor ingest_executor_;
+};
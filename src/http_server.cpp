@@ -4,10 +4,15 @@
 #include <prometheus/text_serializer.h>
 
 #include <algorithm>
+#include <cmath>
+#include <functional>
 #include <sstream>
 
+#include "audio_decoder.h"
+#include "model_manager.h"
 #include "nlohmann/json.hpp"
 #include "suts_logger.h"
+#include "tenant_limiter.h"
 #include "utils.h"
 
 #ifndef APP_VERSION
@@ -17,6 +22,20 @@
 using json = nlohmann::json;
 using namespace sentiric::utils;
 
+namespace {
+// cpp-httplib >= 0.16 istemci bağlantısının kapandığını bildirir; daha eski
+// sürümlerde bağlantı kopması izlenemez (yalnızca MAX_DECODE_MS geçerli).
+template <typename Req>
+auto connection_closed_fn(const Req& req, int)
+    -> decltype(req.is_connection_closed, std::function<bool()>()) {
+  return req.is_connection_closed;
+}
+template <typename Req>
+std::function<bool()> connection_closed_fn(const Req&, long) {
+  return nullptr;
+}
+}  // namespace
+
 MetricsServer::MetricsServer(const std::string& host, int port,
                              prometheus::Registry& registry)
     : host_(host), port_(port), registry_(registry) {
@@ -65,6 +84,8 @@ void HttpServer::setup_routes() {
     bool ready = engine_->is_ready();
     json response = {{"status", ready ? "healthy" : "unhealthy"},
                      {"model_ready", ready},
+                     {"warming_up", !engine_->warmed_up()},
+                     {"model", engine_->model_status().active},
                      {"service", "sentiric-stt-whisper-service"},
                      {"version", APP_VERSION},
                      {"api_compatibility", "openai-whisper"}};
@@ -73,6 +94,70 @@ void HttpServer::setup_routes() {
     res.status = ready ? 200 : 503;
   });
 
+  // [YENİ]: Model hot swap. Yeni model arka planda yüklenir (202); yeni
+  // istekler hazır olunca ona geçer, eski model açık istek/stream'ler
+  // bitince serbest bırakılır. Durum GET ile izlenir.
+  const std::string admin_token = engine_->get_settings().admin_token;
+  if (!admin_token.empty()) {
+    auto authorized = [admin_token](const httplib::Request& req) {
+      return req.get_header_value("x-admin-token") == admin_token;
+    };
+
+    svr_.Get("/admin/model", [this, authorized](const httplib::Request& req,
+                                                httplib::Response& res) {
+      if (!authorized(req)) {
+        res.status = 401;
+        return;
+      }
+      SttEngine::ModelStatus st = engine_->model_status();
+      json response = {{"active", st.active},
+                       {"pending", st.pending},
+                       {"last_error", st.last_error},
+                       {"draining", st.draining}};
+      res.set_content(response.dump(), "application/json");
+    });
+
+    svr_.Post("/admin/model", [this, authorized](const httplib::Request& req,
+                                                 httplib::Response& res) {
+      if (!authorized(req)) {
+        res.status = 401;
+        return;
+      }
+      std::string filename;
+      try {
+        json body = json::parse(req.body);
+        if (body.contains("model"))
+          filename = body["model"].get<std::string>();
+        else if (body.contains("size"))
+          filename = "ggml-" + body["size"].get<std::string>() + ".bin";
+      } catch (...) {
+      }
+      // Sadece model dizinindeki dosya adları
+      if (!ModelManager::valid_model_filename(filename)) {
+        res.status = 400;
+        res.set_content(json{{"error", "Expected {\"model\": <filename>} "
+                                       "or {\"size\": <size>}"}}
+                            .dump(),
+                        "application/json");
+        return;
+      }
+      // Kontrol ve ayırma tek adımdır; eşzamanlı POST'lardan biri kazanır
+      if (!ModelManager::start_hot_swap(engine_, filename)) {
+        res.status = 409;
+        res.set_content(
+            json{{"error", "Model swap already in progress"}}.dump(),
+            "application/json");
+        return;
+      }
+
+      SUTS_INFO("MODEL_SWAP_REQUESTED", "", "", "",
+                "🔁 Model swap requested via admin API: {}", filename);
+      res.status = 202;
+      res.set_content(json{{"status", "loading"}, {"model", filename}}.dump(),
+                      "application/json");
+    });
+  }
+
   auto transcribe_handler = [this](const httplib::Request& req,
                                    httplib::Response& res) {
     res.set_header("Access-Control-Allow-Origin", "*");
@@ -111,6 +196,9 @@ void HttpServer::setup_routes() {
 
     const auto& file = req.get_file_value("file");
     RequestOptions opts;
+    opts.tenant_id = tenant_id;
+    // İstemci koparsa decode durur, state havuza döner
+    opts.should_abort = connection_closed_fn(req, 0);
 
     if (req.has_file("language"))
       opts.language = req.get_file_value("language").content;
@@ -158,12 +246,31 @@ void HttpServer::setup_routes() {
 
     try {
       auto start_time = std::chrono::steady_clock::now();
-      DecodedAudio audio = parse_wav_robust(file.content);
-      if (audio.pcm_data.empty())
+      DecodedAudio audio = decode_audio(
+          file.content,
+          static_cast<size_t>(engine_->get_settings().max_audio_duration_s) *
+              16000,
+          &metrics_.audio_decode_seconds);
+      if (audio.num_samples() == 0)
         throw std::runtime_error("Parsed WAV data is empty.");
 
+      // Kota kontrolü ses süresi belli olduktan sonra, motordan önce
+      auto lease = engine_->tenant_limiter().admit(
+          tenant_id, static_cast<double>(audio.num_samples()) /
+                         static_cast<double>(audio.sample_rate));
+
+      SttEngine::PerformanceMetrics perf;
       auto results =
-          engine_->transcribe_pcm16(audio.pcm_data, audio.sample_rate, opts);
+          audio.pcm_f32.empty()
+              ? engine_->transcribe_pcm16(audio.pcm_data, audio.sample_rate,
+                                          opts, &perf)
+              : engine_->transcribe(audio.pcm_f32, audio.sample_rate, opts,
+                                    &perf);
+      if (opts.should_abort && opts.should_abort()) {
+        SUTS_WARN("STT_CLIENT_DISCONNECTED", trace_id, span_id, tenant_id,
+                  "Client disconnected; transcription discarded.");
+        return;
+      }
       auto end_time = std::chrono::steady_clock::now();
       std::chrono::duration<double> processing_time = end_time - start_time;
 
@@ -204,7 +311,7 @@ void HttpServer::setup_routes() {
                             {"speaker_vec", aff.speaker_vec},
                             {"words", words_json}});
       }
-      double duration = static_cast<double>(audio.pcm_data.size()) /
+      double duration = static_cast<double>(audio.num_samples()) /
                         static_cast<double>(audio.sample_rate);
 
       metrics_.audio_seconds_processed_total.Increment(duration);
@@ -221,8 +328,31 @@ void HttpServer::setup_routes() {
             {"rtf", processing_time.count() / (duration > 0 ? duration : 1.0)},
             {"input_sr", audio.sample_rate},
             {"input_channels", audio.channels},
-            {"tokens", total_tokens}}}};
+            {"tokens", total_tokens},
+            {"degrade_level", perf.degrade_level},
+            {"decode_strategy",
+             SttEngine::decode_strategy_name(perf.degrade_level)}}}};
       res.set_content(response.dump(), "application/json");
+    } catch (const TenantQuotaException& e) {
+      SUTS_WARN("TENANT_QUOTA_EXCEEDED", trace_id, span_id, tenant_id,
+                "Tenant quota exceeded: {}", e.reason());
+      res.status = 429;
+      res.set_header("Retry-After",
+                     std::to_string(static_cast<int>(
+                         std::ceil(e.retry_after_s()))));
+      res.set_content(
+          json{{"error", e.what()}, {"reason", e.reason()}}.dump(),
+          "application/json");
+    } catch (const AudioTooLongException& e) {
+      SUTS_WARN("STT_AUDIO_TOO_LONG", trace_id, span_id, tenant_id,
+                "Upload rejected: {}", e.what());
+      res.status = 413;
+      res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+    } catch (const EngineBusyException& e) {
+      SUTS_WARN("ENGINE_BUSY", trace_id, span_id, tenant_id,
+                "Engine busy: {}", e.what());
+      res.status = 503;
+      res.set_content(json{{"error", e.what()}}.dump(), "application/json");
     } catch (const std::exception& e) {
       SUTS_ERROR("TRANSCRIPTION_ERROR", trace_id, span_id, tenant_id,
                  "Transcription error: {}", e.what());
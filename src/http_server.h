@@ -1,6 +1,7 @@
 #pragma once
 
 #include <prometheus/counter.h>
+#include <prometheus/family.h>
 #include <prometheus/gauge.h>
 #include <prometheus/histogram.h>
 #include <prometheus/registry.h>
@@ -18,6 +19,9 @@ struct AppMetrics {
   prometheus::Histogram& request_latency;
   prometheus::Counter& audio_seconds_processed_total;
   prometheus::Counter& tokens_generated_total;  // YENİ: Token Throughput
+  prometheus::Gauge& active_streams;            // Açık gRPC stream sayısı
+  // Yükleme çözümleme süresi (format, decoder etiketleri)
+  prometheus::Family<prometheus::Histogram>& audio_decode_seconds;
 };
 
 class MetricsServer {
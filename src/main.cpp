@@ -3,6 +3,8 @@
 #include <grpcpp/health_check_service_interface.h>
 #include <spdlog/sinks/stdout_sinks.h>
 
+#include <atomic>
+#include <chrono>
 #include <csignal>
 #include <fstream>
 #include <future>
@@ -16,6 +18,7 @@
 #include "model_manager.h"
 #include "stt_engine.h"
 #include "suts_logger.h"
+#include "utils.h"
 
 #ifndef APP_VERSION
 #define APP_VERSION "unknown"
@@ -23,6 +26,7 @@
 
 namespace {
 std::promise<void> shutdown_promise;
+std::atomic<bool> reload_requested{false};
 }
 
 void signal_handler(int signal) {
@@ -34,6 +38,17 @@ void signal_handler(int signal) {
   }
 }
 
+// SIGHUP: model_swap_file'daki modele hot swap (ana döngüde işlenir)
+void reload_handler(int) { reload_requested.store(true); }
+
+// Swap dosyasının ilk satırı; okunamazsa boş
+std::string read_swap_target(const std::string& path) {
+  std::ifstream file(path);
+  std::string line;
+  if (file.is_open()) std::getline(file, line);
+  return sentiric::utils::trim(line);
+}
+
 void whisper_log_cb(ggml_log_level level, const char* text, void* user_data) {
   (void)user_data;
   std::string msg(text);
@@ -71,6 +86,7 @@ int main() {
   whisper_log_set(whisper_log_cb, nullptr);
   signal(SIGINT, signal_handler);
   signal(SIGTERM, signal_handler);
+  signal(SIGHUP, reload_handler);
 
   auto settings = load_settings();
   spdlog::set_level(spdlog::level::from_str(settings.log_level));
@@ -84,6 +100,15 @@ int main() {
   try {
     SUTS_INFO("MODEL_CHECK", "", "", "", "📦 Checking models...");
     ModelManager::ensure_model(settings);
+    // Hızlı model isteğe bağlıdır; sağlanamazsa partial'lar ana modelde
+    try {
+      ModelManager::ensure_fast_model(settings);
+    } catch (const std::exception& e) {
+      SUTS_WARN("FAST_MODEL_UNAVAILABLE", "", "", "",
+                "⚠️ Fast model '{}' unavailable, partials use main model: {}",
+                settings.fast_model_filename, e.what());
+      settings.fast_model_filename.clear();
+    }
     if (settings.enable_vad) {
       ModelManager::ensure_vad_model(settings);
     }
@@ -115,10 +140,130 @@ int main() {
                          .Register(*registry)
                          .Add({});
 
-  AppMetrics metrics = {req_total, req_latency, audio_sec, tokens_gen};
+  auto& active_streams = prometheus::BuildGauge()
+                             .Name("stt_active_streams")
+                             .Register(*registry)
+                             .Add({});
+
+  auto& audio_decode = prometheus::BuildHistogram()
+                           .Name("stt_audio_decode_seconds")
+                           .Register(*registry);
+
+  AppMetrics metrics = {req_total,  req_latency,    audio_sec,
+                        tokens_gen, active_streams, audio_decode};
+
+  auto& vad_pool_size = prometheus::BuildGauge()
+                            .Name("stt_vad_pool_size")
+                            .Register(*registry)
+                            .Add({});
+  auto& vad_pool_in_use = prometheus::BuildGauge()
+                              .Name("stt_vad_pool_in_use")
+                              .Register(*registry)
+                              .Add({});
+  prometheus::Histogram::BucketBoundaries wait_buckets{
+      0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0};
+  auto& vad_wait = prometheus::BuildHistogram()
+                       .Name("stt_vad_wait_seconds")
+                       .Register(*registry)
+                       .Add({}, wait_buckets);
+  auto& vad_timeouts = prometheus::BuildCounter()
+                           .Name("stt_vad_acquire_timeouts_total")
+                           .Register(*registry)
+                           .Add({});
+
+  prometheus::Histogram::BucketBoundaries batch_buckets{1, 2, 4, 8, 16};
+  auto& coalesce_batch = prometheus::BuildHistogram()
+                             .Name("stt_coalesce_batch_size")
+                             .Register(*registry)
+                             .Add({}, batch_buckets);
+  auto& coalesced_total = prometheus::BuildCounter()
+                              .Name("stt_coalesced_requests_total")
+                              .Register(*registry)
+                              .Add({});
+
+  auto& audio_ctx_family = prometheus::BuildCounter()
+                               .Name("stt_audio_ctx_bucket_total")
+                               .Register(*registry);
+
+  auto& state_depth = prometheus::BuildGauge()
+                          .Name("stt_state_queue_depth")
+                          .Register(*registry);
+  auto& state_wait = prometheus::BuildHistogram()
+                         .Name("stt_state_wait_seconds")
+                         .Register(*registry);
+  auto& state_timeouts = prometheus::BuildCounter()
+                             .Name("stt_state_queue_timeouts_total")
+                             .Register(*registry);
+  auto& state_dropped = prometheus::BuildCounter()
+                            .Name("stt_state_dropped_total")
+                            .Register(*registry);
+  auto& pool_size = prometheus::BuildGauge()
+                        .Name("stt_state_pool_size")
+                        .Register(*registry)
+                        .Add({});
+  auto& pool_max = prometheus::BuildGauge()
+                       .Name("stt_state_pool_max")
+                       .Register(*registry)
+                       .Add({});
+  auto& state_bytes = prometheus::BuildGauge()
+                          .Name("stt_state_bytes")
+                          .Register(*registry)
+                          .Add({});
+  auto& pool_events = prometheus::BuildCounter()
+                          .Name("stt_state_pool_events_total")
+                          .Register(*registry);
+  auto& tenant_rejected = prometheus::BuildCounter()
+                              .Name("stt_tenant_rejected_total")
+                              .Register(*registry);
+  auto& tenant_active = prometheus::BuildGauge()
+                            .Name("stt_tenant_active_requests")
+                            .Register(*registry);
+  auto& tenant_audio = prometheus::BuildCounter()
+                           .Name("stt_tenant_audio_seconds_total")
+                           .Register(*registry);
+  auto& degrade_level = prometheus::BuildGauge()
+                            .Name("stt_decode_degrade_level")
+                            .Register(*registry)
+                            .Add({});
+  auto& degraded_total = prometheus::BuildCounter()
+                             .Name("stt_decode_degraded_total")
+                             .Register(*registry);
+  auto& gate_segments = prometheus::BuildCounter()
+                            .Name("stt_decode_gate_segments_total")
+                            .Register(*registry);
+  auto& guard_total = prometheus::BuildCounter()
+                          .Name("stt_decode_guard_total")
+                          .Register(*registry);
+  auto& aborted_total = prometheus::BuildCounter()
+                            .Name("stt_decode_aborted_total")
+                            .Register(*registry);
+  auto& warmup_seconds = prometheus::BuildGauge()
+                             .Name("stt_warmup_seconds")
+                             .Register(*registry);
+  auto& load_seconds = prometheus::BuildGauge()
+                           .Name("stt_model_load_seconds")
+                           .Register(*registry);
+  auto& rss_bytes = prometheus::BuildGauge()
+                        .Name("stt_process_rss_bytes")
+                        .Register(*registry)
+                        .Add({});
+
+  EngineMetrics engine_metrics = {vad_pool_size,    vad_pool_in_use,
+                                  vad_wait,         vad_timeouts,
+                                  coalesce_batch,   coalesced_total,
+                                  audio_ctx_family, state_depth,
+                                  state_wait,       state_timeouts,
+                                  state_dropped,    pool_size,
+                                  pool_max,         state_bytes,
+                                  pool_events,      tenant_rejected,
+                                  tenant_active,    tenant_audio,
+                                  degrade_level,    degraded_total,
+                                  gate_segments,    guard_total,
+                                  aborted_total,    warmup_seconds,
+                                  load_seconds,     rss_bytes};
 
   try {
-    auto engine = std::make_shared<SttEngine>(settings);
+    auto engine = std::make_shared<SttEngine>(settings, &engine_metrics);
 
     grpc::EnableDefaultHealthCheckService(true);
 
@@ -155,9 +300,33 @@ int main() {
     std::thread http_thread([&]() { http_server.run(); });
     std::thread metrics_thread([&]() { metrics_server.run(); });
 
+    // Isınma bitene kadar /health 503, gRPC health NOT_SERVING döner
+    if (settings.warmup_enabled) {
+      auto* health = grpc_server->GetHealthCheckService();
+      if (health) health->SetServingStatus(false);
+      engine->warm_up();
+      if (health) health->SetServingStatus(true);
+    }
+
     SUTS_INFO("ALL_SERVERS_READY", "", "", "", "✅ Service Ready!");
 
-    shutdown_promise.get_future().wait();
+    auto shutdown = shutdown_promise.get_future();
+    while (shutdown.wait_for(std::chrono::seconds(1)) !=
+           std::future_status::ready) {
+      if (!reload_requested.exchange(false)) continue;
+      std::string target = read_swap_target(settings.model_swap_file);
+      if (!ModelManager::valid_model_filename(target)) {
+        SUTS_WARN("MODEL_SWAP_INVALID", "", "", "",
+                  "⚠️ SIGHUP ignored: no valid model name in {}",
+                  settings.model_swap_file);
+      } else if (target == engine->model_status().active) {
+        SUTS_INFO("MODEL_SWAP_NOOP", "", "", "",
+                  "SIGHUP: model {} already active", target);
+      } else if (!ModelManager::start_hot_swap(engine, target)) {
+        SUTS_WARN("MODEL_SWAP_BUSY", "", "", "",
+                  "⚠️ SIGHUP ignored: model swap already in progress");
+      }
+    }
 
     SUTS_INFO("SERVER_STOPPING", "", "", "", "Stopping servers...");
     grpc_server->Shutdown();
@@ -0,0 +1,38 @@
+#include "memory_info.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+namespace {
+// Sınırsız v1 cgroup'lar sayfa hizalı LONG_MAX yazar
+constexpr size_t kUnlimited = static_cast<size_t>(1) << 60;
+
+size_t read_limit(const char* path) {
+  std::ifstream in(path);
+  std::string value;
+  if (!(in >> value) || value == "max") return 0;
+  try {
+    const size_t limit = static_cast<size_t>(std::stoull(value));
+    return limit >= kUnlimited ? 0 : limit;
+  } catch (...) {
+    return 0;
+  }
+}
+}  // namespace
+
+size_t process_rss_bytes() {
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  if (!(statm >> total_pages >> resident_pages)) return 0;
+  return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+size_t cgroup_memory_limit_bytes() {
+  size_t limit = read_limit("/sys/fs/cgroup/memory.max");
+  if (limit == 0)
+    limit = read_limit("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+  return limit;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+
+// /proc/self/statm'den yerleşik bellek (bayt); okunamazsa 0
+size_t process_rss_bytes();
+
+// Konteynerin cgroup bellek sınırı (v2 memory.max, yoksa v1
+// memory.limit_in_bytes). Sınır yoksa ya da okunamazsa 0.
+size_t cgroup_memory_limit_bytes();
@@ -6,14 +6,26 @@
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <thread>
 #include <vector>
 
 #include "spdlog/spdlog.h"
+#include "stt_engine.h"
 
 namespace fs = std::filesystem;
 
 std::string ModelManager::ensure_model(const Settings& settings) {
-  std::string model_name = settings.model_filename;
+  return ensure_whisper_model(settings, settings.model_filename);
+}
+
+std::string ModelManager::ensure_fast_model(const Settings& settings) {
+  if (settings.fast_model_filename.empty()) return "";
+  return ensure_whisper_model(settings, settings.fast_model_filename);
+}
+
+std::string ModelManager::ensure_whisper_model(const Settings& settings,
+                                               const std::string& filename) {
+  std::string model_name = filename;
   if (model_name.rfind("ggml-", 0) == 0) model_name.replace(0, 5, "");
   if (model_name.length() >= 4 &&
       model_name.substr(model_name.length() - 4) == ".bin")
@@ -26,8 +38,7 @@ std::string ModelManager::ensure_model(const Settings& settings) {
     url.replace(pos, placeholder.length(), model_name);
   }
 
-  return ensure_file(settings.model_dir, settings.model_filename, url,
-                     1024 * 1024);
+  return ensure_file(settings.model_dir, filename, url, 1024 * 1024);
 }
 
 std::string ModelManager::ensure_vad_model(const Settings& settings) {
@@ -36,6 +47,40 @@ std::string ModelManager::ensure_vad_model(const Settings& settings) {
                      settings.vad_model_url, 100 * 1024);
 }
 
+bool ModelManager::valid_model_filename(const std::string& filename) {
+  return !filename.empty() && filename.find('/') == std::string::npos &&
+         filename.find("..") == std::string::npos;
+}
+
+bool ModelManager::start_hot_swap(std::shared_ptr<SttEngine> engine,
+                                  const std::string& filename) {
+  if (!engine->begin_swap(filename)) return false;
+  spdlog::info("🔁 Hot swap requested: {}", filename);
+  std::thread([engine = std::move(engine), filename] {
+    run_hot_swap(*engine, filename);
+  }).detach();
+  return true;
+}
+
+void ModelManager::run_hot_swap(SttEngine& engine,
+                                const std::string& filename) {
+  try {
+    ensure_whisper_model(engine.get_settings(), filename);
+  } catch (const std::exception& e) {
+    engine.abort_swap(e.what());
+    spdlog::error("❌ Hot swap to {} failed, keeping current model: {}",
+                  filename, e.what());
+    return;
+  }
+  try {
+    // Hata durumunda swap_model ayrımı kendisi bırakır
+    engine.swap_model(filename);
+  } catch (const std::exception& e) {
+    spdlog::error("❌ Hot swap to {} failed, keeping current model: {}",
+                  filename, e.what());
+  }
+}
+
 std::string ModelManager::ensure_file(const std::string& dir,
                                       const std::string& filename,
                                       const std::string& url,
@@ -63,17 +108,33 @@ std::string ModelManager::ensure_file(const std::string& dir,
 
   spdlog::info("⬇️ Downloading: {} from {}", filename, url);
 
-  if (download_file(url, model_path.string())) {
-    size_t size = fs::file_size(model_path);
-    if (size > min_size_bytes) {
-      spdlog::info("✅ Download complete: {}", filename);
-      return model_path.string();
+  // [YENİ]: İndirme aynı dizinde benzersiz geçici dosyaya yapılır ve ancak
+  // doğrulandıktan sonra rename() ile yerine konur; yarım dosya asla model
+  // adıyla görünmez (eşzamanlı indirme veya aynı dizini paylaşan replika)
+  std::string tmp_path = model_path.string() + ".part.XXXXXX";
+  int fd = mkstemp(tmp_path.data());
+  if (fd < 0)
+    throw std::runtime_error("Cannot create temp file for " + filename);
+  close(fd);
+
+  if (download_file(url, tmp_path)) {
+    std::error_code ec;
+    size_t size = fs::file_size(tmp_path, ec);
+    if (!ec && size > min_size_bytes) {
+      fs::rename(tmp_path, model_path, ec);
+      if (!ec) {
+        spdlog::info("✅ Download complete: {}", filename);
+        return model_path.string();
+      }
+      spdlog::error("❌ Cannot move download into place: {}", ec.message());
     } else {
       spdlog::error("❌ Downloaded file is too small ({} bytes).", size);
-      fs::remove(model_path);
-      throw std::runtime_error("Download failed validation: " + filename);
     }
+    fs::remove(tmp_path, ec);
+    throw std::runtime_error("Download failed validation: " + filename);
   } else {
+    std::error_code ec;
+    fs::remove(tmp_path, ec);
     spdlog::error("❌ Failed to download: {}", filename);
     throw std::runtime_error("Download failed: " + filename);
   }
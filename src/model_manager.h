@@ -1,14 +1,36 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include "config.h"
 
+class SttEngine;
+
 class ModelManager {
  public:
   // Ana modeli (Whisper) kontrol eder/indirir
   static std::string ensure_model(const Settings& settings);
 
+  // Partial'lar için hızlı modeli kontrol eder/indirir (ayarlı değilse "")
+  static std::string ensure_fast_model(const Settings& settings);
+
+  // Whisper ggml dosyasını model_url_template ile çözülen adresten sağlar
+  // (hot swap hedefleri için de kullanılır)
+  static std::string ensure_whisper_model(const Settings& settings,
+                                          const std::string& filename);
+
+  // Hot swap hedefi model dizinindeki düz bir dosya adı mı (boş değil, "/"
+  // ve ".." yok). Admin uç noktası ve SIGHUP aynı kontrolü kullanır.
+  static bool valid_model_filename(const std::string& filename);
+
+  // [YENİ]: Swap'ı engine'de ayırır ve arka plan thread'inde modeli sağlayıp
+  // (gerekirse indirir) engine'i ona geçirir. Başka swap sürüyorsa false
+  // döner; kontrol ve ayırma tek adımdır. Sonuç loglanır ve model_status()
+  // ile görülür.
+  static bool start_hot_swap(std::shared_ptr<SttEngine> engine,
+                             const std::string& filename);
+
   // VAD modelini (Silero) kontrol eder/indirir
   static std::string ensure_vad_model(const Settings& settings);
 
@@ -19,6 +41,9 @@ class ModelManager {
                                  const std::string& url,
                                  size_t min_size_bytes = 1024 * 1024);
 
+  // begin_swap ile ayrılmış swap'ı tamamlar (ya da abort_swap ile bırakır)
+  static void run_hot_swap(SttEngine& engine, const std::string& filename);
+
   static bool download_file(const std::string& url,
                             const std::string& filepath);
 };
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "request_coalescer.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "suts_logger.h"
+
+RequestCoalescer::RequestCoalescer(DecodeFn decode_fn, const Settings& settings,
+                                   EngineMetrics* metrics,
+                                   WaitersFn has_waiters)
+    : decode_fn_(std::move(decode_fn)),
+      has_waiters_(std::move(has_waiters)),
+      metrics_(metrics),
+      max_wait_(std::max(0, settings.coalesce_max_wait_ms)),
+      max_utterance_samples_(
+          static_cast<size_t>(std::max(0, settings.coalesce_max_utterance_ms)) *
+          16),
+      gap_samples_(static_cast<size_t>(std::max(0, settings.coalesce_gap_ms)) *
+                   16),
+      max_batch_(
+          static_cast<size_t>(std::max(1, settings.coalesce_max_batch))) {}
+
+bool RequestCoalescer::accepts(size_t n_samples) const {
+  return n_samples > 0 && n_samples <= max_utterance_samples_ &&
+         n_samples <= kWindowSamples;
+}
+
+CoalescedResult RequestCoalescer::submit(const float* pcm, size_t n_samples,
+                                         const DecodeParams& params,
+                                         CoalesceContext context) {
+  auto item = std::make_unique<Item>();
+  item->pcm.assign(pcm, pcm + n_samples);
+  item->context = std::move(context);
+  item->submitted = std::chrono::steady_clock::now();
+  std::future<CoalescedResult> future = item->promise.get_future();
+
+  std::unique_lock<std::mutex> lock(mu_);
+  ++in_flight_;
+  // Sonuç (ya da exception) alınınca uçuştaki istek sayısı düşer
+  auto await = [this, &future] {
+    struct Leave {
+      RequestCoalescer* self;
+      ~Leave() {
+        std::lock_guard<std::mutex> guard(self->mu_);
+        --self->in_flight_;
+      }
+    } leave{this};
+    return future.get();
+  };
+
+  // 1. Açık ve uyumlu bir pencereye katıl (takipçi)
+  for (auto& batch : open_batches_) {
+    if (batch->full || !(batch->params == params) ||
+        batch->model != item->context.model)
+      continue;
+    size_t needed = batch->total_samples + gap_samples_ + n_samples;
+    if (needed > kWindowSamples) continue;
+
+    item->offset = batch->total_samples + gap_samples_;
+    batch->total_samples = needed;
+    batch->items.push_back(std::move(item));
+    if (batch->items.size() >= max_batch_ ||
+        batch->total_samples + gap_samples_ >= kWindowSamples) {
+      batch->full = true;
+      cv_.notify_all();
+    }
+    lock.unlock();
+    return await();
+  }
+
+  // 2. Yeni pencere aç (lider): dolana ya da süre bitene kadar bekle
+  auto batch = std::make_shared<Batch>();
+  batch->params = params;
+  batch->model = item->context.model;
+  batch->total_samples = n_samples;
+  batch->items.push_back(std::move(item));
+  // Katılabilecek başka istek yoksa beklemek yalnızca gecikme ekler
+  const bool alone =
+      in_flight_ == 1 && !(has_waiters_ && batch->model &&
+                           has_waiters_(*batch->model));
+  batch->full = max_batch_ <= 1 || alone;
+  open_batches_.push_back(batch);
+
+  cv_.wait_until(lock, batch->items.front()->submitted + max_wait_,
+                 [&batch] { return batch->full; });
+  open_batches_.erase(
+      std::find(open_batches_.begin(), open_batches_.end(), batch));
+  lock.unlock();
+
+  // Pencere listeden çıktı; artık kimse items'a dokunmaz
+  run(*batch);
+  return await();
+}
+
+void RequestCoalescer::run(Batch& batch) {
+  std::vector<float> packed(batch.total_samples, 0.0f);
+  for (const auto& item : batch.items)
+    std::copy(item->pcm.begin(), item->pcm.end(),
+              packed.begin() + static_cast<std::ptrdiff_t>(item->offset));
+
+  // Lider modeli ve tenant'ı; pencere ancak tüm üyeler giderse iptal olur
+  CoalesceContext context;
+  context.model = batch.model;
+  context.tenant_id = batch.items.front()->context.tenant_id;
+  for (const auto& item : batch.items)
+    context.members.emplace_back(
+        item->context.tenant_id,
+        static_cast<double>(item->pcm.size()) / 16000.0);
+  const bool abortable = std::all_of(
+      batch.items.begin(), batch.items.end(),
+      [](const auto& item) { return !!item->context.should_abort; });
+  if (abortable) {
+    context.should_abort = [&batch] {
+      return std::all_of(
+          batch.items.begin(), batch.items.end(),
+          [](const auto& item) { return item->context.should_abort(); });
+    };
+  }
+
+  auto t_start = std::chrono::steady_clock::now();
+  std::vector<DecodedSegment> segments;
+  bool ok = false;
+  try {
+    ok = decode_fn_(packed.data(), packed.size(), batch.params, context,
+                    &segments);
+  } catch (...) {
+    std::exception_ptr error = std::current_exception();
+    for (auto& item : batch.items) item->promise.set_exception(error);
+    return;
+  }
+  auto t_end = std::chrono::steady_clock::now();
+
+  std::vector<std::vector<DecodedSegment>> per_item =
+      ok ? split(batch, segments)
+         : std::vector<std::vector<DecodedSegment>>(batch.items.size());
+
+  if (metrics_) {
+    metrics_->coalesce_batch_size.Observe(
+        static_cast<double>(batch.items.size()));
+    metrics_->coalesced_requests_total.Increment(
+        static_cast<double>(batch.items.size()));
+  }
+  if (batch.items.size() > 1) {
+    SUTS_DEBUG("STT_REQUESTS_COALESCED", "", "", "",
+               "{} requests decoded in one window ({:.1f}s of audio)",
+               batch.items.size(), batch.total_samples / 16000.0);
+  }
+
+  const double decode_ms =
+      std::chrono::duration<double, std::milli>(t_end - t_start).count();
+  for (size_t i = 0; i < batch.items.size(); ++i) {
+    Item& item = *batch.items[i];
+    CoalescedResult res;
+    res.segments = std::move(per_item[i]);
+    res.wait_ms = std::chrono::duration<double, std::milli>(t_start -
+                                                            item.submitted)
+                      .count();
+    res.decode_ms = decode_ms;
+    res.batch_size = batch.items.size();
+    item.promise.set_value(std::move(res));
+  }
+}
+
+std::vector<std::vector<DecodedSegment>> RequestCoalescer::split(
+    const Batch& batch, const std::vector<DecodedSegment>& segments) const {
+  const size_t n_items = batch.items.size();
+  std::vector<std::vector<DecodedSegment>> out(n_items);
+
+  // Sınır, iki ses arasındaki sessizliğin ortasıdır
+  auto owner_of = [&](size_t sample) {
+    size_t i = 0;
+    while (i + 1 < n_items &&
+           sample + gap_samples_ / 2 >= batch.items[i + 1]->offset)
+      ++i;
+    return i;
+  };
+
+  // Whisper aralıkları aşan tek bir segment üretebilir; bu yüzden dağıtım
+  // segment değil token düzeyinde yapılır.
+  for (const auto& seg : segments) {
+    size_t current = n_items;
+    for (const auto& tok : seg.tokens) {
+      int64_t mid_cs = std::max<int64_t>(0, (tok.t0 + tok.t1) / 2);
+      size_t owner = owner_of(static_cast<size_t>(mid_cs) * 160);
+      if (owner != current) {
+        if (current < n_items) out[current].back().speaker_turn_next = false;
+        out[owner].push_back({"", 0, 0, seg.speaker_turn_next, {}});
+        current = owner;
+      }
+
+      const Item& item = *batch.items[owner];
+      const int64_t offset_cs = static_cast<int64_t>(item.offset / 160);
+      const int64_t length_cs = static_cast<int64_t>(item.pcm.size() / 160);
+      TokenData local = tok;
+      local.t0 = std::clamp<int64_t>(tok.t0 - offset_cs, 0, length_cs);
+      local.t1 = std::clamp<int64_t>(tok.t1 - offset_cs, local.t0, length_cs);
+
+      DecodedSegment& piece = out[owner].back();
+      piece.text += local.text;
+      piece.tokens.push_back(std::move(local));
+    }
+  }
+
+  for (auto& item_segments : out) {
+    for (auto& piece : item_segments) {
+      piece.t0 = piece.tokens.front().t0;
+      piece.t1 = piece.tokens.back().t1;
+    }
+  }
+  return out;
+}
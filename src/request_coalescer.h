@@ -0,0 +1,107 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "engine_metrics.h"
+#include "stt_engine.h"
+
+// Birleştirilmiş bir isteğin sonucu. Segment ve token zamanları isteğin kendi
+// sesine göredir (centisaniye).
+struct CoalescedResult {
+  std::vector<DecodedSegment> segments;
+  double wait_ms = 0;    // Pencerenin kapanmasını + state beklemesi
+  double decode_ms = 0;  // Paylaşılan whisper_full süresi
+  size_t batch_size = 1;
+};
+
+// Pencereyi çözmek için istek bağlamı. Pencereye yalnızca aynı modeli tutan
+// istekler girer; state liderin tenant'ı adına alınır. run() should_abort'u
+// üyelerin hepsi iptal ettiğinde true dönecek şekilde birleştirir.
+struct CoalesceContext {
+  std::shared_ptr<LoadedModel> model;
+  std::string tenant_id;
+  std::function<bool()> should_abort;
+  // run() doldurur: üyelerin (lider ilk) tenant'ı ve ses süresi (sn). Her
+  // tenant WFQ'da yalnızca kendi sesi kadar ilerletilir.
+  std::vector<std::pair<std::string, double>> members;
+};
+
+// [YENİ]: Kısa istek birleştirici (Request Coalescing)
+// Whisper her geçişte 30sn'lik mel penceresi kodlar; 1-3sn'lik telefon
+// cümlelerinde geçişin çoğu dolgudur. Aynı DecodeParams'a sahip kısa istekler
+// en fazla max_wait_ms boyunca toplanır, aralarına sessizlik konarak tek
+// tampona dizilir ve tek whisper_full ile çözülür. Segmentler token zaman
+// damgalarına göre sahibi olan isteğe geri dağıtılır.
+//
+// Ayrı dispatcher thread'i yoktur: pencereyi açan istek (lider) bekler,
+// pencereyi kapatır ve decode'u kendi thread'inde çalıştırır; diğerleri
+// sonucu bekler. Eşzamanlılık yine state havuzuyla sınırlıdır. Lider tek
+// başınaysa (uçuşta başka birleştirilebilir istek ve state bekleyen yok)
+// pencere beklemeden kapanır; gecikme yalnızca yük altında eklenir.
+class RequestCoalescer {
+ public:
+  // Birleştirilmiş tamponu çözer; başarısızlıkta false döner. Exception
+  // (örn. EngineBusyException) pencere üyelerinin hepsine iletilir.
+  using DecodeFn = std::function<bool(
+      const float* pcm, size_t n_samples, const DecodeParams& params,
+      const CoalesceContext& context, std::vector<DecodedSegment>* out)>;
+
+  // Modelin state kuyruğunda bekleyen istek var mı
+  using WaitersFn = std::function<bool(const LoadedModel& model)>;
+
+  // Whisper penceresi 30sn; son token'ların kesilmemesi için pay bırakılır
+  static constexpr size_t kWindowSamples = 29 * 16000;
+
+  RequestCoalescer(DecodeFn decode_fn, const Settings& settings,
+                   EngineMetrics* metrics = nullptr,
+                   WaitersFn has_waiters = nullptr);
+
+  // Bu ses birleştirmeye uygun mu (uzunluk sınırı)
+  bool accepts(size_t n_samples) const;
+
+  // 16kHz sesi uyumlu bir pencereye ekler ve sonucu bekler (bloklar)
+  CoalescedResult submit(const float* pcm, size_t n_samples,
+                         const DecodeParams& params, CoalesceContext context);
+
+ private:
+  struct Item {
+    std::vector<float> pcm;
+    size_t offset = 0;  // Paketlenmiş tampondaki başlangıç
+    CoalesceContext context;
+    std::chrono::steady_clock::time_point submitted;
+    std::promise<CoalescedResult> promise;
+  };
+
+  struct Batch {
+    DecodeParams params;
+    std::shared_ptr<LoadedModel> model;
+    std::vector<std::unique_ptr<Item>> items;
+    size_t total_samples = 0;
+    bool full = false;
+  };
+
+  void run(Batch& batch);
+  std::vector<std::vector<DecodedSegment>> split(
+      const Batch& batch, const std::vector<DecodedSegment>& segments) const;
+
+  DecodeFn decode_fn_;
+  WaitersFn has_waiters_;
+  EngineMetrics* metrics_;
+  std::chrono::milliseconds max_wait_;
+  size_t max_utterance_samples_;
+  size_t gap_samples_;
+  size_t max_batch_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::vector<std::shared_ptr<Batch>> open_batches_;
+  size_t in_flight_ = 0;  // submit içindeki istekler (mu_ altında)
+};
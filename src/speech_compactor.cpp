@@ -0,0 +1,61 @@
+#include "speech_compactor.h"
+
+#include <algorithm>
+
+size_t CompactedAudio::to_original_sample(size_t compact_sample) const {
+  if (spans.empty()) return compact_sample;
+  // Örneği içeren son parçayı bul (parçalar compact_start'a göre sıralı)
+  auto it = std::upper_bound(
+      spans.begin(), spans.end(), compact_sample,
+      [](size_t s, const CompactSpan& span) { return s < span.compact_start; });
+  const CompactSpan& span = (it == spans.begin()) ? spans.front() : *(it - 1);
+  size_t delta = compact_sample > span.compact_start
+                     ? compact_sample - span.compact_start
+                     : 0;
+  return span.orig_start + std::min(delta, span.length);
+}
+
+int64_t CompactedAudio::to_original_cs(int64_t compact_cs) const {
+  // 1cs = 160 örnek (16kHz)
+  size_t sample = static_cast<size_t>(std::max<int64_t>(0, compact_cs)) * 160;
+  return static_cast<int64_t>(to_original_sample(sample) / 160);
+}
+
+CompactedAudio compact_speech(const float* pcm, size_t n_samples,
+                              const std::vector<float>& probs,
+                              size_t frame_samples, float threshold,
+                              size_t pad_samples, size_t min_gap_samples) {
+  CompactedAudio out;
+  if (!pcm || n_samples == 0 || probs.empty() || frame_samples == 0)
+    return out;
+
+  // 1. Eşik üstü çerçeveleri pad'li örnek aralıklarına çevir ve birleştir
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (size_t f = 0; f < probs.size(); ++f) {
+    if (probs[f] < threshold) continue;
+    size_t begin = f * frame_samples;
+    size_t end = std::min(n_samples, begin + frame_samples);
+    if (begin >= n_samples) break;
+    begin = begin > pad_samples ? begin - pad_samples : 0;
+    end = std::min(n_samples, end + pad_samples);
+
+    if (!ranges.empty() && begin <= ranges.back().second + min_gap_samples) {
+      ranges.back().second = std::max(ranges.back().second, end);
+    } else {
+      ranges.emplace_back(begin, end);
+    }
+  }
+  if (ranges.empty()) return out;
+
+  size_t kept = 0;
+  for (const auto& r : ranges) kept += r.second - r.first;
+  if (kept * 10 >= n_samples * 9) return out;
+
+  // 2. Konuşma parçalarını art arda kopyala
+  out.pcm.reserve(kept);
+  for (const auto& r : ranges) {
+    out.spans.push_back({r.first, out.pcm.size(), r.second - r.first});
+    out.pcm.insert(out.pcm.end(), pcm + r.first, pcm + r.second);
+  }
+  return out;
+}
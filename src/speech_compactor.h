@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sıkıştırılmış tampondaki bir konuşma parçasının orijinal sesteki yeri
+struct CompactSpan {
+  size_t orig_start;
+  size_t compact_start;
+  size_t length;
+};
+
+// [YENİ]: Sadece konuşma (+ küçük pad) içeren sıkıştırılmış ses ve orijinal
+// zaman eksenine geri dönüş tablosu. Whisper bu tamponu decode eder; segment
+// ve token zamanları (centisaniye) orijinal sese çevrilir.
+struct CompactedAudio {
+  std::vector<float> pcm;
+  std::vector<CompactSpan> spans;
+
+  bool empty() const { return spans.empty(); }
+  size_t to_original_sample(size_t compact_sample) const;
+  int64_t to_original_cs(int64_t compact_cs) const;
+};
+
+// Çerçeve olasılıklarından (frame_samples örneklik çerçeveler, 0. çerçeve
+// pcm[0]'dan başlar) konuşma aralıklarını çıkarır. min_gap_samples'tan kısa
+// sessizlikler korunur. Kazanç önemsizse (sessizlik < %10) boş döner ve çağıran
+// orijinal sesi kullanır.
+CompactedAudio compact_speech(const float* pcm, size_t n_samples,
+                              const std::vector<float>& probs,
+                              size_t frame_samples, float threshold,
+                              size_t pad_samples, size_t min_gap_samples);
@@ -0,0 +1,447 @@
+#include "state_scheduler.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "spdlog/spdlog.h"
+#include "stt_engine.h"
+#include "tenant_limiter.h"
+
+const char* priority_name(RequestPriority priority) {
+  switch (priority) {
+    case RequestPriority::kRealtimeFinal:
+      return "realtime_final";
+    case RequestPriority::kRealtimePartial:
+      return "realtime_partial";
+    case RequestPriority::kUnary:
+      return "unary";
+    case RequestPriority::kBatch:
+      return "batch";
+  }
+  return "unknown";
+}
+
+namespace {
+constexpr size_t kPartialClass =
+    static_cast<size_t>(RequestPriority::kRealtimePartial);
+constexpr size_t kFinalClass =
+    static_cast<size_t>(RequestPriority::kRealtimeFinal);
+
+int64_t steady_now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// steady_clock Linux'ta CLOCK_MONOTONIC'tir; zaman aşımında false
+bool wait_until(sem_t* sem, std::chrono::steady_clock::time_point deadline) {
+  const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         deadline.time_since_epoch())
+                         .count();
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+  ts.tv_nsec = static_cast<long>(ns % 1000000000);
+  while (sem_clockwait(sem, CLOCK_MONOTONIC, &ts) != 0)
+    if (errno != EINTR) return false;
+  return true;
+}
+}  // namespace
+
+StateScheduler::StateScheduler(std::vector<struct whisper_state*> states,
+                               const Settings& settings,
+                               EngineMetrics* metrics,
+                               const TenantLimiter* tenants)
+    : drop_partials_(settings.state_drop_partials),
+      tenants_(tenants),
+      metrics_(metrics),
+      total_(states.size()) {
+  // Slotlar bir kez ayrılır; esnek havuz en fazla state_pool_max ekler
+  n_slots_ = states.size();
+  if (settings.elastic_state_pool)
+    n_slots_ += static_cast<size_t>(std::max(0, settings.state_pool_max));
+  slots_.reset(new std::atomic<Entry*>[n_slots_]);
+  for (size_t i = 0; i < n_slots_; ++i) {
+    slots_[i].store(nullptr);
+    entries_.push_back(std::make_unique<Entry>());
+    entries_[i]->index = i;
+  }
+  for (size_t i = 0; i < states.size(); ++i) {
+    entries_[i]->state.store(states[i]);
+    push_free(entries_[i].get());
+  }
+
+  const std::array<int, kNumPriorities> timeouts = {
+      settings.state_timeout_final_ms, settings.state_timeout_partial_ms,
+      settings.state_timeout_unary_ms, settings.state_timeout_batch_ms};
+
+  prometheus::Histogram::BucketBoundaries wait_buckets{
+      0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0, 30.0};
+  for (size_t c = 0; c < kNumPriorities; ++c) {
+    PriorityClass& pc = classes_[c];
+    pc.timeout = std::chrono::milliseconds(std::max(0, timeouts[c]));
+    if (!metrics) continue;
+    const prometheus::Labels labels = {
+        {"class", priority_name(static_cast<RequestPriority>(c))}};
+    pc.depth = &metrics->state_queue_depth.Add(labels);
+    pc.wait_seconds = &metrics->state_wait_seconds.Add(labels, wait_buckets);
+    pc.timeouts = &metrics->state_queue_timeouts_total.Add(labels);
+    pc.dropped = &metrics->state_dropped_total.Add(labels);
+  }
+}
+
+StateScheduler::~StateScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  pool_cv_.notify_all();
+  if (pool_thread_.joinable()) pool_thread_.join();
+  // Havuz sahibi yok edilirken tüm state'ler boştadır
+  if (elastic_)
+    for (auto& entry : entries_)
+      if (entry->grown) elastic_->destroy(entry->state.load());
+}
+
+void StateScheduler::enable_elastic(ElasticPoolConfig config) {
+  std::lock_guard<std::mutex> lock(mu_);
+  elastic_ = std::make_unique<ElasticPoolConfig>(std::move(config));
+  elastic_->max_states = std::min(elastic_->max_states, n_slots_);
+  if (metrics_) {
+    grow_events_ = &metrics_->state_pool_events_total.Add({{"event", "grow"}});
+    grow_failures_ =
+        &metrics_->state_pool_events_total.Add({{"event", "grow_failed"}});
+    shrink_events_ =
+        &metrics_->state_pool_events_total.Add({{"event", "shrink"}});
+    metrics_->state_pool_max.Set(static_cast<double>(elastic_->max_states));
+  }
+  set_pool_size_locked();
+  pool_thread_ = std::thread([this] { pool_loop(); });
+}
+
+size_t StateScheduler::size() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return total_;
+}
+
+size_t StateScheduler::capacity() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return elastic_ ? std::max(total_, elastic_->max_states) : total_;
+}
+
+void StateScheduler::set_pool_size_locked() {
+  if (metrics_) metrics_->state_pool_size.Set(static_cast<double>(total_));
+}
+
+StateScheduler::Entry* StateScheduler::pop_free() {
+  // Düşük slotlar önce: sıcak state'ler yeniden kullanılır, sondakiler
+  // boşta kalıp esnek havuzda kapatılabilir
+  for (size_t i = 0; i < n_slots_; ++i) {
+    Entry* entry = slots_[i].load();
+    if (entry && slots_[i].compare_exchange_strong(entry, nullptr))
+      return entry;
+  }
+  return nullptr;
+}
+
+void StateScheduler::push_free(Entry* entry) {
+  entry->idle_since_ns.store(steady_now_ns(), std::memory_order_relaxed);
+  // Kayıt sayısı slot sayısını aşmaz; eşzamanlı pop/push'ta tarama
+  // boş slotu kaçırırsa yeniden denenir
+  for (;;) {
+    for (size_t i = 0; i < n_slots_; ++i) {
+      Entry* expected = nullptr;
+      if (!slots_[i].load() &&
+          slots_[i].compare_exchange_strong(expected, entry))
+        return;
+    }
+  }
+}
+
+StateScheduler::Entry* StateScheduler::find_entry(
+    struct whisper_state* state) const {
+  for (const auto& entry : entries_)
+    if (entry->state.load(std::memory_order_relaxed) == state)
+      return entry.get();
+  return nullptr;
+}
+
+void StateScheduler::request_grow_locked() {
+  // State açmak ve ısıtmak saniyeler sürer; bekleyenin thread'inde
+  // yapılmaz (zaman aşımı işlemez). Havuz thread'i açıp sıradaki bekleyene
+  // devreder; bekleyen bu arada önce boşalan state'i de alabilir.
+  ++growing_;
+  pool_cv_.notify_one();
+}
+
+void StateScheduler::grow_one(std::unique_lock<std::mutex>& lock) {
+  // Bekleyenler bu arada boşalan state'leri aldıysa fazlası açılmaz
+  if (waiting_.load() < growing_) {
+    --growing_;
+    return;
+  }
+  lock.unlock();
+  struct whisper_state* state = elastic_->create();
+  lock.lock();
+  --growing_;
+  if (!state) {
+    if (grow_failures_) grow_failures_->Increment();
+    spdlog::warn("⚠️ State pool growth failed at {} states", total_);
+    return;
+  }
+  // Kapatılan kayıtlar total_ düşmeden boşaltıldığı için total_ <
+  // max_states <= n_slots_ iken boş kayıt vardır; yine de yoksa (ya da
+  // kapanıyorsak) açılan state geri verilir
+  Entry* entry = nullptr;
+  for (auto& e : entries_)
+    if (!e->state.load()) {
+      entry = e.get();
+      break;
+    }
+  if (!entry || stopping_) {
+    if (!stopping_) {
+      if (grow_failures_) grow_failures_->Increment();
+      spdlog::warn("⚠️ State pool growth failed: no free slot at {} states",
+                   total_);
+    }
+    lock.unlock();
+    elastic_->destroy(state);
+    lock.lock();
+    return;
+  }
+  entry->state.store(state);
+  entry->grown = true;
+  ++total_;
+  if (grow_events_) grow_events_->Increment();
+  set_pool_size_locked();
+  spdlog::info("State pool grew to {}/{}", total_, elastic_->max_states);
+  push_free(entry);
+  dispatch_locked();
+}
+
+void StateScheduler::pool_loop() {
+  const auto idle = elastic_->idle_timeout;
+  const auto period = std::max<std::chrono::milliseconds>(
+      std::chrono::milliseconds(1000), idle / 2);
+  const int64_t idle_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(idle).count();
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!stopping_) {
+    pool_cv_.wait_for(lock, period,
+                      [this] { return stopping_ || growing_ > 0; });
+    if (stopping_) break;
+    if (growing_ > 0) {
+      grow_one(lock);
+      continue;
+    }
+    // Yalnızca sonradan açılan ve idle süresini dolduran boş state'ler;
+    // slottan CAS ile alınanlar acquire'a görünmez
+    const int64_t now = steady_now_ns();
+    std::vector<Entry*> victims;
+    for (size_t i = 0; i < n_slots_; ++i) {
+      Entry* entry = slots_[i].load();
+      if (!entry || !entry->grown ||
+          now - entry->idle_since_ns.load(std::memory_order_relaxed) <
+              idle_ns)
+        continue;
+      if (slots_[i].compare_exchange_strong(entry, nullptr))
+        victims.push_back(entry);
+    }
+    if (victims.empty()) continue;
+    // Kayıtlar total_ ile aynı anda (kilit altında) boşaltılır; kilit
+    // bırakılınca açılan grow her zaman boş kayıt bulur
+    std::vector<struct whisper_state*> closing;
+    for (Entry* entry : victims) {
+      closing.push_back(entry->state.exchange(nullptr));
+      entry->grown = false;
+    }
+    total_ -= victims.size();
+    set_pool_size_locked();
+    if (shrink_events_)
+      shrink_events_->Increment(static_cast<double>(victims.size()));
+
+    lock.unlock();
+    for (auto* state : closing) elastic_->destroy(state);
+    spdlog::info("State pool shrank by {} idle states", closing.size());
+    lock.lock();
+  }
+}
+
+bool StateScheduler::waiting_before(size_t cls, bool inclusive) const {
+  const size_t end = inclusive ? cls + 1 : cls;
+  for (size_t c = 0; c < end; ++c)
+    if (!classes_[c].waiters.empty()) return true;
+  return false;
+}
+
+void StateScheduler::remove_waiter(PriorityClass& pc, Waiter* waiter) {
+  auto it = std::find(pc.waiters.begin(), pc.waiters.end(), waiter);
+  if (it == pc.waiters.end()) return;
+  pc.waiters.erase(it);
+  waiting_.fetch_sub(1);
+  if (pc.depth) pc.depth->Decrement();
+  if (pc.waiters.empty()) {
+    pc.virtual_time = 0.0;
+    pc.last_finish.clear();
+  }
+}
+
+void StateScheduler::drop_partials_locked() {
+  PriorityClass& pc = classes_[kPartialClass];
+  for (Waiter* w : pc.waiters) {
+    w->dropped = true;
+    sem_post(&w->wake);
+    if (pc.depth) pc.depth->Decrement();
+  }
+  waiting_.fetch_sub(pc.waiters.size());
+  pc.waiters.clear();
+  pc.virtual_time = 0.0;
+  pc.last_finish.clear();
+}
+
+void StateScheduler::update_wait_ewma(double waited_ms) {
+  // ~10 isteklik pencere; beklemesiz alımlar ortalamayı aşağı çeker
+  double current = wait_ewma_ms_.load(std::memory_order_relaxed);
+  while (!wait_ewma_ms_.compare_exchange_weak(
+      current, current + 0.1 * (waited_ms - current),
+      std::memory_order_relaxed)) {
+  }
+}
+
+void StateScheduler::observe_wait(
+    PriorityClass& pc, std::chrono::steady_clock::time_point t_start) {
+  const double waited = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - t_start)
+                            .count();
+  update_wait_ewma(waited * 1000.0);
+  if (pc.wait_seconds) pc.wait_seconds->Observe(waited);
+}
+
+size_t StateScheduler::queue_depth() const { return waiting_.load(); }
+
+double StateScheduler::recent_wait_ms() const {
+  return wait_ewma_ms_.load(std::memory_order_relaxed);
+}
+
+struct whisper_state* StateScheduler::acquire(RequestPriority priority,
+                                              const std::string& tenant,
+                                              double cost, size_t* index) {
+  const auto t_start = std::chrono::steady_clock::now();
+  const size_t cls = static_cast<size_t>(priority);
+  PriorityClass& pc = classes_[cls];
+  auto take = [&](Entry* entry) {
+    observe_wait(pc, t_start);
+    if (index) *index = entry->index;
+    return entry->state.load();
+  };
+
+  // Kilitsiz hızlı yol: sırada kimse yokken boş slottan alınır
+  if (waiting_.load() == 0)
+    if (Entry* entry = pop_free()) return take(entry);
+
+  std::unique_lock<std::mutex> lock(mu_);
+
+  // Boş state var ve aynı/üst sınıfta sırada bekleyen yok
+  if (!waiting_before(cls, true))
+    if (Entry* entry = pop_free()) return take(entry);
+
+  if (drop_partials_) {
+    // Final bekliyorken yeni partial anlamsız; stream bir sonrakini üretir
+    if (cls == kPartialClass && waiting_before(cls, false)) {
+      if (pc.dropped) pc.dropped->Increment();
+      throw PartialDroppedException("Partial dropped (pool saturated)");
+    }
+    // Final sıraya giriyorsa bekleyen partial'lar bırakılır
+    if (cls == kFinalClass) {
+      PriorityClass& partials = classes_[kPartialClass];
+      if (partials.dropped && !partials.waiters.empty())
+        partials.dropped->Increment(
+            static_cast<double>(partials.waiters.size()));
+      drop_partials_locked();
+    }
+  }
+
+  Waiter waiter;
+  const double weight = tenants_ ? tenants_->weight(tenant) : 1.0;
+  double& finish = pc.last_finish[tenant];
+  waiter.start_tag = std::max(pc.virtual_time, finish);
+  finish = waiter.start_tag + std::max(0.1, cost) / weight;
+  pc.waiters.push_back(&waiter);
+  waiting_.fetch_add(1);
+  if (pc.depth) pc.depth->Increment();
+
+  // Kayıttan önce kilitsiz iade edilen (bekleyeni görmeyen) state'ler
+  // burada devredilir
+  dispatch_locked();
+
+  // Esnek havuz: boş state yoksa arka planda yenisi açılır ve öncelik
+  // sırasına göre devredilir; bu istek kendi zaman aşımıyla bekler
+  if (!waiter.granted && elastic_ &&
+      total_ + growing_ < elastic_->max_states)
+    request_grow_locked();
+
+  if (!waiter.granted && !waiter.dropped) {
+    lock.unlock();
+    if (!wait_until(&waiter.wake, t_start + pc.timeout)) {
+      lock.lock();
+      if (!waiter.granted && !waiter.dropped) {
+        remove_waiter(pc, &waiter);
+        update_wait_ewma(static_cast<double>(pc.timeout.count()));
+        if (pc.timeouts) pc.timeouts->Increment();
+        spdlog::warn(
+            "⚠️ Engine overload: No whisper state available after {}ms ({})",
+            pc.timeout.count(), priority_name(priority));
+        throw EngineBusyException("Server is busy (Queue timeout)");
+      }
+      // Devir zaman aşımıyla yarıştı; sem_post kilit altında yapıldı
+      sem_wait(&waiter.wake);
+    }
+  } else {
+    // Kilit tutulurken verildi; semafor yine de tüketilir
+    sem_wait(&waiter.wake);
+  }
+
+  if (waiter.granted) return take(waiter.granted);
+  throw PartialDroppedException("Partial dropped (final waiting)");
+}
+
+void StateScheduler::release(struct whisper_state* state) {
+  Entry* entry = find_entry(state);
+  if (!entry) return;
+  push_free(entry);
+  // Bekleyen yoksa kilit hiç alınmaz; bekleyen kaydı iade ile yarışırsa
+  // kayıt sonrası dispatch_locked state'i görür
+  if (waiting_.load() == 0) return;
+  std::lock_guard<std::mutex> lock(mu_);
+  dispatch_locked();
+}
+
+void StateScheduler::charge(RequestPriority priority,
+                            const std::string& tenant, double cost) {
+  PriorityClass& pc = classes_[static_cast<size_t>(priority)];
+  const double weight = tenants_ ? tenants_->weight(tenant) : 1.0;
+  std::lock_guard<std::mutex> lock(mu_);
+  double& finish = pc.last_finish[tenant];
+  finish = std::max(pc.virtual_time, finish) + std::max(0.1, cost) / weight;
+}
+
+void StateScheduler::dispatch_locked() {
+  // Doğrudan devir: en yüksek öncelikli sınıfta en küçük başlangıç
+  // etiketli bekleyen (eşitlikte en eski)
+  for (auto& pc : classes_) {
+    while (!pc.waiters.empty()) {
+      Entry* entry = pop_free();
+      if (!entry) return;
+      auto next = std::min_element(pc.waiters.begin(), pc.waiters.end(),
+                                   [](const Waiter* a, const Waiter* b) {
+                                     return a->start_tag < b->start_tag;
+                                   });
+      Waiter* waiter = *next;
+      pc.virtual_time = waiter->start_tag;
+      remove_waiter(pc, waiter);
+      waiter->granted = entry;
+      sem_post(&waiter->wake);
+    }
+  }
+}
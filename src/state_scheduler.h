@@ -0,0 +1,172 @@
+#pragma once
+#include <semaphore.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "engine_metrics.h"
+
+struct whisper_state;
+class TenantLimiter;
+
+// İstek öncelik sınıfları (küçük değer = yüksek öncelik)
+enum class RequestPriority : int {
+  kRealtimeFinal = 0,    // Stream cümle sonu
+  kRealtimePartial = 1,  // Stream ara sonucu (baskı altında düşürülebilir)
+  kUnary = 2,            // Tekil gRPC / HTTP istekleri
+  kBatch = 3,            // Uzun dosyalar
+};
+
+constexpr size_t kNumPriorities = 4;
+const char* priority_name(RequestPriority priority);
+
+// [YENİ]: Esnek havuz. Bekleyen varken max_states'e kadar arka planda
+// (havuz thread'inde, sırayla) yeni state açılır; sonradan açılan
+// state'ler idle_timeout boyunca boşta kalınca kapatılır.
+// Başlangıç state'leri (min) hiç kapatılmaz ve çağıranın mülkiyetindedir.
+struct ElasticPoolConfig {
+  size_t max_states = 0;
+  std::chrono::milliseconds idle_timeout{60000};
+  std::function<struct whisper_state*()> create;  // Hata: nullptr
+  std::function<void(struct whisper_state*)> destroy;
+};
+
+// [YENİ]: whisper_state havuzu için öncelik sınıflı kabul kuyruğu.
+// Eski düz queue + condition_variable yerine: boşalan state doğrudan en
+// yüksek öncelikli sınıftaki sıradaki bekleyene verilir.
+//
+// Boş state'ler kilitsiz bir slot dizisinde (CAS) tutulur: sırada bekleyen
+// yokken acquire/release mutex'e hiç dokunmaz. Kilit yalnızca bekleyen
+// varken (sıralama ve devir için) alınır; her bekleyen kendi semaforunda
+// (futex) uyur ve uyandığında mutex'i yeniden almaz.
+// Her sınıfın kendi bekleme zaman aşımı vardır. Partial'lar, önlerinde
+// final bekliyorsa kuyruğa hiç girmez ya da final geldiğinde kuyruktan
+// atılır (PartialDroppedException).
+//
+// Sınıf içinde tenant'lar arası sıra Start-time Fair Queuing ile belirlenir:
+// her bekleyene max(sanal zaman, tenant'ın son bitişi) başlangıç etiketi
+// verilir, tenant'ın bitişi maliyet/ağırlık kadar ilerler. Tek tenant için
+// bu düz FIFO'dur.
+class StateScheduler {
+ public:
+  StateScheduler(std::vector<struct whisper_state*> states,
+                 const Settings& settings, EngineMetrics* metrics = nullptr,
+                 const TenantLimiter* tenants = nullptr);
+  ~StateScheduler();
+
+  StateScheduler(const StateScheduler&) = delete;
+  StateScheduler& operator=(const StateScheduler&) = delete;
+
+  // İstek almadan önce çağrılmalıdır
+  void enable_elastic(ElasticPoolConfig config);
+
+  // Zaman aşımında EngineBusyException, düşürülen partial'da
+  // PartialDroppedException fırlatır. cost: ses saniyesi (WFQ maliyeti).
+  // index: state'in havuzdaki sabit sırası (< slot_count()); çekirdek
+  // ataması bu sıraya göre yapılır.
+  struct whisper_state* acquire(RequestPriority priority,
+                                const std::string& tenant = "",
+                                double cost = 1.0, size_t* index = nullptr);
+  void release(struct whisper_state* state);
+  // Beklemeden tenant'ın sınıftaki WFQ bitişini cost kadar ilerletir;
+  // başkasının aldığı state'i paylaşan istek (birleştirilmiş pencere
+  // üyesi) kendi payından öder.
+  void charge(RequestPriority priority, const std::string& tenant,
+              double cost);
+
+  // Yük sinyalleri (yük uyarlamalı decode için): tüm sınıflarda bekleyen
+  // istek sayısı ve son state beklemelerinin üstel ortalaması (ms)
+  size_t queue_depth() const;
+  double recent_wait_ms() const;
+
+  // Açık state sayısı ve havuzun ulaşabileceği üst sınır
+  size_t size() const;
+  size_t capacity() const;
+  // Sabit slot sayısı: başlangıç state'leri + esnek havuz payı
+  size_t slot_count() const { return n_slots_; }
+
+ private:
+  // State başına sabit kayıt; index ömür boyu değişmez
+  struct Entry {
+    std::atomic<struct whisper_state*> state{nullptr};
+    size_t index = 0;
+    std::atomic<int64_t> idle_since_ns{0};  // Son iade (steady_clock)
+    bool grown = false;                     // mu_ altında
+  };
+
+  struct Waiter {
+    Waiter() { sem_init(&wake, 0, 0); }
+    ~Waiter() { sem_destroy(&wake); }
+    Entry* granted = nullptr;
+    bool dropped = false;
+    double start_tag = 0.0;
+    sem_t wake;
+  };
+
+  struct PriorityClass {
+    std::deque<Waiter*> waiters;
+    double virtual_time = 0.0;
+    std::unordered_map<std::string, double> last_finish;  // tenant -> etiket
+    std::chrono::milliseconds timeout{0};
+    prometheus::Gauge* depth = nullptr;
+    prometheus::Histogram* wait_seconds = nullptr;
+    prometheus::Counter* timeouts = nullptr;
+    prometheus::Counter* dropped = nullptr;
+  };
+
+  bool waiting_before(size_t cls, bool inclusive) const;
+  void remove_waiter(PriorityClass& pc, Waiter* waiter);
+  void drop_partials_locked();
+  void observe_wait(PriorityClass& pc,
+                    std::chrono::steady_clock::time_point t_start);
+  void update_wait_ewma(double waited_ms);
+  // Kilitsiz boş liste
+  Entry* pop_free();
+  void push_free(Entry* entry);
+  Entry* find_entry(struct whisper_state* state) const;
+  // Boş state'leri sıradaki bekleyenlere devreder
+  void dispatch_locked();
+  // Havuz thread'inden yeni state ister (beklemez)
+  void request_grow_locked();
+  // Havuz thread'i: kilidi bırakıp state açar, sıradaki bekleyene devreder
+  void grow_one(std::unique_lock<std::mutex>& lock);
+  // İstenen state'leri açar, boşta kalanları kapatır
+  void pool_loop();
+  void set_pool_size_locked();
+
+  size_t n_slots_ = 0;
+  std::vector<std::unique_ptr<Entry>> entries_;  // index sırasıyla
+  std::unique_ptr<std::atomic<Entry*>[]> slots_;  // nullptr = boş slot
+  std::atomic<size_t> waiting_{0};  // Tüm sınıflarda bekleyen
+  std::atomic<double> wait_ewma_ms_{0.0};
+
+  mutable std::mutex mu_;
+  std::array<PriorityClass, kNumPriorities> classes_;
+  bool drop_partials_;
+  const TenantLimiter* tenants_;
+  EngineMetrics* metrics_;
+
+  // Esnek havuz (enable_elastic); Entry::grown sonradan açılan, bizim
+  // sahip olduğumuz state'ler
+  std::unique_ptr<ElasticPoolConfig> elastic_;
+  size_t total_ = 0;
+  size_t growing_ = 0;  // İstenen ya da açılmakta olan state'ler
+  prometheus::Counter* grow_events_ = nullptr;
+  prometheus::Counter* grow_failures_ = nullptr;
+  prometheus::Counter* shrink_events_ = nullptr;
+  std::thread pool_thread_;
+  std::condition_variable pool_cv_;
+  bool stopping_ = false;
+};
@@ -0,0 +1,169 @@
+#include "stream_audio_input.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+constexpr int kTargetSampleRate = 16000;
+
+// ITU-T G.711 genişletme (Sun g711.c referans uygulaması)
+constexpr int16_t ulaw_to_linear(uint8_t u) {
+  u = static_cast<uint8_t>(~u);
+  int t = ((u & 0x0F) << 3) + 0x84;
+  t <<= (u & 0x70) >> 4;
+  return static_cast<int16_t>((u & 0x80) ? (0x84 - t) : (t - 0x84));
+}
+
+constexpr int16_t alaw_to_linear(uint8_t a) {
+  a ^= 0x55;
+  int t = (a & 0x0F) << 4;
+  const int seg = (a & 0x70) >> 4;
+  if (seg == 0)
+    t += 8;
+  else if (seg == 1)
+    t += 0x108;
+  else
+    t = (t + 0x108) << (seg - 1);
+  return static_cast<int16_t>((a & 0x80) ? t : -t);
+}
+
+template <int16_t (*Expand)(uint8_t)>
+constexpr std::array<int16_t, 256> make_table() {
+  std::array<int16_t, 256> table{};
+  for (int i = 0; i < 256; ++i)
+    table[static_cast<size_t>(i)] = Expand(static_cast<uint8_t>(i));
+  return table;
+}
+
+constexpr std::array<int16_t, 256> kUlawTable = make_table<ulaw_to_linear>();
+constexpr std::array<int16_t, 256> kAlawTable = make_table<alaw_to_linear>();
+
+int16_t to_pcm16(float v) {
+  return static_cast<int16_t>(
+      std::lround(std::clamp(v * 32768.0f, -32768.0f, 32767.0f)));
+}
+}  // namespace
+
+bool parse_stream_encoding(const std::string& name, StreamEncoding* out) {
+  std::string n = name;
+  std::transform(n.begin(), n.end(), n.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (n == "pcm16" || n == "s16le" || n == "linear16") {
+    *out = StreamEncoding::kPcm16;
+  } else if (n == "pcmu" || n == "ulaw" || n == "mulaw" || n == "g711u") {
+    *out = StreamEncoding::kPcmu;
+  } else if (n == "pcma" || n == "alaw" || n == "g711a") {
+    *out = StreamEncoding::kPcma;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* stream_encoding_name(StreamEncoding encoding) {
+  switch (encoding) {
+    case StreamEncoding::kPcm16:
+      return "pcm16";
+    case StreamEncoding::kPcmu:
+      return "pcmu";
+    case StreamEncoding::kPcma:
+      return "pcma";
+  }
+  return "unknown";
+}
+
+StreamAudioInput::StreamAudioInput(StreamEncoding encoding, int sample_rate)
+    : encoding_(encoding), sample_rate_(sample_rate) {
+  if (sample_rate < kMinSampleRate || sample_rate > kMaxSampleRate)
+    throw std::invalid_argument("Unsupported sample rate: " +
+                                std::to_string(sample_rate));
+  if (sample_rate_ != kTargetSampleRate) {
+    int error = 0;
+    src_ = src_new(SRC_SINC_FASTEST, 1, &error);
+    if (!src_)
+      throw std::runtime_error(std::string("Resampler init failed: ") +
+                               src_strerror(error));
+  }
+}
+
+StreamAudioInput::~StreamAudioInput() {
+  if (src_) src_delete(src_);
+}
+
+void StreamAudioInput::decode(const uint8_t* data, size_t len,
+                              std::vector<int16_t>* out) {
+  // 16kHz'de çözülen örnekler doğrudan out'a eklenir
+  std::vector<int16_t>& pcm = src_ ? pcm_ : *out;
+  if (src_) pcm.clear();
+  const size_t base = pcm.size();
+
+  switch (encoding_) {
+    case StreamEncoding::kPcmu:
+      pcm.resize(base + len);
+      for (size_t i = 0; i < len; ++i) pcm[base + i] = kUlawTable[data[i]];
+      break;
+    case StreamEncoding::kPcma:
+      pcm.resize(base + len);
+      for (size_t i = 0; i < len; ++i) pcm[base + i] = kAlawTable[data[i]];
+      break;
+    case StreamEncoding::kPcm16: {
+      size_t pos = 0;
+      if (has_odd_byte_ && len > 0) {
+        pcm.push_back(static_cast<int16_t>(odd_byte_ | (data[0] << 8)));
+        pos = 1;
+        has_odd_byte_ = false;
+      }
+      for (; pos + 1 < len; pos += 2)
+        pcm.push_back(static_cast<int16_t>(data[pos] | (data[pos + 1] << 8)));
+      if (pos < len) {
+        odd_byte_ = data[pos];
+        has_odd_byte_ = true;
+      }
+      break;
+    }
+  }
+  if (!src_ || pcm.empty()) return;
+
+  in_.resize(pcm.size());
+  for (size_t i = 0; i < pcm.size(); ++i)
+    in_[i] = static_cast<float>(pcm[i]) / 32768.0f;
+  resample(in_.data(), in_.size(), false, out);
+}
+
+void StreamAudioInput::flush(std::vector<int16_t>* out) {
+  has_odd_byte_ = false;
+  if (!src_) return;
+  // Boş girişte de geçerli işaretçi (eski libsamplerate sürümleri için)
+  static const float kNoInput = 0.0f;
+  resample(&kNoInput, 0, true, out);
+  src_reset(src_);
+}
+
+void StreamAudioInput::resample(const float* in, size_t frames,
+                                bool end_of_input, std::vector<int16_t>* out) {
+  const double ratio = static_cast<double>(kTargetSampleRate) / sample_rate_;
+  out_.resize(static_cast<size_t>(frames * ratio) + 256);
+
+  SRC_DATA d;
+  d.data_in = in;
+  d.input_frames = static_cast<long>(frames);
+  d.src_ratio = ratio;
+  d.end_of_input = end_of_input ? 1 : 0;
+  // Sinc filtresinin gecikmesi yüzünden çıktı girişten kısa olabilir;
+  // tüketilmeyen giriş ve boşaltma birden çok çağrı gerektirebilir
+  for (;;) {
+    d.data_out = out_.data();
+    d.output_frames = static_cast<long>(out_.size());
+    if (src_process(src_, &d) != 0) return;
+    for (long i = 0; i < d.output_frames_gen; ++i)
+      out->push_back(to_pcm16(out_[static_cast<size_t>(i)]));
+    if (d.input_frames_used == 0 && d.output_frames_gen == 0) break;
+    d.data_in += d.input_frames_used;
+    d.input_frames -= d.input_frames_used;
+    if (d.input_frames > 0) continue;
+    if (!end_of_input) break;
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <samplerate.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Stream ses kodlaması (x-audio-encoding metadata'sı)
+enum class StreamEncoding {
+  kPcm16,  // s16le (varsayılan)
+  kPcmu,   // G.711 µ-law
+  kPcma,   // G.711 A-law
+};
+
+// "pcm16" | "s16le" | "linear16", "pcmu" | "ulaw" | "mulaw" | "g711u",
+// "pcma" | "alaw" | "g711a" (büyük/küçük harf duyarsız). Tanınmazsa false.
+bool parse_stream_encoding(const std::string& name, StreamEncoding* out);
+const char* stream_encoding_name(StreamEncoding encoding);
+
+// [YENİ]: Stream girişini motorun beklediği 16kHz s16le'ye çevirir.
+// G.711 örnekleri 256 girişli tablolarla çözülür. 16kHz dışı hızlar stream
+// boyunca yaşayan tek bir libsamplerate durumuyla artımlı yükseltilir;
+// parça sınırlarında süreksizlik olmaz. Varsayılan biçim (s16le, 16kHz)
+// için nesne oluşturulmaz.
+class StreamAudioInput {
+ public:
+  static constexpr int kMinSampleRate = 8000;
+  static constexpr int kMaxSampleRate = 48000;
+
+  // Desteklenmeyen hızda std::invalid_argument fırlatır
+  StreamAudioInput(StreamEncoding encoding, int sample_rate);
+  ~StreamAudioInput();
+
+  StreamAudioInput(const StreamAudioInput&) = delete;
+  StreamAudioInput& operator=(const StreamAudioInput&) = delete;
+
+  StreamEncoding encoding() const { return encoding_; }
+  int sample_rate() const { return sample_rate_; }
+
+  // Parçayı çözüp 16kHz örnekleri out'a ekler. s16le'de yarım kalan bayt
+  // sonraki parçaya taşınır.
+  void decode(const uint8_t* data, size_t len, std::vector<int16_t>* out);
+  // Söz sonunda (EOS) yeniden örnekleyicide bekleyen kuyruğu boşaltır;
+  // sonraki söz temiz durumdan başlar
+  void flush(std::vector<int16_t>* out);
+
+ private:
+  void resample(const float* in, size_t frames, bool end_of_input,
+                std::vector<int16_t>* out);
+
+  StreamEncoding encoding_;
+  int sample_rate_;
+  SRC_STATE* src_ = nullptr;  // sample_rate_ == 16000 ise yok
+  // Yeniden örnekleyici tamponları (parçalar arasında tekrar kullanılır)
+  std::vector<int16_t> pcm_;
+  std::vector<float> in_;
+  std::vector<float> out_;
+  bool has_odd_byte_ = false;
+  uint8_t odd_byte_ = 0;
+};
@@ -0,0 +1,36 @@
+#include "stream_endpointer.h"
+
+#include <algorithm>
+
+StreamEndpointer::StreamEndpointer(const Settings& settings)
+    : threshold_(settings.stream_endpoint_threshold),
+      silence_ms_(settings.stream_endpoint_silence_ms),
+      min_speech_ms_(settings.stream_endpoint_min_speech_ms) {}
+
+void StreamEndpointer::reset() {
+  speech_ms_ = 0;
+  trailing_silence_ms_ = 0;
+  last_prob_ = 0.0f;
+}
+
+bool StreamEndpointer::update(const VadSession& vad) {
+  size_t f = std::max(next_frame_, vad.frame_begin());
+  for (; f < vad.frame_end(); ++f) {
+    last_prob_ = vad.prob(f);
+    if (last_prob_ >= threshold_) {
+      speech_ms_ += VadSession::kFrameMs;
+      trailing_silence_ms_ = 0;
+      continue;
+    }
+    trailing_silence_ms_ += VadSession::kFrameMs;
+    if (speech_ms_ >= min_speech_ms_ && trailing_silence_ms_ >= silence_ms_) {
+      next_frame_ = f + 1;
+      endpoint_sample_ = next_frame_ * VadSession::kFrameMs * 16;
+      speech_ms_ = 0;
+      trailing_silence_ms_ = 0;
+      return true;
+    }
+  }
+  next_frame_ = f;
+  return false;
+}
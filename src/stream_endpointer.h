@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+
+#include "config.h"
+#include "vad_session.h"
+
+// [YENİ]: Stream için sunucu taraflı söz sonu (End-of-Utterance) tespiti.
+// VadSession'ın ürettiği 32ms'lik çerçeve olasılıklarını tüketir; yeterli
+// konuşmadan sonra stream_endpoint_silence_ms kadar kesintisiz sessizlik
+// görülünce true döner.
+class StreamEndpointer {
+ public:
+  explicit StreamEndpointer(const Settings& settings);
+
+  // Oturumdaki yeni çerçeveleri işler. Söz sonu tespit edilirse orada durur,
+  // true döner ve sayaçlar bir sonraki cümle için sıfırlanır; kalan
+  // çerçeveler bir sonraki çağrıda yeni cümleye sayılır.
+  bool update(const VadSession& vad);
+  void reset();
+
+  // Son söz sonu çerçevesinin bitişi (stream başından mutlak örnek). Bu
+  // konumdan sonraki ses yeni cümleye aittir.
+  size_t endpoint_sample() const { return endpoint_sample_; }
+
+  float last_speech_prob() const { return last_prob_; }
+  int trailing_silence_ms() const { return trailing_silence_ms_; }
+
+ private:
+  float threshold_;
+  int silence_ms_;
+  int min_speech_ms_;
+
+  size_t next_frame_ = 0;
+  size_t endpoint_sample_ = 0;
+  int speech_ms_ = 0;
+  int trailing_silence_ms_ = 0;
+  float last_prob_ = 0.0f;
+};
@@ -0,0 +1,237 @@
+#include "streaming_decoder.h"
+
+#include <algorithm>
+
+#include "utils.h"
+
+namespace {
+// Whisper token metinleri kelime başında boşlukla gelir (" merhaba")
+bool starts_word(const TokenData& t) {
+  return !t.text.empty() && t.text.front() == ' ';
+}
+
+std::string join_tokens(const std::vector<TokenData>& tokens, size_t begin,
+                        size_t end) {
+  std::string out;
+  for (size_t i = begin; i < end; ++i) out += tokens[i].text;
+  return out;
+}
+
+// Son kelimenin başlangıç indeksi (son kelime hala uzayabilir)
+size_t last_word_start(const std::vector<TokenData>& tokens, size_t n) {
+  while (n > 0 && !starts_word(tokens[n - 1])) --n;
+  return n > 0 ? n - 1 : 0;
+}
+}  // namespace
+
+StreamingDecoder::StreamingDecoder(SttEngine& engine,
+                                   RequestOptions base_options)
+    : StreamingDecoder(
+          engine.get_settings(), engine.has_fast_model(),
+          [&engine](const std::vector<int16_t>& pcm,
+                    const RequestOptions& options,
+                    SttEngine::PerformanceMetrics* perf) {
+            return engine.transcribe_pcm16(pcm, 16000, options, perf);
+          },
+          std::move(base_options)) {}
+
+StreamingDecoder::StreamingDecoder(const Settings& settings,
+                                   bool fast_partials, Transcriber transcribe,
+                                   RequestOptions base_options)
+    : transcribe_(std::move(transcribe)),
+      base_options_(std::move(base_options)),
+      fast_partials_(fast_partials) {
+  // Kesinleştirme token sınırlarında yapılır; segment sınırına düşerse
+  // segmentin kesim noktasından sonraki kelimeleri kaybolur
+  base_options_.require_token_timestamps = true;
+  max_window_samples_ =
+      static_cast<size_t>(std::max(1000, settings.stream_max_window_ms)) * 16;
+  prompt_max_chars_ =
+      static_cast<size_t>(std::max(0, settings.stream_prompt_max_chars));
+  window_.reserve(max_window_samples_ + settings.stream_buffer_samples);
+}
+
+void StreamingDecoder::append(const int16_t* samples, size_t n_samples) {
+  window_.insert(window_.end(), samples, samples + n_samples);
+  if (fast_partials_)
+    utterance_.insert(utterance_.end(), samples, samples + n_samples);
+}
+
+std::vector<int16_t> StreamingDecoder::take_after(size_t sample_pos) {
+  if (sample_pos <= window_origin_ ||
+      sample_pos - window_origin_ >= window_.size())
+    return {};
+  const auto cut = window_.begin() + (sample_pos - window_origin_);
+  std::vector<int16_t> tail(cut, window_.end());
+  window_.erase(cut, window_.end());
+  if (fast_partials_)
+    utterance_.resize(std::min(utterance_.size(),
+                               sample_pos - utterance_origin_));
+  last_decoded_size_ = std::min(last_decoded_size_, window_.size());
+  return tail;
+}
+
+void StreamingDecoder::reset() {
+  window_origin_ += window_.size();
+  utterance_origin_ = window_origin_;
+  window_.clear();
+  last_decoded_size_ = 0;
+  prev_hypothesis_.clear();
+  committed_text_.clear();
+  committed_tokens_.clear();
+  utterance_.clear();
+}
+
+std::string StreamingDecoder::build_prompt() const {
+  std::string context = base_options_.prompt;
+  if (prompt_max_chars_ == 0 || committed_text_.empty()) return context;
+
+  size_t start = 0;
+  if (committed_text_.size() > prompt_max_chars_) {
+    // UTF-8 karakterini bölmemek için kelime sınırından kes
+    start = committed_text_.find(' ',
+                                 committed_text_.size() - prompt_max_chars_);
+    if (start == std::string::npos) return context;
+  }
+  if (!context.empty()) context += " ";
+  return context + sentiric::utils::trim(committed_text_.substr(start));
+}
+
+std::vector<TranscriptionResult> StreamingDecoder::run(
+    const std::vector<int16_t>& pcm, size_t origin, std::string prompt,
+    RequestPriority priority, SttEngine::PerformanceMetrics* perf) {
+  RequestOptions options = base_options_;
+  options.prompt = std::move(prompt);
+  options.priority = priority;
+  options.vad_sample_offset = origin;
+  auto results = transcribe_(pcm, options, perf);
+  last_decoded_size_ = window_.size();
+  return results;
+}
+
+void StreamingDecoder::drop_window_front(size_t n_samples) {
+  n_samples = std::min(n_samples, window_.size());
+  window_.erase(window_.begin(), window_.begin() + n_samples);
+  window_origin_ += n_samples;
+  last_decoded_size_ =
+      last_decoded_size_ > n_samples ? last_decoded_size_ - n_samples : 0;
+  // Cümle sesi tutuluyorsa ve henüz kesinleşen yoksa cümle pencereyle
+  // başlar (uzun sessizlik utterance_'ta birikmez)
+  if (fast_partials_ && committed_tokens_.empty()) {
+    utterance_.erase(utterance_.begin(),
+                     utterance_.begin() +
+                         std::min(utterance_.size(),
+                                  window_origin_ - utterance_origin_));
+    utterance_origin_ = window_origin_;
+  }
+}
+
+void StreamingDecoder::append_shifted(const std::vector<TokenData>& tokens,
+                                      size_t begin, size_t end,
+                                      std::vector<TokenData>* out) const {
+  const int64_t offset_cs =
+      static_cast<int64_t>((window_origin_ - utterance_origin_) / 160);
+  for (size_t i = begin; i < end; ++i) {
+    TokenData tok = tokens[i];
+    tok.t0 += offset_cs;
+    tok.t1 += offset_cs;
+    out->push_back(std::move(tok));
+  }
+}
+
+void StreamingDecoder::commit_tokens(const std::vector<TokenData>& hyp,
+                                     size_t n_commit, StreamUpdate* update) {
+  committed_text_ += join_tokens(hyp, 0, n_commit);
+  append_shifted(hyp, 0, n_commit, &update->committed_tokens);
+  append_shifted(hyp, 0, n_commit, &committed_tokens_);
+
+  // Token zamanları centisaniye (10ms) cinsindendir: 1cs = 160 örnek
+  int64_t cut_cs = std::max<int64_t>(0, hyp[n_commit - 1].t1);
+  drop_window_front(static_cast<size_t>(cut_cs) * 160);
+
+  prev_hypothesis_.assign(hyp.begin() + n_commit, hyp.end());
+}
+
+size_t StreamingDecoder::stable_prefix(const std::vector<TokenData>& prev,
+                                       const std::vector<TokenData>& hyp) {
+  size_t n_agreed = 0;
+  while (n_agreed < hyp.size() && n_agreed < prev.size() &&
+         hyp[n_agreed].text == prev[n_agreed].text)
+    ++n_agreed;
+
+  // Sadece tam kelimeleri kesinleştir
+  if (n_agreed == hyp.size()) return last_word_start(hyp, n_agreed);
+  while (n_agreed > 0 && !starts_word(hyp[n_agreed])) --n_agreed;
+  return n_agreed;
+}
+
+StreamUpdate StreamingDecoder::decode_partial(
+    SttEngine::PerformanceMetrics* perf) {
+  StreamUpdate update;
+  update.results = run(window_, window_origin_, build_prompt(),
+                       RequestPriority::kRealtimePartial, perf);
+
+  std::vector<TokenData> hyp;
+  for (const auto& res : update.results)
+    hyp.insert(hyp.end(), res.tokens.begin(), res.tokens.end());
+
+  const size_t n_agreed = stable_prefix(prev_hypothesis_, hyp);
+  size_t n_committed = 0;
+  if (n_agreed > 0) {
+    commit_tokens(hyp, n_agreed, &update);
+    n_committed = n_agreed;
+  } else if (window_.size() > max_window_samples_) {
+    // Pencere sınırı aşıldı: anlaşma beklemeden son kelime hariç kesinleştir
+    size_t n_forced = last_word_start(hyp, hyp.size());
+    if (n_forced > 0) {
+      commit_tokens(hyp, n_forced, &update);
+      n_committed = n_forced;
+    } else {
+      // Metin yok (sessizlik/gürültü): sadece son pencere yarısını tut
+      drop_window_front(window_.size() - max_window_samples_ / 2);
+      prev_hypothesis_.clear();
+    }
+  } else {
+    prev_hypothesis_ = hyp;
+  }
+
+  update.text = sentiric::utils::trim(
+      committed_text_ + join_tokens(hyp, n_committed, hyp.size()));
+  return update;
+}
+
+StreamUpdate StreamingDecoder::finalize(SttEngine::PerformanceMetrics* perf) {
+  StreamUpdate update;
+  if (fast_partials_) {
+    // Kesinleşen önek hızlı modelden geldi: final cümlenin tamamı ana
+    // modelde yeniden çözülür (token zamanları zaten cümle başına göre)
+    if (!utterance_.empty())
+      update.results = run(utterance_, utterance_origin_, base_options_.prompt,
+                           RequestPriority::kRealtimeFinal, perf);
+    std::string text;
+    for (const auto& res : update.results) {
+      text += join_tokens(res.tokens, 0, res.tokens.size());
+      update.committed_tokens.insert(update.committed_tokens.end(),
+                                     res.tokens.begin(), res.tokens.end());
+    }
+    update.text = sentiric::utils::trim(text);
+    reset();
+    return update;
+  }
+
+  if (!window_.empty())
+    update.results = run(window_, window_origin_, build_prompt(),
+                         RequestPriority::kRealtimeFinal, perf);
+
+  // Final cümlenin tamamını taşır: kesinleşen önek + son decode'un kuyruğu
+  std::string text = committed_text_;
+  update.committed_tokens = committed_tokens_;
+  for (const auto& res : update.results) {
+    text += join_tokens(res.tokens, 0, res.tokens.size());
+    append_shifted(res.tokens, 0, res.tokens.size(),
+                   &update.committed_tokens);
+  }
+  update.text = sentiric::utils::trim(text);
+  reset();
+  return update;
+}
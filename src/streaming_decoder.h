@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "stt_engine.h"
+
+// Bir decode adımının akışa yansıyan sonucu. Metin her zaman cümlenin
+// tamamıdır (kesinleşen önek + kuyruk); kelimeler ise partial'da yalnızca
+// bu adımda kesinleşenler (fark), finalde cümlenin tüm kelimeleridir.
+struct StreamUpdate {
+  std::string text;
+  // Zamanlar cümle başına göre (centisaniye)
+  std::vector<TokenData> committed_tokens;
+  std::vector<TranscriptionResult> results;  // Son decode (affective için)
+};
+
+// [YENİ]: Artımlı (Incremental) Kayan Pencere Decoder
+// Her partial'da tüm tamponu yeniden decode etmek yerine (O(n^2)), ardışık
+// iki hipotezde değişmeden kalan önek (LocalAgreement-2) kesinleştirilir, o
+// öneke ait ses pencereden atılır ve sadece kuyruk, kesinleşmiş metin prompt
+// olarak verilerek decode edilir. Partial başına maliyet pencere boyutuyla
+// (stream_max_window_ms) sınırlıdır.
+// Hızlı model yüklüyse partial'lar (ve kesinleşen önek) onda çözülür; final
+// kalitesi değişmesin diye finalize cümlenin tamamını ana modelde yeniden
+// çözer.
+class StreamingDecoder {
+ public:
+  // Decode çağrısı (16kHz PCM16); üretimde SttEngine::transcribe_pcm16
+  using Transcriber = std::function<std::vector<TranscriptionResult>(
+      const std::vector<int16_t>&, const RequestOptions&,
+      SttEngine::PerformanceMetrics*)>;
+
+  StreamingDecoder(SttEngine& engine, RequestOptions base_options);
+  // fast_partials: kRealtimePartial decode'ları ayrı (küçük) modele gider
+  StreamingDecoder(const Settings& settings, bool fast_partials,
+                   Transcriber transcribe, RequestOptions base_options);
+
+  // 16kHz mono PCM16 örnekleri pencereye ekler
+  void append(const int16_t* samples, size_t n_samples);
+
+  // Son decode'dan beri gelen örnek sayısı
+  size_t pending_samples() const { return window_.size() - last_decoded_size_; }
+  size_t window_samples() const { return window_.size(); }
+  bool empty() const { return window_.empty() && committed_text_.empty(); }
+  // Pencerenin ilk örneğinin stream başından itibaren mutlak konumu
+  size_t window_origin() const { return window_origin_; }
+  // Finalin yeniden okuyabileceği ilk örnek (hızlı modelde cümle başı);
+  // bundan önceki VAD olasılıkları atılabilir
+  size_t retained_origin() const {
+    return fast_partials_ ? utterance_origin_ : window_origin_;
+  }
+  // Cümlenin başından beri gelen örnek sayısı (kesinleşenler dahil)
+  size_t utterance_samples() const {
+    return window_origin_ + window_.size() - utterance_origin_;
+  }
+
+  // Pencereyi decode eder, kararlı öneki kesinleştirir
+  StreamUpdate decode_partial(SttEngine::PerformanceMetrics* perf = nullptr);
+
+  // Bu mutlak örnek konumundan sonraki sesi pencereden çıkarıp döner; söz
+  // sonundan sonra gelen ses finalize'dan sonra yeni cümleye eklenir
+  std::vector<int16_t> take_after(size_t sample_pos);
+
+  // Kalan kuyruğu decode eder, tüm cümleyi döner ve durumu sıfırlar
+  StreamUpdate finalize(SttEngine::PerformanceMetrics* perf = nullptr);
+
+  void reset();
+
+  // LocalAgreement-2: hyp'in önceki hipotezle ortak ve tam kelimede biten
+  // önekinin token sayısı. hyp'in tamamı ortaksa son kelime (hala
+  // uzayabilir) dışarıda kalır.
+  static size_t stable_prefix(const std::vector<TokenData>& prev,
+                              const std::vector<TokenData>& hyp);
+
+ private:
+  std::vector<TranscriptionResult> run(const std::vector<int16_t>& pcm,
+                                       size_t origin, std::string prompt,
+                                       RequestPriority priority,
+                                       SttEngine::PerformanceMetrics* perf);
+  void commit_tokens(const std::vector<TokenData>& hyp, size_t n_commit,
+                     StreamUpdate* update);
+  // Pencereye göre token zamanlarını cümle başına taşıyarak out'a ekler
+  void append_shifted(const std::vector<TokenData>& tokens, size_t begin,
+                      size_t end, std::vector<TokenData>* out) const;
+  void drop_window_front(size_t n_samples);
+  std::string build_prompt() const;
+
+  Transcriber transcribe_;
+  RequestOptions base_options_;
+  bool fast_partials_;
+  size_t max_window_samples_;
+  size_t prompt_max_chars_;
+
+  std::vector<int16_t> window_;
+  size_t window_origin_ = 0;
+  size_t utterance_origin_ = 0;  // Cümlenin ilk örneğinin mutlak konumu
+  size_t last_decoded_size_ = 0;
+  std::vector<TokenData> prev_hypothesis_;
+  std::string committed_text_;
+  std::vector<TokenData> committed_tokens_;  // Cümlede kesinleşenler
+  // fast_partials_ iken cümlenin tüm sesi (utterance_origin_'den itibaren)
+  std::vector<int16_t> utterance_;
+};
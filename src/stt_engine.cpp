@@ -3,14 +3,25 @@
 #include <samplerate.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
+#include <exception>
 #include <numeric>
+#include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 
+#include "decode_guard.h"
+#include "memory_info.h"
 #include "prosody_extractor.h"
+#include "request_coalescer.h"
 #include "spdlog/spdlog.h"
 #include "speaker_cluster.h"
+#include "speech_compactor.h"
+#include "tenant_limiter.h"
 #include "suts_logger.h"
 #include "utils.h"
 
@@ -22,23 +33,74 @@ static bool whisper_abort_callback_wrapper(void* user_data) {
   return false;
 }
 
-SttEngine::SttEngine(const Settings& settings) : settings_(settings) {
-  std::string model_path = settings_.model_dir + "/" + settings_.model_filename;
-  spdlog::info("Loading Whisper model from: {}", model_path);
+static double mean_token_prob(const std::vector<DecodedSegment>& segments,
+                              size_t begin, size_t end) {
+  double total = 0.0;
+  size_t n = 0;
+  for (size_t i = begin; i < end; ++i) {
+    for (const auto& tok : segments[i].tokens) total += tok.p;
+    n += segments[i].tokens.size();
+  }
+  return n ? total / static_cast<double>(n) : 0.0;
+}
+
+// Isınma sesi: hafif gürültülü 220Hz ton. Sessizlik, no_speech eşiği ve VAD
+// yüzünden decoder'ı çalıştırmadan dönebilir.
+static std::vector<float> synthetic_audio(size_t n_samples) {
+  std::vector<float> pcm(n_samples);
+  uint32_t seed = 0x2545F491u;
+  for (size_t i = 0; i < n_samples; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    const float noise = static_cast<float>(seed >> 16) / 65536.0f - 0.5f;
+    pcm[i] = 0.1f * std::sin(2.0f * static_cast<float>(M_PI) * 220.0f *
+                             static_cast<float>(i) / WHISPER_SAMPLE_RATE) +
+             0.02f * noise;
+  }
+  return pcm;
+}
+
+static struct whisper_context_params context_params(const Settings& s) {
   struct whisper_context_params cparams = whisper_context_default_params();
 #ifdef GGML_USE_CUDA
   cparams.use_gpu = true;
-  if (settings_.flash_attn) cparams.flash_attn = true;
+  if (s.flash_attn) cparams.flash_attn = true;
+#else
+  (void)s;
 #endif
-  ctx_ = whisper_init_from_file_with_params(model_path.c_str(), cparams);
-  if (!ctx_) throw std::runtime_error("Whisper model initialization failed");
+  return cparams;
+}
 
-  int pool_size = settings_.parallel_requests;
-  if (pool_size < 1) pool_size = 1;
-  for (int i = 0; i < pool_size; ++i) {
-    struct whisper_state* state = whisper_init_state(ctx_);
-    state_pool_.push(state);
-    all_states_.push_back(state);
+LoadedModel::~LoadedModel() {
+  // Esnek havuzun açtığı state'ler context'ten önce kapanır
+  scheduler.reset();
+  for (auto* state : states) whisper_free_state(state);
+  if (ctx) {
+    whisper_free(ctx);
+    spdlog::info("Whisper model released: {}", filename);
+  }
+}
+
+SttEngine::SttEngine(const Settings& settings, EngineMetrics* metrics)
+    : settings_(settings), metrics_(metrics) {
+  warmed_up_ = !settings_.warmup_enabled;
+  tenants_ = std::make_unique<TenantLimiter>(settings_, metrics_);
+  model_ = load_model(settings_.model_filename);
+
+  // [YENİ]: İsteğe bağlı hızlı model. Yüklenemezse partial'lar ana modelde
+  // çözülmeye devam eder.
+  if (!settings_.fast_model_filename.empty()) {
+    spdlog::info("Loading fast (partial) Whisper model: {}",
+                 settings_.fast_model_filename);
+    fast_ctx_ = init_context(settings_.fast_model_filename);
+    if (!fast_ctx_) {
+      spdlog::warn("⚠️ Fast model could not be loaded. Partials use main.");
+    } else {
+      int fast_pool = std::max(1, settings_.fast_parallel_requests);
+      for (int i = 0; i < fast_pool; ++i)
+        fast_states_.push_back(whisper_init_state(fast_ctx_));
+      fast_scheduler_ = std::make_unique<StateScheduler>(
+          fast_states_, settings_, metrics_, tenants_.get());
+    }
   }
 
   if (settings_.enable_vad) {
@@ -47,41 +109,412 @@ SttEngine::SttEngine(const Settings& settings) : settings_(settings) {
     struct whisper_vad_context_params vparams =
         whisper_vad_default_context_params();
     vparams.use_gpu = false;
-    vad_ctx_ =
-        whisper_vad_init_from_file_with_params(vad_path.c_str(), vparams);
+    vparams.n_threads = 1;
+
+    int vad_pool_size = std::max(1, settings_.vad_pool_size);
+    for (int i = 0; i < vad_pool_size; ++i) {
+      struct whisper_vad_context* vctx =
+          whisper_vad_init_from_file_with_params(vad_path.c_str(), vparams);
+      if (!vctx) break;
+      vad_pool_.push(vctx);
+      all_vad_ctxs_.push_back(vctx);
+    }
+    if (all_vad_ctxs_.empty())
+      spdlog::warn("⚠️ VAD model could not be loaded. VAD disabled.");
+    if (metrics_)
+      metrics_->vad_pool_size.Set(static_cast<double>(all_vad_ctxs_.size()));
   }
+
+  if (settings_.state_cpu_affinity) {
+#ifdef STT_GGML_OPENMP
+    // OpenMP takımı thread başına bir kez açılır ve sonraki bağlamaları
+    // devralmaz; bağlama sessizce etkisiz kalacağı için uygulanmaz
+    spdlog::error("❌ STATE_CPU_AFFINITY ignored: ggml was built with OpenMP "
+                  "(rebuild with -DGGML_OPENMP=OFF)");
+#else
+    const std::vector<int> cpus = usable_cpus();
+    // Kümeler başlangıç havuzuna göre planlanır; elastik üst sınır
+    // (capacity) kullanılsaydı az CPU'da kümeler inceler ya da çakışırdı
+    main_core_sets_ = model_->states.size();
+    const size_t fast_sets = fast_states_.size();
+    bool overlapping = false;
+    core_sets_ = plan_core_sets(cpus, main_core_sets_ + fast_sets,
+                                settings_.n_threads, &overlapping);
+    if (overlapping)
+      spdlog::warn("⚠️ {} states x {} threads exceed {} usable CPUs; core "
+                   "sets overlap",
+                   core_sets_.size(), settings_.n_threads, cpus.size());
+    else
+      spdlog::info("State CPU affinity: {} disjoint sets of {} cores",
+                   core_sets_.size(), settings_.n_threads);
+#endif
+  }
+
+  if (settings_.adaptive_audio_ctx) {
+    const int n_audio_ctx = whisper_n_audio_ctx(model_->ctx);
+    std::stringstream ss(settings_.audio_ctx_buckets);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      int bucket = std::atoi(sentiric::utils::trim(item).c_str());
+      if (bucket > 0 && bucket < n_audio_ctx)
+        audio_ctx_buckets_.push_back(bucket);
+    }
+    std::sort(audio_ctx_buckets_.begin(), audio_ctx_buckets_.end());
+    audio_ctx_buckets_.erase(
+        std::unique(audio_ctx_buckets_.begin(), audio_ctx_buckets_.end()),
+        audio_ctx_buckets_.end());
+    if (audio_ctx_buckets_.empty())
+      spdlog::warn("⚠️ No valid audio_ctx bucket in '{}'. Adaptive ctx off.",
+                   settings_.audio_ctx_buckets);
+    else
+      spdlog::info("Adaptive audio_ctx: {} buckets, largest {} ({:.1f}s)",
+                   audio_ctx_buckets_.size(), audio_ctx_buckets_.back(),
+                   audio_ctx_buckets_.back() * 0.02);
+  }
+  if (metrics_) {
+    for (int level = 1; level <= 2; ++level)
+      degraded_counters_[level] = &metrics_->decode_degraded_total.Add(
+          {{"level", std::to_string(level)}});
+    gate_accepted_ =
+        &metrics_->decode_gate_segments_total.Add({{"outcome", "accepted"}});
+    gate_rescored_ =
+        &metrics_->decode_gate_segments_total.Add({{"outcome", "rescored"}});
+    gate_kept_ =
+        &metrics_->decode_gate_segments_total.Add({{"outcome", "kept"}});
+    abort_client_ =
+        &metrics_->decode_aborted_total.Add({{"reason", "client"}});
+    abort_deadline_ =
+        &metrics_->decode_aborted_total.Add({{"reason", "max_decode_time"}});
+    guard_budget_ =
+        &metrics_->decode_guard_total.Add({{"reason", "token_budget"}});
+    guard_repetition_ =
+        &metrics_->decode_guard_total.Add({{"reason", "repetition"}});
+    audio_ctx_counters_[0] =
+        &metrics_->audio_ctx_bucket_total.Add({{"bucket", "full"}});
+    for (int bucket : audio_ctx_buckets_)
+      audio_ctx_counters_[bucket] = &metrics_->audio_ctx_bucket_total.Add(
+          {{"bucket", std::to_string(bucket)}});
+  }
+
+  if (settings_.coalesce_requests) {
+    coalescer_ = std::make_unique<RequestCoalescer>(
+        [this](const float* pcm, size_t n, const DecodeParams& params,
+               const CoalesceContext& context,
+               std::vector<DecodedSegment>* out) {
+          return decode_batch(pcm, n, params, context, out);
+        },
+        settings_, metrics_,
+        [](const LoadedModel& model) {
+          return model.scheduler->queue_depth() > 0;
+        });
+  }
+
+  if (settings_.long_audio_chunking)
+    chunk_pool_ = std::make_unique<EngineExecutor>(
+        1, std::max(1, settings_.long_audio_max_threads));
 }
 
 SttEngine::~SttEngine() {
-  for (auto* state : all_states_) whisper_free_state(state);
-  if (ctx_) whisper_free(ctx_);
-  if (vad_ctx_) whisper_vad_free(vad_ctx_);
+  // Havuzdaki parça işleri state ve VAD context'lerinden önce biter
+  chunk_pool_.reset();
+  for (auto* state : fast_states_) whisper_free_state(state);
+  if (fast_ctx_) whisper_free(fast_ctx_);
+  for (auto* vctx : all_vad_ctxs_) whisper_vad_free(vctx);
+}
+
+bool SttEngine::is_ready() const {
+  return warmed_up_.load() && current_model() != nullptr;
+}
+
+int SttEngine::n_mels() const {
+  auto model = current_model();
+  return model ? whisper_model_n_mels(model->ctx) : 80;
+}
+
+struct whisper_context* SttEngine::init_context(const std::string& filename) {
+  const std::string path = settings_.model_dir + "/" + filename;
+  spdlog::info("Loading Whisper model from: {}", path);
+
+  auto t_start = std::chrono::steady_clock::now();
+  struct whisper_context* ctx = whisper_init_from_file_with_params(
+      path.c_str(), context_params(settings_));
+  if (!ctx) return nullptr;
+
+  const double secs = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - t_start)
+                          .count();
+  const size_t rss = process_rss_bytes();
+  spdlog::info("Model {} loaded in {:.2f}s (RSS {:.0f} MB)", filename, secs,
+               rss / (1024.0 * 1024.0));
+  if (metrics_) {
+    metrics_->model_load_seconds.Add({{"model", filename}}).Set(secs);
+    metrics_->process_rss_bytes.Set(static_cast<double>(rss));
+  }
+  return ctx;
+}
+
+std::shared_ptr<LoadedModel> SttEngine::load_model(
+    const std::string& filename) {
+  auto model = std::make_shared<LoadedModel>();
+  model->filename = filename;
+  model->ctx = init_context(filename);
+  if (!model->ctx)
+    throw std::runtime_error("Whisper model initialization failed");
+
+  int pool_size = settings_.parallel_requests;
+  if (pool_size < 1) pool_size = 1;
+  const size_t rss_before = process_rss_bytes();
+  for (int i = 0; i < pool_size; ++i) {
+    struct whisper_state* state = whisper_init_state(model->ctx);
+    if (!state) throw std::runtime_error("Whisper state allocation failed");
+    model->states.push_back(state);
+  }
+  // Compute tamponları ve KV önbelleği ilk decode'da büyür; esnek havuzun
+  // state ayak izi ancak ısınmış state'lerle ölçülebilir
+  const bool measure_states =
+      settings_.elastic_state_pool && settings_.state_bytes <= 0;
+  if (measure_states) {
+    warm_up_states(model->ctx, model->states, "main");
+    model->warmed = true;
+  }
+  const size_t rss_after = process_rss_bytes();
+  model->scheduler = std::make_unique<StateScheduler>(
+      model->states, settings_, metrics_, tenants_.get());
+  if (metrics_)
+    metrics_->state_pool_size.Set(static_cast<double>(pool_size));
+
+  if (settings_.elastic_state_pool) {
+    // State ayak izi: KV önbelleği + compute tamponları (ısınma sonrası RSS
+    // farkı; ısınmanın geçici tamponları dahil olduğundan temkinli)
+    size_t state_bytes = settings_.state_bytes > 0
+                             ? static_cast<size_t>(settings_.state_bytes)
+                             : (rss_after > rss_before
+                                    ? (rss_after - rss_before) / pool_size
+                                    : 0);
+    ElasticPoolConfig pool;
+    pool.max_states = static_cast<size_t>(
+        std::max(pool_size, settings_.state_pool_max));
+    const size_t limit = cgroup_memory_limit_bytes();
+    if (limit > 0 && state_bytes > 0) {
+      const double budget =
+          static_cast<double>(limit) * settings_.state_pool_memory_fraction -
+          static_cast<double>(rss_after);
+      const size_t fit =
+          pool_size + (budget > 0 ? static_cast<size_t>(budget / state_bytes)
+                                  : 0);
+      pool.max_states = std::min(pool.max_states, fit);
+    }
+    pool.idle_timeout =
+        std::chrono::milliseconds(std::max(1000, settings_.state_pool_idle_ms));
+    struct whisper_context* ctx = model->ctx;
+    // Sonradan açılan state bekleyene verilmeden önce havuz thread'inde ısınır
+    pool.create = [this, ctx]() -> struct whisper_state* {
+      struct whisper_state* state = whisper_init_state(ctx);
+      if (state && settings_.warmup_enabled)
+        warm_up_state(ctx, state, "main", "grown");
+      return state;
+    };
+    pool.destroy = [](struct whisper_state* state) {
+      whisper_free_state(state);
+    };
+    spdlog::info("Elastic state pool: {}..{} states, {:.0f} MB/state, "
+                 "cgroup limit {}",
+                 pool_size, pool.max_states, state_bytes / (1024.0 * 1024.0),
+                 limit > 0 ? std::to_string(limit >> 20) + " MB" : "none");
+    if (metrics_) metrics_->state_bytes.Set(static_cast<double>(state_bytes));
+    model->scheduler->enable_elastic(std::move(pool));
+  }
+  return model;
+}
+
+void SttEngine::bind_state_cores(RequestPriority priority, size_t index,
+                                 ScopedAffinity* affinity) const {
+  if (core_sets_.empty() || main_core_sets_ == 0) return;
+  // Kümeler başlangıç kapasitesine göre planlanır; sonradan büyüyen
+  // state'ler (index >= küme sayısı) dolu kümelere sarmak yerine
+  // bağlanmadan çalışır
+  const bool fast = uses_fast_model(priority);
+  const size_t sets = fast ? core_sets_.size() - main_core_sets_
+                           : main_core_sets_;
+  if (index >= sets) {
+    static std::once_flag log_once;
+    std::call_once(log_once, [] {
+      spdlog::warn("⚠️ Grown states run without CPU affinity (core sets are "
+                   "planned for the initial pool only)");
+    });
+    return;
+  }
+  affinity->bind(core_sets_[(fast ? main_core_sets_ : 0) + index]);
+}
+
+void SttEngine::warm_up_states(
+    struct whisper_context* ctx,
+    const std::vector<struct whisper_state*>& states, const char* pool) {
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < states.size(); ++i) {
+    workers.emplace_back([this, ctx, &states, pool, i] {
+      warm_up_state(ctx, states[i], pool, std::to_string(i));
+    });
+  }
+  for (auto& t : workers) t.join();
+}
+
+void SttEngine::warm_up_state(struct whisper_context* ctx,
+                              struct whisper_state* state, const char* pool,
+                              const std::string& label) {
+  const size_t n_samples = static_cast<size_t>(
+      std::max(100, settings_.warmup_audio_ms) * (WHISPER_SAMPLE_RATE / 1000));
+  const std::vector<float> pcm = synthetic_audio(n_samples);
+  // Gerçek isteklerin decode yolu (beam/best_of, dil tespiti) ısınır
+  const DecodeParams params = resolve_params(RequestOptions());
+  whisper_full_params wparams = make_full_params(params);
+  auto t_start = std::chrono::steady_clock::now();
+  int ret = whisper_full_with_state(ctx, state, wparams, pcm.data(),
+                                    static_cast<int>(pcm.size()));
+  double secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - t_start)
+                    .count();
+  if (ret != 0)
+    spdlog::warn("Warm-up decode failed on {} state {}: {}", pool, label, ret);
+  else
+    spdlog::info("🔥 Warm-up {} state {}: {:.0f}ms", pool, label,
+                 secs * 1000.0);
+  if (metrics_)
+    metrics_->warmup_seconds.Add({{"pool", pool}, {"state", label}}).Set(secs);
+}
+
+void SttEngine::warm_up() {
+  auto t_start = std::chrono::steady_clock::now();
+  std::shared_ptr<LoadedModel> model = current_model();
+  if (model && !model->warmed)
+    warm_up_states(model->ctx, model->states, "main");
+  if (fast_ctx_) warm_up_states(fast_ctx_, fast_states_, "fast");
+
+  // VAD bağlamları sırayla: her biri tek thread ve kısa sürer
+  const std::vector<float> pcm = synthetic_audio(WHISPER_SAMPLE_RATE);
+  for (size_t i = 0; i < all_vad_ctxs_.size(); ++i) {
+    auto t_vad = std::chrono::steady_clock::now();
+    whisper_vad_detect_speech(all_vad_ctxs_[i], pcm.data(),
+                              static_cast<int>(pcm.size()));
+    double secs = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - t_vad)
+                      .count();
+    if (metrics_)
+      metrics_->warmup_seconds
+          .Add({{"pool", "vad"}, {"state", std::to_string(i)}})
+          .Set(secs);
+  }
+
+  warmed_up_ = true;
+  if (metrics_)
+    metrics_->process_rss_bytes.Set(
+        static_cast<double>(process_rss_bytes()));
+  spdlog::info("✅ Warm-up finished in {:.1f}s",
+               std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - t_start)
+                   .count());
+}
+
+std::shared_ptr<LoadedModel> SttEngine::current_model() const {
+  std::lock_guard<std::mutex> lock(model_mu_);
+  return model_;
+}
+
+bool SttEngine::begin_swap(const std::string& model_filename) {
+  std::lock_guard<std::mutex> lock(model_mu_);
+  if (!pending_model_.empty()) return false;
+  pending_model_ = model_filename;
+  last_swap_error_.clear();
+  return true;
+}
+
+void SttEngine::abort_swap(const std::string& error) {
+  std::lock_guard<std::mutex> lock(model_mu_);
+  pending_model_.clear();
+  last_swap_error_ = error;
 }
 
-bool SttEngine::is_ready() const { return ctx_ != nullptr; }
+void SttEngine::swap_model(const std::string& model_filename) {
+  auto t_start = std::chrono::steady_clock::now();
+  std::shared_ptr<LoadedModel> next;
+  try {
+    next = load_model(model_filename);
+    // Yeni model istek almadan önce ısınır; eski model bu sırada hizmette
+    if (settings_.warmup_enabled && !next->warmed)
+      warm_up_states(next->ctx, next->states, "main");
+  } catch (const std::exception& e) {
+    abort_swap(e.what());
+    throw;
+  }
+  double load_s = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - t_start)
+                      .count();
 
-struct whisper_state* SttEngine::acquire_state() {
-  std::unique_lock<std::mutex> lock(pool_mutex_);
+  // Yeni istekler yeni modele gider; eskisini tutan istek/stream'ler
+  // bitince son referansla birlikte serbest bırakılır.
+  std::shared_ptr<LoadedModel> previous;
+  {
+    std::lock_guard<std::mutex> lock(model_mu_);
+    previous = std::move(model_);
+    model_ = next;
+    pending_model_.clear();
+    retired_models_.erase(
+        std::remove_if(retired_models_.begin(), retired_models_.end(),
+                       [](const std::weak_ptr<LoadedModel>& w) {
+                         return w.expired();
+                       }),
+        retired_models_.end());
+    retired_models_.push_back(previous);
+  }
+  spdlog::info("🔁 Model swapped: {} -> {} (loaded in {:.1f}s, {} users "
+               "draining on old model)",
+               previous->filename, model_filename, load_s,
+               previous.use_count() - 1);
+}
+
+SttEngine::ModelStatus SttEngine::model_status() const {
+  std::lock_guard<std::mutex> lock(model_mu_);
+  ModelStatus status;
+  if (model_) status.active = model_->filename;
+  status.pending = pending_model_;
+  status.last_error = last_swap_error_;
+  for (const auto& w : retired_models_)
+    if (!w.expired()) ++status.draining;
+  return status;
+}
 
-  bool acquired = pool_cv_.wait_for(
-      lock, std::chrono::milliseconds(settings_.request_queue_timeout_ms),
-      [this] { return !state_pool_.empty(); });
+struct whisper_vad_context* SttEngine::acquire_vad_context() {
+  auto t_start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(vad_pool_mutex_);
+
+  bool acquired = vad_pool_cv_.wait_for(
+      lock, std::chrono::milliseconds(settings_.vad_queue_timeout_ms),
+      [this] { return !vad_pool_.empty(); });
 
   if (!acquired) {
-    spdlog::warn("⚠️ Engine overload: No whisper state available after {}ms",
-                 settings_.request_queue_timeout_ms);
-    throw EngineBusyException("Server is busy (Queue timeout)");
+    spdlog::warn("⚠️ VAD pool saturated: no context after {}ms, skipping VAD",
+                 settings_.vad_queue_timeout_ms);
+    if (metrics_) metrics_->vad_acquire_timeouts_total.Increment();
+    return nullptr;
   }
 
-  struct whisper_state* state = state_pool_.front();
-  state_pool_.pop();
-  return state;
+  struct whisper_vad_context* vctx = vad_pool_.front();
+  vad_pool_.pop();
+  if (metrics_) {
+    metrics_->vad_pool_in_use.Increment();
+    metrics_->vad_wait_seconds.Observe(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      t_start)
+            .count());
+  }
+  return vctx;
 }
 
-void SttEngine::release_state(struct whisper_state* state) {
-  std::lock_guard<std::mutex> lock(pool_mutex_);
-  state_pool_.push(state);
-  pool_cv_.notify_one();
+void SttEngine::release_vad_context(struct whisper_vad_context* vctx) {
+  std::lock_guard<std::mutex> lock(vad_pool_mutex_);
+  vad_pool_.push(vctx);
+  if (metrics_) metrics_->vad_pool_in_use.Decrement();
+  vad_pool_cv_.notify_one();
 }
 
 std::vector<float> SttEngine::resample_audio(const float* input,
@@ -105,13 +538,47 @@ std::vector<float> SttEngine::resample_audio(const float* input,
   return output;
 }
 
-bool SttEngine::is_speech_detected(const float* pcm, size_t n_samples) {
-  if (!vad_ctx_) return true;
-  std::lock_guard<std::mutex> lock(vad_mutex_);
-  // VAD threshold config'den alınmalı (Whisper VAD API destekliyorsa)
-  // Şimdilik Whisper.cpp VAD API threshold'u parametre olarak almıyor, internal
-  // defaults kullanıyor olabilir Ancak wrapper seviyesinde pre-check yapıyoruz.
-  return whisper_vad_detect_speech(vad_ctx_, pcm, static_cast<int>(n_samples));
+bool SttEngine::is_speech_detected(const float* pcm, size_t n_samples,
+                                   std::vector<float>* out_probs) {
+  if (!has_vad()) return true;
+  // [DÜZELTME]: whisper_vad_detect_speech sadece başarı durumunu döner; karar
+  // çerçeve olasılıkları ve config'deki vad_threshold ile verilir.
+  std::vector<float> probs = speech_probs(pcm, n_samples);
+  if (probs.empty()) return true;  // VAD hatası: sesi düşürme
+  if (out_probs) *out_probs = probs;
+  return std::any_of(probs.begin(), probs.end(), [this](float p) {
+    return p >= settings_.vad_threshold;
+  });
+}
+
+std::vector<float> SttEngine::speech_probs(const float* pcm,
+                                           size_t n_samples) {
+  if (!has_vad() || n_samples == 0) return {};
+  VadGuard guard(*this);
+  struct whisper_vad_context* vctx = guard.get();
+  if (!vctx) return {};
+  if (!whisper_vad_detect_speech(vctx, pcm, static_cast<int>(n_samples)))
+    return {};
+  const int n_probs = whisper_vad_n_probs(vctx);
+  const float* probs = whisper_vad_probs(vctx);
+  if (!probs || n_probs <= 0) return {};
+  return std::vector<float>(probs, probs + n_probs);
+}
+
+int SttEngine::select_audio_ctx(size_t n_samples) const {
+  if (audio_ctx_buckets_.empty() || n_samples == 0) return 0;
+  // Bir encoder konumu 20ms (320 örnek). Son kelimelerin kesilmemesi için
+  // %10 + 8 konum (~160ms) pay bırakılır.
+  size_t needed = (n_samples + 319) / 320;
+  needed += needed / 10 + 8;
+  for (int bucket : audio_ctx_buckets_)
+    if (static_cast<size_t>(bucket) >= needed) return bucket;
+  return 0;
+}
+
+void SttEngine::record_audio_ctx(int audio_ctx) {
+  auto it = audio_ctx_counters_.find(audio_ctx);
+  if (it != audio_ctx_counters_.end()) it->second->Increment();
 }
 
 std::vector<TranscriptionResult> SttEngine::transcribe_pcm16(
@@ -128,8 +595,13 @@ std::vector<TranscriptionResult> SttEngine::transcribe(
     const std::vector<float>& pcmf32, int input_sample_rate,
     const RequestOptions& options, PerformanceMetrics* out_metrics) {
   auto t_start = std::chrono::high_resolution_clock::now();
+  // Erken dönüşler çağırana eski/başlatılmamış değer bırakmaz
+  if (out_metrics) *out_metrics = PerformanceMetrics{};
 
-  if (!ctx_) return {};
+  // İstek boyunca aynı model; hot swap'ta eskisi bu referansla boşalır
+  std::shared_ptr<LoadedModel> model =
+      options.model ? options.model : current_model();
+  if (!model) return {};
   if (options.should_abort && options.should_abort()) return {};
 
   const float* pcm_ptr = pcmf32.data();
@@ -146,6 +618,25 @@ std::vector<TranscriptionResult> SttEngine::transcribe(
 
   ProsodyOptions p_opts = options.prosody_opts;
 
+  // [YENİ]: Uzun tekil istekler stream'lerin ve kısa isteklerin arkasında
+  // (batch sınıfında) bekler
+  RequestPriority priority = options.priority;
+  const size_t batch_samples =
+      static_cast<size_t>(std::max(0, settings_.batch_priority_min_s)) * 16000;
+  if (priority == RequestPriority::kUnary && pcm_size > batch_samples)
+    priority = RequestPriority::kBatch;
+
+  // [YENİ]: Uzun ses paralel parçalı yol
+  const size_t long_audio_samples =
+      static_cast<size_t>(std::max(1, settings_.long_audio_min_s)) * 16000;
+  if (settings_.long_audio_chunking && !options.is_chunk &&
+      model->scheduler->capacity() > 1 && pcm_size > long_audio_samples) {
+    RequestOptions chunked_opts = options;
+    chunked_opts.priority = priority;
+    chunked_opts.model = model;
+    return transcribe_chunked(pcm_ptr, pcm_size, chunked_opts, out_metrics);
+  }
+
   // [DÜZELTME BAŞLANGIÇ]
   // Eski Kod: if (settings_.enable_vad && pcm_size > (16000 * 0.2)) {
   // Açıklama: 0.2 hardcoded değer kaldırıldı. Config'den gelen ms değeri
@@ -166,21 +657,21 @@ std::vector<TranscriptionResult> SttEngine::transcribe(
     return {};  // Boş dön, halüsinasyonu engelle
   }
 
+  // Kırpma modunda VAD olasılıkları sessizlik kapısıyla aynı geçişte alınır
+  const bool trim_silence = settings_.enable_vad && settings_.vad_trim_silence;
+  std::vector<float> frame_probs;
+
   if (settings_.enable_vad) {
-    if (!is_speech_detected(pcm_ptr, pcm_size)) {
+    bool speech =
+        options.vad_session
+            ? options.vad_session->has_speech(
+                  options.vad_sample_offset,
+                  options.vad_sample_offset + pcm_size, settings_.vad_threshold)
+            : is_speech_detected(pcm_ptr, pcm_size,
+                                 trim_silence ? &frame_probs : nullptr);
+    if (!speech) {
       // Sessizlik tespit edildi, Whisper'ı hiç yorma.
       // Sadece boş Affective data dön (UI'da hata olmaması için)
-      TranscriptionResult empty_res;
-      empty_res.text = "";
-      empty_res.language = "unknown";
-      empty_res.prob = 0.0f;
-      empty_res.t0 = 0;
-      empty_res.t1 = static_cast<int64_t>(pcm_size / 16.0);
-      empty_res.speaker_turn_next = false;
-      empty_res.token_count = 0;
-      empty_res.affective = extract_prosody(nullptr, 0, 16000, p_opts);
-      empty_res.speaker_id = "unknown";
-
       if (out_metrics) {
         auto t_now = std::chrono::high_resolution_clock::now();
         out_metrics->queue_time_ms = 0;
@@ -189,83 +680,179 @@ std::vector<TranscriptionResult> SttEngine::transcribe(
         out_metrics->token_count = 0;
       }
 
-      return {empty_res};
+      return {silent_result(pcm_size, p_opts)};
     }
   }
   // [DÜZELTME BİTİŞ]
 
-  StateGuard guard(*this);
-  struct whisper_state* state = guard.get();
+  // [YENİ]: Sessizlik kırpma. Whisper sadece konuşma + pad içeren sıkıştırılmış
+  // tamponu görür; prosody ve zaman damgaları orijinal sese göre kalır.
+  CompactedAudio compacted;
+  if (trim_silence) {
+    if (options.vad_session)
+      frame_probs = options.vad_session->probs_for(
+          options.vad_sample_offset, options.vad_sample_offset + pcm_size);
+    compacted = compact_speech(
+        pcm_ptr, pcm_size, frame_probs, kVadFrameSamples,
+        settings_.vad_threshold,
+        static_cast<size_t>(settings_.vad_trim_pad_ms) * 16,
+        static_cast<size_t>(settings_.vad_trim_min_silence_ms) * 16);
+    if (!compacted.empty()) {
+      spdlog::debug("VAD trim: {} -> {} samples ({} spans)", pcm_size,
+                    compacted.pcm.size(), compacted.spans.size());
+    }
+  }
+  const float* decode_ptr = compacted.empty() ? pcm_ptr : compacted.pcm.data();
+  const size_t decode_size =
+      compacted.empty() ? pcm_size : compacted.pcm.size();
 
-  auto t_acquired = std::chrono::high_resolution_clock::now();
+  DecodeParams params = resolve_params(options);
+  // Seviye, isteği gerçekten çözecek havuzun (ana ya da hızlı model)
+  // kuyruğundan okunur
+  const bool fast_pool = uses_fast_model(priority);
+  const int degrade_level = apply_load_policy(
+      scheduler_for(priority, *model),
+      fast_pool ? &fast_degrade_level_ : &degrade_level_,
+      options.require_token_timestamps, &params);
+  const std::string& target_lang = params.language;
 
-  SpeakerClusterer clusterer(settings_.cluster_threshold);
+  // [YENİ]: Kısa ve uyumlu istekler ortak pencereye paketlenir. Prompt,
+  // tdrz ve otomatik dil tespiti istek başına olduğundan paylaşılamaz.
+  // Stream istekleri (realtime sınıfları) birleştirme beklemesine girmez.
+  const bool coalesce = coalescer_ && !options.is_chunk &&
+                        priority == RequestPriority::kUnary &&
+                        options.prompt.empty() && !options.enable_diarization &&
+                        options.audio_ctx < 0 &&
+                        target_lang != "auto" && params.token_timestamps &&
+                        coalescer_->accepts(decode_size);
 
-  int active_beam_size =
-      (options.beam_size >= 0) ? options.beam_size : settings_.beam_size;
-  float active_temp = (options.temperature >= 0.0f) ? options.temperature
-                                                    : settings_.temperature;
-  int active_best_of =
-      (options.best_of >= 0) ? options.best_of : settings_.best_of;
-  whisper_sampling_strategy strategy = (active_beam_size > 1)
-                                           ? WHISPER_SAMPLING_BEAM_SEARCH
-                                           : WHISPER_SAMPLING_GREEDY;
+  std::vector<DecodedSegment> segments;
+  int ret = 0;
+  bool client_aborted = false;
 
-  whisper_full_params wparams = whisper_full_default_params(strategy);
-  std::function<bool()> abort_fn = options.should_abort;
-  if (abort_fn) {
-    wparams.abort_callback = whisper_abort_callback_wrapper;
-    wparams.abort_callback_user_data = &abort_fn;
-  }
+  if (coalesce) {
+    auto t_submit = std::chrono::high_resolution_clock::now();
+    CoalesceContext context;
+    context.model = model;
+    context.tenant_id = options.tenant_id;
+    context.should_abort = options.should_abort;
+    CoalescedResult batched =
+        coalescer_->submit(decode_ptr, decode_size, params, std::move(context));
+    segments = std::move(batched.segments);
+    if (out_metrics) {
+      out_metrics->queue_time_ms =
+          std::chrono::duration<double, std::milli>(t_submit - t_start)
+              .count() +
+          batched.wait_ms;
+      out_metrics->processing_time_ms = batched.decode_ms;
+      out_metrics->token_count = 0;
+    }
+  } else {
+    StateGuard guard(*this, priority, model, options.tenant_id,
+                     static_cast<double>(decode_size) / WHISPER_SAMPLE_RATE);
+    struct whisper_state* state = guard.get();
+    struct whisper_context* ctx = guard.ctx();
 
-  wparams.print_realtime = false;
-  wparams.print_progress = false;
-  wparams.print_timestamps = !settings_.no_timestamps;
-  wparams.print_special = false;
-  wparams.token_timestamps = true;
-  wparams.suppress_nst = settings_.suppress_nst;
-  wparams.no_speech_thold = settings_.no_speech_threshold;
-  wparams.translate = options.translate;
-  wparams.tdrz_enable = options.enable_diarization;
-  std::string target_lang =
-      options.language.empty() ? settings_.language : options.language;
-  wparams.language = target_lang.c_str();
-  if (!options.prompt.empty()) wparams.initial_prompt = options.prompt.c_str();
-  wparams.temperature = active_temp;
-  if (strategy == WHISPER_SAMPLING_BEAM_SEARCH)
-    wparams.beam_search.beam_size = active_beam_size;
-  else
-    wparams.greedy.best_of = active_best_of;
+    auto t_acquired = std::chrono::high_resolution_clock::now();
 
-  // Gelişmiş Hallucination Parametreleri
-  wparams.entropy_thold = 2.40f;
-  wparams.logprob_thold = settings_.logprob_threshold;
-  wparams.n_threads = settings_.n_threads;
+    // Kuyrukta beklerken istemci gittiyse state hemen geri verilir
+    if (options.should_abort && options.should_abort()) {
+      if (abort_client_) abort_client_->Increment();
+      if (out_metrics) {
+        out_metrics->queue_time_ms =
+            std::chrono::duration<double, std::milli>(t_acquired - t_start)
+                .count();
+        out_metrics->degrade_level = degrade_level;
+      }
+      return {};
+    }
+
+    // [YENİ]: Güven kapısı açıksa beam yerine önce greedy
+    const bool gated =
+        settings_.confidence_gated_beam && params.beam_size > 1;
+    DecodeParams first_pass = params;
+    if (gated) first_pass.beam_size = 1;
 
-  int ret = whisper_full_with_state(ctx_, state, wparams, pcm_ptr,
-                                    static_cast<int>(pcm_size));
+    whisper_full_params wparams = make_full_params(first_pass);
+    // [YENİ]: İstemci iptaline ek olarak sunucu tarafı en uzun decode süresi
+    std::function<bool()> abort_fn = options.should_abort;
+    const bool has_decode_limit = settings_.max_decode_ms > 0;
+    const auto decode_deadline =
+        t_acquired + std::chrono::milliseconds(settings_.max_decode_ms);
+    if (has_decode_limit) {
+      abort_fn = [client = options.should_abort, decode_deadline] {
+        return (client && client()) ||
+               std::chrono::high_resolution_clock::now() >= decode_deadline;
+      };
+    }
+    if (abort_fn) {
+      wparams.abort_callback = whisper_abort_callback_wrapper;
+      wparams.abort_callback_user_data = &abort_fn;
+    }
+    DecodeGuard decode_guard(decode_size, settings_.decode_max_tokens_per_s,
+                             settings_.decode_loop_max_ngram,
+                             settings_.decode_loop_min_tokens,
+                             abort_fn ? &abort_fn : nullptr);
+    if (settings_.decode_guard) decode_guard.install(&wparams);
+    wparams.tdrz_enable = options.enable_diarization;
+    if (!options.prompt.empty())
+      wparams.initial_prompt = options.prompt.c_str();
+    wparams.audio_ctx = (options.audio_ctx >= 0)
+                            ? options.audio_ctx
+                            : select_audio_ctx(decode_size);
+    record_audio_ctx(wparams.audio_ctx);
 
-  auto t_end = std::chrono::high_resolution_clock::now();
+    ret = whisper_full_with_state(ctx, state, wparams, decode_ptr,
+                                  static_cast<int>(decode_size));
+    // Bütçe ya da decode süresi aşımında o ana kadar tamamlanan pencereler
+    // sonuç olarak kalır; istemci iptalinde sonuç atılır
+    if (ret != 0 && abort_fn && abort_fn()) {
+      if (options.should_abort && options.should_abort()) {
+        client_aborted = true;
+      } else if (has_decode_limit && !decode_guard.budget_exceeded()) {
+        if (abort_deadline_) abort_deadline_->Increment();
+        spdlog::warn("Whisper decode exceeded {}ms; returning partial result",
+                     settings_.max_decode_ms);
+        ret = 0;
+      }
+    }
+    if (ret != 0 && decode_guard.budget_exceeded()) ret = 0;
+    if (ret == 0) segments = collect_segments(ctx, state);
+    if (ret == 0 && gated && !decode_guard.budget_exceeded()) {
+      ret = rescore_unsure_segments(
+          ctx, state, params, wparams,
+          settings_.decode_guard ? &decode_guard : nullptr,
+          options.should_abort, &segments);
+      client_aborted = ret != 0;
+    }
+    if (ret == 0 && settings_.decode_guard)
+      finish_guard(decode_guard, &segments);
 
-  if (out_metrics) {
-    out_metrics->queue_time_ms =
-        std::chrono::duration<double, std::milli>(t_acquired - t_start).count();
-    out_metrics->processing_time_ms =
-        std::chrono::duration<double, std::milli>(t_end - t_acquired).count();
-    out_metrics->token_count = 0;
+    auto t_end = std::chrono::high_resolution_clock::now();
+
+    if (out_metrics) {
+      out_metrics->queue_time_ms =
+          std::chrono::duration<double, std::milli>(t_acquired - t_start)
+              .count();
+      out_metrics->processing_time_ms =
+          std::chrono::duration<double, std::milli>(t_end - t_acquired)
+              .count();
+      out_metrics->token_count = 0;
+      out_metrics->audio_ctx = wparams.audio_ctx;
+    }
   }
 
+  if (out_metrics) out_metrics->degrade_level = degrade_level;
+
+  SpeakerClusterer clusterer(settings_.cluster_threshold);
   std::vector<TranscriptionResult> results;
 
   if (ret == 0) {
-    const int n_segments = whisper_full_n_segments_from_state(state);
-
     // Halüsinasyon için 2. Filtre: Düşük olasılıklı tokenler
     const float MIN_AVG_TOKEN_PROB = 0.40f;
 
-    for (int i = 0; i < n_segments; ++i) {
-      const char* text_c = whisper_full_get_segment_text_from_state(state, i);
-      std::string text = text_c ? std::string(text_c) : "";
+    for (auto& seg : segments) {
+      const std::string& text = seg.text;
 
       // [GÜVENLİK] Yasaklı kelimeleri ve kısa anlamsız sesleri (Pffft, Hıhı)
       // filtrele
@@ -277,21 +864,26 @@ std::vector<TranscriptionResult> SttEngine::transcribe(
         continue;
       }
 
-      const int64_t t0 = whisper_full_get_segment_t0_from_state(state, i);
-      const int64_t t1 = whisper_full_get_segment_t1_from_state(state, i);
-      bool speaker_turn_next =
-          whisper_full_get_segment_speaker_turn_next_from_state(state, i);
+      int64_t t0 = seg.t0;
+      int64_t t1 = seg.t1;
+      if (!compacted.empty()) {
+        t0 = compacted.to_original_cs(t0);
+        t1 = compacted.to_original_cs(t1);
+      }
 
-      std::vector<TokenData> tokens;
-      int n_tokens = whisper_full_n_tokens_from_state(state, i);
       double total_prob = 0.0;
       int valid_token_count = 0;
-      for (int j = 0; j < n_tokens; ++j) {
-        auto data = whisper_full_get_token_data_from_state(state, i, j);
-        const char* token_text = whisper_token_to_str(ctx_, data.id);
-        if (data.id >= whisper_token_eot(ctx_)) continue;
-        tokens.push_back({std::string(token_text), data.p, data.t0, data.t1});
-        total_prob += data.p;
+      for (auto& tok : seg.tokens) {
+        // Token zaman damgası kapalıysa (yük altında) segment sınırları
+        if (!params.token_timestamps) {
+          tok.t0 = seg.t0;
+          tok.t1 = seg.t1;
+        }
+        if (!compacted.empty()) {
+          tok.t0 = compacted.to_original_cs(tok.t0);
+          tok.t1 = compacted.to_original_cs(tok.t1);
+        }
+        total_prob += tok.p;
         ++valid_token_count;
       }
 
@@ -328,22 +920,623 @@ std::vector<TranscriptionResult> SttEngine::transcribe(
       } else {
         pros =
             extract_prosody(pcm_ptr + sample_start, seg_samples, 16000, p_opts);
-        if (!pros.speaker_vec.empty()) {
+        if (!pros.speaker_vec.empty() && !options.is_chunk) {
           spk_id = clusterer.assign_or_add(pros.speaker_vec);
         }
       }
 
-      results.push_back({text, target_lang, avg_prob, t0, t1, speaker_turn_next,
-                         tokens, valid_token_count, pros.gender_proxy,
+      results.push_back({text, target_lang, avg_prob, t0, t1,
+                         seg.speaker_turn_next, std::move(seg.tokens),
+                         valid_token_count, pros.gender_proxy,
                          pros.emotion_proxy, pros.arousal, pros.valence, pros,
                          spk_id});
     }
   } else {
-    if (options.should_abort && options.should_abort())
-      spdlog::warn("Whisper processing aborted.");
-    else
+    if (client_aborted) {
+      if (abort_client_) abort_client_->Increment();
+      spdlog::warn("Whisper processing aborted (client gone).");
+    } else
       spdlog::error("Whisper processing failed: {}", ret);
   }
 
   return results;
-}
\ No newline at end of file
+}
+
+DecodeParams SttEngine::resolve_params(const RequestOptions& options) const {
+  DecodeParams params;
+  params.language =
+      options.language.empty() ? settings_.language : options.language;
+  params.translate = options.translate;
+  params.temperature = (options.temperature >= 0.0f) ? options.temperature
+                                                     : settings_.temperature;
+  params.beam_size =
+      (options.beam_size >= 0) ? options.beam_size : settings_.beam_size;
+  params.best_of = (options.best_of >= 0) ? options.best_of : settings_.best_of;
+  return params;
+}
+
+// apply_load_policy'nin seviye başına params'a yaptığıyla birebir
+const char* SttEngine::decode_strategy_name(int degrade_level) {
+  switch (degrade_level) {
+    case 0:
+      return "default";
+    case 1:
+      return "greedy_reduced_fallback";  // beam yok, fallback adımı 0.4
+    default:
+      return "greedy_no_fallback";  // beam ve fallback yok
+  }
+}
+
+int SttEngine::apply_load_policy(StateScheduler& scheduler,
+                                 std::atomic<int>* level_state,
+                                 bool keep_token_timestamps,
+                                 DecodeParams* params) {
+  if (!settings_.adaptive_decoding) return 0;
+
+  const size_t depth = scheduler.queue_depth();
+  const double wait_ms = scheduler.recent_wait_ms();
+  int target = 0;
+  if (depth >= static_cast<size_t>(settings_.degrade_queue_critical) ||
+      wait_ms >= settings_.degrade_wait_critical_ms)
+    target = 2;
+  else if (depth >= static_cast<size_t>(settings_.degrade_queue_high) ||
+           wait_ms >= settings_.degrade_wait_high_ms)
+    target = 1;
+
+  // Histerezis: yük düşük eşiğin altına inmeden seviye düşürülmez
+  const bool main_pool = level_state == &degrade_level_;
+  int level = level_state->load();
+  const bool calm =
+      depth <= static_cast<size_t>(std::max(0, settings_.degrade_queue_low)) &&
+      wait_ms < settings_.degrade_wait_high_ms / 2.0;
+  if (target > level || (target < level && calm)) {
+    if (level_state->compare_exchange_strong(level, target)) {
+      spdlog::warn("⚖️ Load-adaptive decoding ({} pool): level {} -> {} "
+                   "(queue={}, wait={:.0f}ms)",
+                   main_pool ? "main" : "fast", level, target, depth, wait_ms);
+      if (metrics_ && main_pool) metrics_->decode_degrade_level.Set(target);
+    }
+  }
+  level = level_state->load();
+  if (level == 0) return 0;
+
+  const DecodeParams requested = *params;
+  params->beam_size = 1;
+  if (level == 1) {
+    params->best_of = std::min(params->best_of, 2);
+    params->temperature_inc = 0.4f;  // Fallback adımları yarıya
+  } else {
+    params->best_of = 1;
+    params->temperature_inc = 0.0f;  // Fallback yok
+    if (!keep_token_timestamps) params->token_timestamps = false;
+  }
+  if (*params == requested) return 0;  // Zaten ucuz bir istek
+  if (degraded_counters_[level]) degraded_counters_[level]->Increment();
+  return level;
+}
+
+// Not: wparams.language, params.language'in c_str()'ını tutar; params
+// whisper_full çağrısı bitene kadar yaşamalıdır.
+whisper_full_params SttEngine::make_full_params(
+    const DecodeParams& params) const {
+  whisper_sampling_strategy strategy = (params.beam_size > 1)
+                                           ? WHISPER_SAMPLING_BEAM_SEARCH
+                                           : WHISPER_SAMPLING_GREEDY;
+
+  whisper_full_params wparams = whisper_full_default_params(strategy);
+  wparams.print_realtime = false;
+  wparams.print_progress = false;
+  wparams.print_timestamps = !settings_.no_timestamps;
+  wparams.print_special = false;
+  wparams.token_timestamps = params.token_timestamps;
+  wparams.suppress_nst = settings_.suppress_nst;
+  wparams.no_speech_thold = settings_.no_speech_threshold;
+  wparams.translate = params.translate;
+  wparams.language = params.language.c_str();
+  wparams.temperature = params.temperature;
+  if (params.temperature_inc >= 0.0f)
+    wparams.temperature_inc = params.temperature_inc;
+  if (strategy == WHISPER_SAMPLING_BEAM_SEARCH)
+    wparams.beam_search.beam_size = params.beam_size;
+  else
+    wparams.greedy.best_of = params.best_of;
+
+  // Gelişmiş Hallucination Parametreleri
+  wparams.entropy_thold = 2.40f;
+  wparams.logprob_thold = settings_.logprob_threshold;
+  wparams.n_threads = settings_.n_threads;
+  return wparams;
+}
+
+bool SttEngine::segment_unsure(const DecodedSegment& seg) const {
+  if (seg.tokens.empty()) return false;
+  double total = 0.0;
+  std::unordered_map<std::string, int> counts;
+  for (const auto& tok : seg.tokens) {
+    total += tok.p;
+    ++counts[tok.text];
+  }
+  const double n = static_cast<double>(seg.tokens.size());
+  if (total / n < settings_.gate_min_avg_prob) return true;
+
+  // Kısa segmentlerde entropi doğal olarak düşüktür
+  if (seg.tokens.size() < 16) return false;
+  double entropy = 0.0;
+  for (const auto& kv : counts) {
+    const double p = kv.second / n;
+    entropy -= p * std::log(p);
+  }
+  return entropy < settings_.gate_min_entropy;
+}
+
+SttEngine::RescoreResult SttEngine::rescore_spans(
+    std::vector<DecodedSegment>* segments, const std::vector<bool>& unsure,
+    const SpanDecoder& decode_span, const std::function<DecodeStop()>& stop) {
+  RescoreResult result;
+  // Ardışık güvensiz segmentler tek pencerede yeniden çözülür: [begin, end)
+  std::vector<std::pair<size_t, size_t>> spans;
+  for (size_t i = 0; i < segments->size(); ++i) {
+    if (!unsure[i]) continue;
+    ++result.n_unsure;
+    if (!spans.empty() && spans.back().second == i)
+      spans.back().second = i + 1;
+    else
+      spans.push_back({i, i + 1});
+  }
+  result.n_windows = spans.size();
+  if (spans.empty()) return result;
+
+  std::vector<DecodedSegment> merged;
+  size_t next = 0;
+  for (const auto& span : spans) {
+    for (; next < span.first; ++next)
+      merged.push_back(std::move((*segments)[next]));
+
+    const int64_t t0 = (*segments)[span.first].t0;
+    const int64_t t1 = (*segments)[span.second - 1].t1;
+    const size_t n_span = span.second - span.first;
+    // whisper_full 1sn'den kısa pencereyi çözmez; greedy sonucu kalır
+    if (t1 - t0 < 100) {
+      for (size_t i = span.first; i < span.second; ++i)
+        merged.push_back(std::move((*segments)[i]));
+      result.n_kept += n_span;
+      next = span.second;
+      continue;
+    }
+
+    std::vector<DecodedSegment> beam;
+    const int ret = decode_span(t0, t1, &beam);
+    if (ret != 0) {
+      // Durdurulan yeniden çözüm (bütçe, süre, istemci): bu ve sonraki
+      // pencerelerde greedy sonucu kalır; istemci iptalini çağıran ayırır
+      result.stop = stop();
+      if (result.stop != DecodeStop::kNone) {
+        next = span.first;
+        break;
+      }
+      beam.clear();  // Başka hata: bu pencerede greedy korunur
+    }
+    // Beam sonucu greedy'den daha emin değilse greedy korunur
+    if (!beam.empty() && mean_token_prob(beam, 0, beam.size()) >=
+                             mean_token_prob(*segments, span.first,
+                                             span.second)) {
+      for (auto& seg : beam) merged.push_back(std::move(seg));
+      result.n_rescored += n_span;
+    } else {
+      for (size_t i = span.first; i < span.second; ++i)
+        merged.push_back(std::move((*segments)[i]));
+      result.n_kept += n_span;
+    }
+    next = span.second;
+  }
+  for (; next < segments->size(); ++next)
+    merged.push_back(std::move((*segments)[next]));
+  *segments = std::move(merged);
+  return result;
+}
+
+int SttEngine::rescore_unsure_segments(
+    struct whisper_context* ctx, struct whisper_state* state,
+    const DecodeParams& params, const whisper_full_params& first_pass,
+    DecodeGuard* guard, const std::function<bool()>& client_abort,
+    std::vector<DecodedSegment>* segments) {
+  std::vector<bool> unsure(segments->size());
+  for (size_t i = 0; i < segments->size(); ++i)
+    unsure[i] = segment_unsure((*segments)[i]);
+
+  whisper_full_params wparams = make_full_params(params);
+  if (guard) {
+    // Döngü kesme ve token bütçesi yeniden çözümde de geçerli; sayaç ilk
+    // geçişin token'larıyla devam eder (kalan bütçe)
+    guard->install(&wparams);
+  } else {
+    wparams.abort_callback = first_pass.abort_callback;
+    wparams.abort_callback_user_data = first_pass.abort_callback_user_data;
+  }
+  wparams.tdrz_enable = first_pass.tdrz_enable;
+  wparams.initial_prompt = first_pass.initial_prompt;
+  // Greedy metni bağlam olarak verilmez; aynı hatayı tekrar ettirir
+  wparams.no_context = true;
+
+  auto decode_span = [&](int64_t t0, int64_t t1,
+                         std::vector<DecodedSegment>* beam) {
+    // Mel state'te duruyor (n_samples = 0); encoder yalnızca bu pencere
+    // için yeniden çalışır
+    wparams.offset_ms = static_cast<int>(t0 * 10);
+    wparams.duration_ms = static_cast<int>((t1 - t0) * 10);
+    const int span_ctx = select_audio_ctx(static_cast<size_t>(t1 - t0) * 160);
+    wparams.audio_ctx = (span_ctx > 0 && (first_pass.audio_ctx == 0 ||
+                                          span_ctx < first_pass.audio_ctx))
+                            ? span_ctx
+                            : first_pass.audio_ctx;
+    const int ret = whisper_full_with_state(ctx, state, wparams, nullptr, 0);
+    if (ret != 0) return ret;
+    *beam = collect_segments(ctx, state);
+    // Beam de döngüye girebilir; karşılaştırma daraltılmış metinle yapılır
+    if (guard) {
+      bool collapsed = false;
+      for (auto& seg : *beam) collapsed |= guard->collapse_repetitions(&seg);
+      if (collapsed) guard->trip(GuardTrip::kRepetition);
+    }
+    return 0;
+  };
+  auto stop = [&] {
+    if (guard && guard->budget_exceeded()) return DecodeStop::kBudget;
+    if (client_abort && client_abort()) return DecodeStop::kClient;
+    if (first_pass.abort_callback &&
+        first_pass.abort_callback(first_pass.abort_callback_user_data))
+      return DecodeStop::kDeadline;
+    return DecodeStop::kNone;
+  };
+
+  const RescoreResult result =
+      rescore_spans(segments, unsure, decode_span, stop);
+
+  if (gate_accepted_)
+    gate_accepted_->Increment(
+        static_cast<double>(segments->size() - result.n_unsure));
+  if (gate_rescored_ && result.n_rescored)
+    gate_rescored_->Increment(static_cast<double>(result.n_rescored));
+  if (gate_kept_ && result.n_kept)
+    gate_kept_->Increment(static_cast<double>(result.n_kept));
+  if (result.n_windows == 0) return 0;
+
+  switch (result.stop) {
+    case DecodeStop::kClient:
+      return -1;  // Çağıran sonucu atar ve istemci iptali olarak sayar
+    case DecodeStop::kDeadline:
+      if (abort_deadline_) abort_deadline_->Increment();
+      spdlog::warn("Whisper decode exceeded {}ms during beam re-run; "
+                   "returning greedy result",
+                   settings_.max_decode_ms);
+      break;
+    default:
+      break;
+  }
+  SUTS_DEBUG("STT_GATED_BEAM", "", "", "",
+             "Beam re-run on {}/{} unsure segments ({} windows)",
+             result.n_unsure, segments->size(), result.n_windows);
+  return 0;
+}
+
+void SttEngine::finish_guard(const DecodeGuard& guard,
+                             std::vector<DecodedSegment>* segments) {
+  // eot'tan hemen önce başlayan döngüler filtreden kaçabilir
+  bool collapsed = false;
+  for (auto& seg : *segments) collapsed |= guard.collapse_repetitions(&seg);
+
+  // İki neden aynı decode'da birlikte olabilir; her biri ayrı sayılır
+  if (guard.budget_exceeded()) {
+    if (guard_budget_) guard_budget_->Increment();
+    spdlog::warn("Runaway decode aborted: token budget exceeded ({} "
+                 "segments kept)",
+                 segments->size());
+  }
+  if (guard.tripped(GuardTrip::kRepetition) || collapsed) {
+    if (guard_repetition_) guard_repetition_->Increment();
+    SUTS_DEBUG("STT_DECODE_LOOP_TRUNCATED", "", "", "",
+               "Repetition loop truncated in decode");
+  }
+}
+
+std::vector<DecodedSegment> SttEngine::collect_segments(
+    struct whisper_context* ctx, struct whisper_state* state) {
+  std::vector<DecodedSegment> segments;
+  const int n_segments = whisper_full_n_segments_from_state(state);
+  segments.reserve(n_segments);
+
+  for (int i = 0; i < n_segments; ++i) {
+    const char* text_c = whisper_full_get_segment_text_from_state(state, i);
+    DecodedSegment seg;
+    seg.text = text_c ? std::string(text_c) : "";
+    seg.t0 = whisper_full_get_segment_t0_from_state(state, i);
+    seg.t1 = whisper_full_get_segment_t1_from_state(state, i);
+    seg.speaker_turn_next =
+        whisper_full_get_segment_speaker_turn_next_from_state(state, i);
+
+    int n_tokens = whisper_full_n_tokens_from_state(state, i);
+    for (int j = 0; j < n_tokens; ++j) {
+      auto data = whisper_full_get_token_data_from_state(state, i, j);
+      if (data.id >= whisper_token_eot(ctx)) continue;
+      const char* token_text = whisper_token_to_str(ctx, data.id);
+      seg.tokens.push_back({std::string(token_text), data.p, data.t0, data.t1});
+    }
+    segments.push_back(std::move(seg));
+  }
+  return segments;
+}
+
+bool SttEngine::decode_batch(const float* pcm, size_t n_samples,
+                             const DecodeParams& params,
+                             const CoalesceContext& context,
+                             std::vector<DecodedSegment>* out) {
+  // Birleştirilen istekler kısa ve gerçek zamanlı olmayan isteklerdir.
+  // Üyeler aynı modeli tuttuğu için liderin sabitlediği model kullanılır.
+  // State liderin tenant'ı ve kendi sesi adına beklenir; takipçilerin
+  // tenant'ları state alınınca kendi sesleri kadar WFQ'da ilerletilir.
+  const double leader_cost =
+      context.members.empty()
+          ? static_cast<double>(n_samples) / WHISPER_SAMPLE_RATE
+          : context.members.front().second;
+  StateGuard guard(*this, RequestPriority::kUnary, context.model,
+                   context.tenant_id, leader_cost);
+  for (size_t i = 1; i < context.members.size(); ++i)
+    context.model->scheduler->charge(RequestPriority::kUnary,
+                                     context.members[i].first,
+                                     context.members[i].second);
+  struct whisper_state* state = guard.get();
+  struct whisper_context* ctx = guard.ctx();
+  auto t_acquired = std::chrono::high_resolution_clock::now();
+
+  if (context.should_abort && context.should_abort()) {
+    if (abort_client_) abort_client_->Increment();
+    return false;
+  }
+
+  whisper_full_params wparams = make_full_params(params);
+  // Pencerede birbirinden bağımsız sesler var; önceki metin bağlam olmasın
+  wparams.no_context = true;
+  wparams.audio_ctx = select_audio_ctx(n_samples);
+  record_audio_ctx(wparams.audio_ctx);
+
+  std::function<bool()> abort_fn = context.should_abort;
+  const bool has_decode_limit = settings_.max_decode_ms > 0;
+  const auto decode_deadline =
+      t_acquired + std::chrono::milliseconds(settings_.max_decode_ms);
+  if (has_decode_limit) {
+    abort_fn = [client = context.should_abort, decode_deadline] {
+      return (client && client()) ||
+             std::chrono::high_resolution_clock::now() >= decode_deadline;
+    };
+  }
+  if (abort_fn) {
+    wparams.abort_callback = whisper_abort_callback_wrapper;
+    wparams.abort_callback_user_data = &abort_fn;
+  }
+  DecodeGuard decode_guard(n_samples, settings_.decode_max_tokens_per_s,
+                           settings_.decode_loop_max_ngram,
+                           settings_.decode_loop_min_tokens,
+                           abort_fn ? &abort_fn : nullptr);
+  if (settings_.decode_guard) decode_guard.install(&wparams);
+
+  int ret = whisper_full_with_state(ctx, state, wparams, pcm,
+                                    static_cast<int>(n_samples));
+  if (ret != 0 && abort_fn && abort_fn()) {
+    if (context.should_abort && context.should_abort()) {
+      if (abort_client_) abort_client_->Increment();
+      return false;
+    }
+    if (has_decode_limit && !decode_guard.budget_exceeded()) {
+      if (abort_deadline_) abort_deadline_->Increment();
+      spdlog::warn("Coalesced decode exceeded {}ms; returning partial result",
+                   settings_.max_decode_ms);
+      ret = 0;
+    }
+  }
+  if (ret != 0 && decode_guard.budget_exceeded()) ret = 0;
+  if (ret != 0) {
+    spdlog::error("Whisper processing failed for coalesced window: {}", ret);
+    return false;
+  }
+  *out = collect_segments(ctx, state);
+  if (settings_.decode_guard) finish_guard(decode_guard, out);
+  return true;
+}
+
+std::vector<size_t> SttEngine::find_chunk_boundaries(
+    const float* pcm, size_t n_samples, const std::vector<float>& probs,
+    size_t max_chunk_samples) {
+  const size_t frame = kVadFrameSamples;
+  const size_t max_chunk = std::max(frame, max_chunk_samples);
+  const size_t min_chunk = max_chunk * 2 / 3;
+
+  // Çerçeve skoru: VAD varsa konuşma olasılığı, yoksa RMS enerji.
+  // Kesim, pencere içindeki en düşük skorlu (en sessiz) çerçeveden yapılır.
+  std::vector<float> energy;
+  if (probs.empty()) {
+    const size_t n_frames = n_samples / frame;
+    energy.resize(n_frames);
+    for (size_t f = 0; f < n_frames; ++f) {
+      double acc = 0.0;
+      for (size_t i = 0; i < frame; ++i) {
+        float v = pcm[f * frame + i];
+        acc += v * v;
+      }
+      energy[f] = static_cast<float>(std::sqrt(acc / frame));
+    }
+  }
+  const std::vector<float>& scores = probs.empty() ? energy : probs;
+
+  std::vector<size_t> bounds = {0};
+  size_t start = 0;
+  while (n_samples - start > max_chunk) {
+    size_t f_begin = (start + min_chunk) / frame;
+    size_t f_end = std::min(scores.size(), (start + max_chunk) / frame);
+    size_t cut = start + max_chunk;
+    if (f_begin < f_end) {
+      size_t best = f_begin;
+      for (size_t f = f_begin + 1; f < f_end; ++f)
+        if (scores[f] < scores[best]) best = f;
+      cut = best * frame + frame / 2;
+    }
+    bounds.push_back(cut);
+    start = cut;
+  }
+  bounds.push_back(n_samples);
+  return bounds;
+}
+
+TranscriptionResult SttEngine::silent_result(size_t n_samples,
+                                             const ProsodyOptions& p_opts) {
+  TranscriptionResult empty_res;
+  empty_res.text = "";
+  empty_res.language = "unknown";
+  empty_res.prob = 0.0f;
+  empty_res.t0 = 0;
+  empty_res.t1 = static_cast<int64_t>(n_samples / 16.0);
+  empty_res.speaker_turn_next = false;
+  empty_res.token_count = 0;
+  empty_res.affective = extract_prosody(nullptr, 0, 16000, p_opts);
+  empty_res.speaker_id = "unknown";
+  return empty_res;
+}
+
+std::vector<TranscriptionResult> SttEngine::merge_chunk_results(
+    std::vector<std::vector<TranscriptionResult>>* chunk_results,
+    const std::vector<size_t>& bounds, float cluster_threshold,
+    const ProsodyOptions& p_opts) {
+  // Zamanları parça başına kaydır, konuşmacıları tek geçişte ata
+  SpeakerClusterer clusterer(cluster_threshold);
+  std::vector<TranscriptionResult> results;
+  for (size_t i = 0; i < chunk_results->size(); ++i) {
+    const int64_t offset_cs = static_cast<int64_t>(bounds[i] / 160);
+    for (auto& res : (*chunk_results)[i]) {
+      if (res.text.empty()) continue;  // sessiz parça
+      res.t0 += offset_cs;
+      res.t1 += offset_cs;
+      for (auto& tok : res.tokens) {
+        tok.t0 += offset_cs;
+        tok.t1 += offset_cs;
+      }
+      bool has_vec = std::any_of(res.affective.speaker_vec.begin(),
+                                 res.affective.speaker_vec.end(),
+                                 [](float v) { return v != 0.0f; });
+      if (has_vec)
+        res.speaker_id = clusterer.assign_or_add(res.affective.speaker_vec);
+      results.push_back(std::move(res));
+    }
+  }
+  // Hiç konuşma kalmadıysa tek geçişli yolun sessizlik sonucu döner
+  if (results.empty())
+    results.push_back(
+        silent_result(bounds.empty() ? 0 : bounds.back(), p_opts));
+  return results;
+}
+
+std::vector<TranscriptionResult> SttEngine::transcribe_chunked(
+    const float* pcm, size_t n_samples, const RequestOptions& options,
+    PerformanceMetrics* out_metrics) {
+  auto t_start = std::chrono::high_resolution_clock::now();
+
+  // VAD tüm dosyada bir kez koşar: aynı olasılıklar hem kesim noktalarını
+  // seçer hem de parçaların sessizlik kapısı ve kırpmasında okunur.
+  const VadSession* vad = options.vad_session;
+  size_t vad_base = options.vad_sample_offset;
+  std::vector<float> probs =
+      vad ? vad->probs_for(vad_base, vad_base + n_samples)
+          : speech_probs(pcm, n_samples);
+  const size_t max_chunk =
+      static_cast<size_t>(std::max(5, settings_.long_audio_chunk_s)) * 16000;
+  std::vector<size_t> bounds =
+      find_chunk_boundaries(pcm, n_samples, probs, max_chunk);
+  const size_t n_chunks = bounds.size() - 1;
+
+  VadSession file_vad(*this);
+  if (!vad && !probs.empty()) {
+    file_vad.assign(std::move(probs));
+    vad = &file_vad;
+    vad_base = 0;
+  }
+
+  std::vector<std::vector<TranscriptionResult>> chunk_results(n_chunks);
+  std::vector<PerformanceMetrics> chunk_metrics(n_chunks, {0, 0, 0});
+  std::vector<std::exception_ptr> errors(n_chunks);
+  std::atomic<size_t> next_chunk{0};
+
+  // Her worker kendi state'ini StateGuard ile alır; eşzamanlılık havuzla
+  // sınırlıdır, boştaki state'ler parçaları sırayla çeker.
+  auto worker = [&]() {
+    for (size_t i = next_chunk++; i < n_chunks; i = next_chunk++) {
+      RequestOptions chunk_opts = options;
+      chunk_opts.is_chunk = true;
+      chunk_opts.vad_session = vad;
+      chunk_opts.vad_sample_offset = vad_base + bounds[i];
+      std::vector<float> chunk(pcm + bounds[i], pcm + bounds[i + 1]);
+      try {
+        chunk_results[i] =
+            transcribe(chunk, 16000, chunk_opts, &chunk_metrics[i]);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+
+  // Yardımcılar paylaşılan parça havuzundan gelir; çağıran thread de parça
+  // çektiği için havuz doluyken de ilerleme sürer. Geç başlayan yardımcı
+  // kapanmış sayacı görüp bu çağrının yığınına dokunmadan döner.
+  struct HelperSync {
+    std::mutex mu;
+    std::condition_variable cv;
+    size_t active = 0;
+    bool closed = false;
+  };
+  auto sync = std::make_shared<HelperSync>();
+  const size_t n_workers =
+      std::min(n_chunks, options.model->scheduler->capacity());
+  for (size_t w = 1; w < n_workers; ++w) {
+    chunk_pool_->submit([sync, &worker] {
+      {
+        std::lock_guard<std::mutex> lock(sync->mu);
+        if (sync->closed) return;
+        ++sync->active;
+      }
+      worker();
+      std::lock_guard<std::mutex> lock(sync->mu);
+      --sync->active;
+      sync->cv.notify_all();
+    });
+  }
+  worker();
+  {
+    std::unique_lock<std::mutex> lock(sync->mu);
+    sync->closed = true;
+    sync->cv.wait(lock, [&sync] { return sync->active == 0; });
+  }
+
+  for (auto& e : errors)
+    if (e) std::rethrow_exception(e);
+
+  SUTS_DEBUG("STT_LONG_AUDIO_CHUNKED", "", "", "",
+             "Long audio ({:.1f}s) decoded in {} chunks on {} states",
+             n_samples / 16000.0, n_chunks, n_workers);
+
+  std::vector<TranscriptionResult> results = merge_chunk_results(
+      &chunk_results, bounds, settings_.cluster_threshold,
+      options.prosody_opts);
+
+  if (out_metrics) {
+    auto t_end = std::chrono::high_resolution_clock::now();
+    out_metrics->queue_time_ms = 0;
+    out_metrics->token_count = 0;
+    for (const auto& m : chunk_metrics) {
+      out_metrics->queue_time_ms =
+          std::max(out_metrics->queue_time_ms, m.queue_time_ms);
+      out_metrics->token_count += m.token_count;
+      out_metrics->degrade_level =
+          std::max(out_metrics->degrade_level, m.degrade_level);
+    }
+    out_metrics->processing_time_ms =
+        std::chrono::duration<double, std::milli>(t_end - t_start).count();
+  }
+  return results;
+}
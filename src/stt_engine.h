@@ -1,7 +1,9 @@
 #pragma once
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -9,8 +11,13 @@
 #include <vector>
 
 #include "config.h"
+#include "cpu_affinity.h"
+#include "engine_executor.h"
+#include "engine_metrics.h"
 #include "prosody_extractor.h"
 #include "speaker_cluster.h"
+#include "state_scheduler.h"
+#include "vad_session.h"
 #include "whisper.h"
 
 struct TokenData {
@@ -20,6 +27,41 @@ struct TokenData {
   int64_t t1;
 };
 
+// whisper_full çıktısındaki ham segment (filtre ve prosody öncesi)
+struct DecodedSegment {
+  std::string text;
+  int64_t t0;
+  int64_t t1;
+  bool speaker_turn_next;
+  std::vector<TokenData> tokens;
+};
+
+// İstek ayarlarıyla Settings birleştirildikten sonraki decode parametreleri.
+// Birleştirilmiş (coalesced) isteklerin aynı pencereyi paylaşabilmesi için
+// bu alanların birebir aynı olması gerekir.
+struct DecodeParams {
+  std::string language;
+  bool translate = false;
+  float temperature = 0.0f;
+  int beam_size = 1;
+  int best_of = 1;
+  float temperature_inc = -1.0f;  // <0: whisper varsayılanı
+  bool token_timestamps = true;
+
+  bool operator==(const DecodeParams& o) const {
+    return language == o.language && translate == o.translate &&
+           temperature == o.temperature && beam_size == o.beam_size &&
+           best_of == o.best_of && temperature_inc == o.temperature_inc &&
+           token_timestamps == o.token_timestamps;
+  }
+};
+
+class DecodeGuard;
+class RequestCoalescer;
+struct CoalesceContext;
+class TenantLimiter;
+struct LoadedModel;
+
 struct RequestOptions {
   std::string language;
   std::string prompt;
@@ -30,7 +72,39 @@ struct RequestOptions {
   int best_of = -1;
 
   ProsodyOptions prosody_opts;
+  // İstemci iptali / deadline: true dönerse decode durdurulur ve sonuç
+  // atılır. Sunucular gRPC IsCancelled + deadline ve HTTP bağlantı
+  // kopmasını buraya bağlar.
   std::function<bool()> should_abort = nullptr;
+
+  // [YENİ]: Stream'lerde VAD kararı, sesi yeniden taramak yerine oturumun
+  // önceden hesaplanmış çerçeve olasılıklarından okunur. Offset, tamponun
+  // ilk örneğinin oturumdaki mutlak konumudur.
+  const VadSession* vad_session = nullptr;
+  size_t vad_sample_offset = 0;
+
+  // [İÇ]: Uzun sesin bir parçası. Tekrar parçalanmaz; konuşmacı ataması
+  // birleştirme sonrası tek geçişte yapılır.
+  bool is_chunk = false;
+
+  // Encoder bağlamı: -1 otomatik (adaptive_audio_ctx), 0 tam pencere (1500),
+  // >0 sabit değer (benchmark için)
+  int audio_ctx = -1;
+
+  // [YENİ]: Çağıran sonucu token zaman damgalarıyla keser (StreamingDecoder);
+  // yük uyarlamalı decode bu istekte token zaman damgalarını kapatmaz.
+  bool require_token_timestamps = false;
+
+  // [YENİ]: State havuzu kabul sınıfı. kUnary, batch_priority_min_s'den uzun
+  // seslerde otomatik olarak kBatch'e düşürülür.
+  RequestPriority priority = RequestPriority::kUnary;
+
+  // Havuz doluyken tenant'lar arası adil sıralama (WFQ) için
+  std::string tenant_id;
+
+  // [YENİ]: Sabitlenmiş model (stream'ler). Boşsa o anki aktif model
+  // kullanılır; hot swap sonrası eski model son kullanıcısıyla boşalır.
+  std::shared_ptr<LoadedModel> model;
 };
 
 struct TranscriptionResult {
@@ -56,21 +130,74 @@ class EngineBusyException : public std::runtime_error {
   EngineBusyException(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+// Baskı altında düşürülen stream partial'ı (hata değil, sessizce atlanır)
+class PartialDroppedException : public EngineBusyException {
+ public:
+  PartialDroppedException(const std::string& msg) : EngineBusyException(msg) {}
+};
+
+// Tenant kotası aşıldı (reason: "concurrency" / "rate")
+class TenantQuotaException : public EngineBusyException {
+ public:
+  TenantQuotaException(const std::string& msg, std::string reason,
+                       double retry_after_s)
+      : EngineBusyException(msg),
+        reason_(std::move(reason)),
+        retry_after_s_(retry_after_s) {}
+
+  const std::string& reason() const { return reason_; }
+  double retry_after_s() const { return retry_after_s_; }
+
+ private:
+  std::string reason_;
+  double retry_after_s_;
+};
+
+// [YENİ]: Yüklü Whisper modeli ve ona ait state havuzu. Hot swap'ta yeni
+// slot arka planda hazırlanıp atomik olarak değiştirilir; eski slot onu
+// tutan son istek/stream bittiğinde serbest bırakılır.
+struct LoadedModel {
+  std::string filename;
+  struct whisper_context* ctx = nullptr;
+  std::vector<struct whisper_state*> states;
+  std::unique_ptr<StateScheduler> scheduler;
+  bool warmed = false;  // State'ler yüklemede ısındı (ayak izi ölçümü için)
+
+  LoadedModel() = default;
+  LoadedModel(const LoadedModel&) = delete;
+  LoadedModel& operator=(const LoadedModel&) = delete;
+  ~LoadedModel();
+};
+
 class SttEngine {
  public:
-  explicit SttEngine(const Settings& settings);
+  explicit SttEngine(const Settings& settings,
+                     EngineMetrics* metrics = nullptr);
   ~SttEngine();
   bool is_ready() const;
 
+  // [YENİ]: Havuzdaki tüm state'leri (ana + hızlı model) ve VAD
+  // bağlamlarını sentetik sesle paralel çalıştırır. warmup_enabled iken
+  // bu çağrı bitene kadar is_ready() false döner.
+  void warm_up();
+  bool warmed_up() const { return warmed_up_.load(); }
+
   // [YENİ]: Ayarları gRPC Server'a sunmak için getter
   const Settings& get_settings() const { return settings_; }
 
+  // transcribe her dönüş yolunda doldurur; decode yapılmadan dönülen
+  // durumlarda (model yok, iptal) ölçülmeyen alanlar sıfırdır
   struct PerformanceMetrics {
-    double queue_time_ms;
-    double processing_time_ms;
-    int token_count;
+    double queue_time_ms = 0.0;
+    double processing_time_ms = 0.0;
+    int token_count = 0;
+    int audio_ctx = 0;  // Kullanılan encoder bağlamı (0 = tam pencere)
+    int degrade_level = 0;  // Yük nedeniyle uygulanan ucuzlatma (0 = yok)
   };
 
+  // PerformanceMetrics::degrade_level'in uyguladığı decode stratejisi
+  static const char* decode_strategy_name(int degrade_level);
+
   std::vector<TranscriptionResult> transcribe(
       const std::vector<float>& pcmf32, int input_sample_rate,
       const RequestOptions& options, PerformanceMetrics* out_metrics = nullptr);
@@ -79,38 +206,250 @@ class SttEngine {
       const std::vector<int16_t>& pcm16, int input_sample_rate,
       const RequestOptions& options, PerformanceMetrics* out_metrics = nullptr);
 
+  // [YENİ]: 16kHz ses için Silero çerçeve (kVadFrameSamples) olasılıkları.
+  // VAD yüklü değilse boş döner.
+  static constexpr size_t kVadFrameSamples = 512;  // 32ms
+  bool has_vad() const { return !all_vad_ctxs_.empty(); }
+  std::vector<float> speech_probs(const float* pcm, size_t n_samples);
+
+  int n_mels() const;
+
+  // Uzun sesin parça sınırları ({0, ..., n_samples}); her parça en fazla
+  // max_chunk_samples. probs: tüm dosyanın VAD olasılıkları (boşsa RMS
+  // enerjisi kullanılır)
+  static std::vector<size_t> find_chunk_boundaries(
+      const float* pcm, size_t n_samples, const std::vector<float>& probs,
+      size_t max_chunk_samples);
+
+  // Sessiz ses için dönen tek boş sonuç (t1 = ses süresi, cs)
+  static TranscriptionResult silent_result(size_t n_samples,
+                                           const ProsodyOptions& p_opts);
+  // Parça sonuçlarını bounds'a göre kaydırıp birleştirir; sessiz parçalar
+  // atlanır, hepsi sessizse silent_result(bounds.back()) döner
+  static std::vector<TranscriptionResult> merge_chunk_results(
+      std::vector<std::vector<TranscriptionResult>>* chunk_results,
+      const std::vector<size_t>& bounds, float cluster_threshold,
+      const ProsodyOptions& p_opts);
+
+  // Güven kapısı yeniden çözümü neden durdu
+  enum class DecodeStop { kNone, kBudget, kDeadline, kClient };
+  struct RescoreResult {
+    size_t n_unsure = 0;
+    size_t n_windows = 0;  // Yeniden çözülecek ardışık aralıklar
+    size_t n_rescored = 0;  // Beam sonucu alınan segmentler
+    size_t n_kept = 0;      // Greedy sonucu korunan segmentler
+    DecodeStop stop = DecodeStop::kNone;
+  };
+  // [t0, t1) (cs) penceresini beam ile çözer; whisper dönüş kodu
+  using SpanDecoder = std::function<int(int64_t, int64_t,
+                                        std::vector<DecodedSegment>*)>;
+  // unsure[i] segmentlerinin ardışık aralıklarını decode_span ile yeniden
+  // çözer; beam daha emin değilse greedy kalır. decode_span başarısız olunca
+  // stop() nedeni verir: durdurulduysa o ve sonraki aralıklar greedy kalır
+  // (segments her durumda eksiksizdir).
+  static RescoreResult rescore_spans(std::vector<DecodedSegment>* segments,
+                                     const std::vector<bool>& unsure,
+                                     const SpanDecoder& decode_span,
+                                     const std::function<DecodeStop()>& stop);
+
+  // [YENİ]: Model hot swap. current_model() istek/stream başında alınır ve
+  // bitene kadar tutulur. Swap önce begin_swap ile ayrılır (sürmekte olan
+  // varsa false); indirme dahil tüm iş bu ayrım altında yapılır ve
+  // swap_model ya da abort_swap ile biter. swap_model yeni modeli ve state
+  // havuzunu çağıran thread'de yükler, sonra yeni istekleri ona yönlendirir.
+  // Yükleme başarısızsa exception fırlatır; aktif model değişmez.
+  std::shared_ptr<LoadedModel> current_model() const;
+  bool begin_swap(const std::string& model_filename);
+  void abort_swap(const std::string& error);
+  void swap_model(const std::string& model_filename);
+
+  struct ModelStatus {
+    std::string active;
+    std::string pending;  // Yüklenmekte olan (boş = yok)
+    std::string last_error;
+    int draining = 0;  // Henüz serbest bırakılmamış eski modeller
+  };
+  ModelStatus model_status() const;
+
+  // [YENİ]: Partial'lar ayrı (küçük) modelde mi çözülüyor
+  bool has_fast_model() const { return fast_ctx_ != nullptr; }
+
+  // [YENİ]: Klip uzunluğuna göre en küçük uygun audio_ctx kovası (0 = tam)
+  int select_audio_ctx(size_t n_samples) const;
+  const std::vector<int>& audio_ctx_buckets() const {
+    return audio_ctx_buckets_;
+  }
+
+  // [YENİ]: Tenant kabul kontrolü (sunucular transcribe'dan önce çağırır)
+  TenantLimiter& tenant_limiter() { return *tenants_; }
+
  private:
   std::vector<float> resample_audio(const float* input, size_t input_size,
                                     int src_rate, int target_rate);
-  bool is_speech_detected(const float* pcm, size_t n_samples);
+  bool is_speech_detected(const float* pcm, size_t n_samples,
+                          std::vector<float>* out_probs = nullptr);
+
+  // Uzun ses: sessizlik sınırlarından parçala, havuzda paralel çöz, birleştir
+  std::vector<TranscriptionResult> transcribe_chunked(
+      const float* pcm, size_t n_samples, const RequestOptions& options,
+      PerformanceMetrics* out_metrics);
+  DecodeParams resolve_params(const RequestOptions& options) const;
+  // Yük uyarlamalı decode: seviyeyi günceller, params'ı ucuzlatır
+  // scheduler: isteği çözecek havuz; level_state: o havuzun seviyesi
+  // keep_token_timestamps: seviye 2'de bile token zaman damgaları kapatılmaz
+  int apply_load_policy(StateScheduler& scheduler,
+                        std::atomic<int>* level_state,
+                        bool keep_token_timestamps, DecodeParams* params);
+  whisper_full_params make_full_params(const DecodeParams& params) const;
+  // Güven kapısı: greedy sonucundaki emin olunmayan segmentleri state'teki
+  // mel üzerinden beam ile yeniden çözer. first_pass: greedy geçişin
+  // parametreleri (abort, prompt, audio_ctx buradan alınır). guard: ilk
+  // geçişin koruyucusu (kapalıysa nullptr); yeniden çözüme de takılır.
+  // Bütçe ya da süre aşımında greedy sonucu kalır ve 0 döner; istemci
+  // iptalinde sıfır dışı döner.
+  int rescore_unsure_segments(struct whisper_context* ctx,
+                              struct whisper_state* state,
+                              const DecodeParams& params,
+                              const whisper_full_params& first_pass,
+                              DecodeGuard* guard,
+                              const std::function<bool()>& client_abort,
+                              std::vector<DecodedSegment>* segments);
+  bool segment_unsure(const DecodedSegment& seg) const;
+  // Koruyucu sonucu: kalan döngüleri daraltır, olayları sayar
+  void finish_guard(const DecodeGuard& guard,
+                    std::vector<DecodedSegment>* segments);
+  std::vector<DecodedSegment> collect_segments(struct whisper_context* ctx,
+                                               struct whisper_state* state);
+  // Birleştirilmiş pencereyi liderin modeli ve tenant'ı adına havuzdan
+  // alınan bir state üzerinde çözer (max_decode_ms ve koruyucu dahil)
+  bool decode_batch(const float* pcm, size_t n_samples,
+                    const DecodeParams& params, const CoalesceContext& context,
+                    std::vector<DecodedSegment>* out);
+  void record_audio_ctx(int audio_ctx);
+
+  std::shared_ptr<LoadedModel> load_model(const std::string& filename);
+  // Bağlamı dosyadan yükler; süre + RSS raporlanır (yalnızca metrik).
+  // whisper.cpp ağırlıkları kendi backend tamponlarına kopyalar; replikalar
+  // arası paylaşılan (mmap) ağırlık ertelendi (LOGIC.md §5).
+  struct whisper_context* init_context(const std::string& filename);
+  // Her state'te bir sentetik decode (paralel); süreler log + metrik
+  void warm_up_states(struct whisper_context* ctx,
+                      const std::vector<struct whisper_state*>& states,
+                      const char* pool);
+  // Tek state'i ısıtır; label metrikteki state etiketi
+  void warm_up_state(struct whisper_context* ctx, struct whisper_state* state,
+                     const char* pool, const std::string& label);
+
+  // Hızlı model yüklüyse partial'lar onun havuzundan state alır
+  bool uses_fast_model(RequestPriority priority) const {
+    return fast_ctx_ && priority == RequestPriority::kRealtimePartial;
+  }
+  StateScheduler& scheduler_for(RequestPriority priority,
+                                LoadedModel& model) const {
+    return uses_fast_model(priority) ? *fast_scheduler_ : *model.scheduler;
+  }
+
+  // Çağıran thread'i state'in çekirdek kümesine bağlar (kapalıysa no-op)
+  void bind_state_cores(RequestPriority priority, size_t index,
+                        ScopedAffinity* affinity) const;
 
-  struct whisper_state* acquire_state();
-  void release_state(struct whisper_state* state);
+  // Zaman aşımında nullptr döner (VAD atlanır, istek reddedilmez)
+  struct whisper_vad_context* acquire_vad_context();
+  void release_vad_context(struct whisper_vad_context* vctx);
 
   Settings settings_;
-  struct whisper_context* ctx_ = nullptr;
-  struct whisper_vad_context* vad_ctx_ = nullptr;
+  EngineMetrics* metrics_ = nullptr;
+  std::unique_ptr<TenantLimiter> tenants_;
 
-  std::queue<struct whisper_state*> state_pool_;
-  std::mutex pool_mutex_;
-  std::condition_variable pool_cv_;
-  std::vector<struct whisper_state*> all_states_;
+  mutable std::mutex model_mu_;
+  std::shared_ptr<LoadedModel> model_;
+  std::vector<std::weak_ptr<LoadedModel>> retired_models_;
+  std::string pending_model_;
+  std::string last_swap_error_;
 
-  std::mutex vad_mutex_;
+  struct whisper_context* fast_ctx_ = nullptr;
+  std::unique_ptr<StateScheduler> fast_scheduler_;
+  std::vector<struct whisper_state*> fast_states_;
+
+  std::queue<struct whisper_vad_context*> vad_pool_;
+  std::mutex vad_pool_mutex_;
+  std::condition_variable vad_pool_cv_;
+  std::vector<struct whisper_vad_context*> all_vad_ctxs_;
+
+  std::unique_ptr<RequestCoalescer> coalescer_;
+  // Uzun ses parçaları için paylaşılan, üst sınırlı yardımcı havuz
+  std::unique_ptr<EngineExecutor> chunk_pool_;
+
+  std::atomic<bool> warmed_up_{true};
+  std::atomic<int> degrade_level_{0};       // Ana model havuzu
+  std::atomic<int> fast_degrade_level_{0};  // Hızlı model (partial) havuzu
+  prometheus::Counter* degraded_counters_[3] = {nullptr, nullptr, nullptr};
+  prometheus::Counter* gate_accepted_ = nullptr;
+  prometheus::Counter* gate_rescored_ = nullptr;
+  prometheus::Counter* gate_kept_ = nullptr;
+  prometheus::Counter* abort_client_ = nullptr;
+  prometheus::Counter* abort_deadline_ = nullptr;
+  prometheus::Counter* guard_budget_ = nullptr;
+  prometheus::Counter* guard_repetition_ = nullptr;
+
+  // state_cpu_affinity: önce ana havuzun, sonra hızlı havuzun kümeleri
+  // (başlangıç havuzu boyutunda; elastik büyüyenler bağlanmaz)
+  std::vector<std::vector<int>> core_sets_;
+  size_t main_core_sets_ = 0;
+
+  std::vector<int> audio_ctx_buckets_;  // Artan sırada
+  std::map<int, prometheus::Counter*> audio_ctx_counters_;
 
   // RAII Helper for Exception Safety
   struct StateGuard {
     SttEngine& engine;
+    RequestPriority priority;
+    std::shared_ptr<LoadedModel> model;  // State iade edilene kadar yaşar
     struct whisper_state* state;
+    ScopedAffinity affinity;  // State iadesinden sonra eski maske döner
 
-    StateGuard(SttEngine& e) : engine(e) { state = engine.acquire_state(); }
+    StateGuard(SttEngine& e, RequestPriority p,
+               std::shared_ptr<LoadedModel> m, const std::string& tenant = "",
+               double cost = 1.0)
+        : engine(e), priority(p), model(std::move(m)) {
+      size_t index = 0;
+      state = engine.scheduler_for(priority, *model).acquire(priority, tenant,
+                                                             cost, &index);
+      // Bağlama hata verirse state havuza iade edilir (yıkıcı çalışmaz)
+      try {
+        engine.bind_state_cores(priority, index, &affinity);
+      } catch (...) {
+        engine.scheduler_for(priority, *model).release(state);
+        throw;
+      }
+    }
 
     ~StateGuard() {
       if (state) {
-        engine.release_state(state);
+        engine.scheduler_for(priority, *model).release(state);
       }
     }
 
     struct whisper_state* get() { return state; }
+    // State'in ait olduğu model
+    struct whisper_context* ctx() const {
+      return engine.uses_fast_model(priority) ? engine.fast_ctx_
+                                              : model->ctx;
+    }
+  };
+
+  struct VadGuard {
+    SttEngine& engine;
+    struct whisper_vad_context* vctx;
+
+    VadGuard(SttEngine& e) : engine(e) { vctx = engine.acquire_vad_context(); }
+
+    ~VadGuard() {
+      if (vctx) {
+        engine.release_vad_context(vctx);
+      }
+    }
+
+    struct whisper_vad_context* get() { return vctx; }
   };
 };
\ No newline at end of file
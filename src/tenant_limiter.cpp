@@ -0,0 +1,201 @@
+#include "tenant_limiter.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+#include "stt_engine.h"
+#include "utils.h"
+
+std::unordered_map<std::string, TenantQuota> parse_tenant_limits(
+    const std::string& spec) {
+  std::unordered_map<std::string, TenantQuota> quotas;
+  std::stringstream entries(spec);
+  std::string entry;
+  while (std::getline(entries, entry, ';')) {
+    entry = sentiric::utils::trim(entry);
+    size_t eq = entry.find('=');
+    if (entry.empty() || eq == std::string::npos) continue;
+
+    std::string tenant = sentiric::utils::trim(entry.substr(0, eq));
+    std::vector<std::string> fields;
+    std::stringstream values(entry.substr(eq + 1));
+    std::string field;
+    while (std::getline(values, field, ','))
+      fields.push_back(sentiric::utils::trim(field));
+
+    TenantQuota q;
+    try {
+      if (fields.size() > 0 && !fields[0].empty())
+        q.max_concurrent = std::stoi(fields[0]);
+      if (fields.size() > 1 && !fields[1].empty())
+        q.rate = std::stod(fields[1]);
+      q.burst = q.rate * 10.0;
+      if (fields.size() > 2 && !fields[2].empty())
+        q.burst = std::stod(fields[2]);
+      if (fields.size() > 3 && !fields[3].empty())
+        q.weight = std::stod(fields[3]);
+    } catch (...) {
+      spdlog::warn("⚠️ Invalid tenant limit entry ignored: '{}'", entry);
+      continue;
+    }
+    if (q.weight <= 0.0) q.weight = 1.0;
+    quotas[tenant] = q;
+  }
+  return quotas;
+}
+
+TenantLimiter::Lease::Lease(TenantLimiter* limiter, std::string tenant)
+    : limiter_(limiter), tenant_(std::move(tenant)) {}
+
+TenantLimiter::Lease::Lease(Lease&& other) noexcept
+    : limiter_(other.limiter_), tenant_(std::move(other.tenant_)) {
+  other.limiter_ = nullptr;
+}
+
+TenantLimiter::Lease& TenantLimiter::Lease::operator=(Lease&& other) noexcept {
+  if (this != &other) {
+    if (limiter_) limiter_->release(tenant_);
+    limiter_ = other.limiter_;
+    tenant_ = std::move(other.tenant_);
+    other.limiter_ = nullptr;
+  }
+  return *this;
+}
+
+TenantLimiter::Lease::~Lease() {
+  if (limiter_) limiter_->release(tenant_);
+}
+
+TenantLimiter::TenantLimiter(const Settings& settings, EngineMetrics* metrics)
+    : enabled_(!settings.tenant_limits.empty()),
+      metrics_(metrics),
+      quotas_(parse_tenant_limits(settings.tenant_limits)),
+      max_tracked_(
+          static_cast<size_t>(std::max(1, settings.tenant_max_tracked))) {
+  if (auto it = quotas_.find("*"); it != quotas_.end())
+    default_quota_ = it->second;
+  if (enabled_)
+    spdlog::info("Tenant limits active: {} tenant rules", quotas_.size());
+}
+
+const std::string& TenantLimiter::label(const std::string& tenant) const {
+  static const std::string kOtherLabel = "other";
+  auto it = quotas_.find(tenant);
+  return (it != quotas_.end() && tenant != "*") ? it->first : kOtherLabel;
+}
+
+TenantLimiter::TenantState& TenantLimiter::state_locked(
+    const std::string& tenant) {
+  auto it = tenants_.find(tenant);
+  if (it != tenants_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru);
+    return it->second;
+  }
+
+  if (tenants_.size() >= max_tracked_) evict_locked();
+  TenantState st;
+  auto q = quotas_.find(tenant);
+  st.quota = (q != quotas_.end()) ? q->second : default_quota_;
+  st.tokens = st.quota.burst;
+  st.last_refill = std::chrono::steady_clock::now();
+  st.lru = lru_.insert(lru_.begin(), tenant);
+  return tenants_.emplace(tenant, st).first->second;
+}
+
+void TenantLimiter::evict_locked() {
+  // Açık isteği olan durum atılmaz (lease iadesi payı bulmalı); hepsi
+  // meşgulse harita geçici olarak sınırı aşar
+  for (auto it = lru_.rbegin(); it != lru_.rend(); ++it) {
+    auto st = tenants_.find(*it);
+    if (st->second.active > 0) continue;
+    lru_.erase(std::next(it).base());
+    tenants_.erase(st);
+    return;
+  }
+}
+
+void TenantLimiter::refill_locked(TenantState& st) {
+  auto now = std::chrono::steady_clock::now();
+  double dt = std::chrono::duration<double>(now - st.last_refill).count();
+  st.last_refill = now;
+  st.tokens = std::min(st.quota.burst, st.tokens + dt * st.quota.rate);
+}
+
+TenantLimiter::Lease TenantLimiter::admit(const std::string& tenant,
+                                          double audio_seconds) {
+  if (!enabled_) return Lease();
+
+  std::lock_guard<std::mutex> lock(mu_);
+  TenantState& st = state_locked(tenant);
+
+  const char* reason = nullptr;
+  double retry_after_s = 1.0;
+  if (st.quota.max_concurrent > 0 && st.active >= st.quota.max_concurrent) {
+    reason = "concurrency";
+  } else if (st.quota.rate > 0.0) {
+    refill_locked(st);
+    if (st.tokens <= 0.0) {
+      reason = "rate";
+      retry_after_s = std::max(1.0, -st.tokens / st.quota.rate);
+    }
+  }
+
+  if (reason) {
+    if (metrics_)
+      metrics_->tenant_rejected_total
+          .Add({{"tenant", label(tenant)}, {"reason", reason}})
+          .Increment();
+    throw TenantQuotaException(
+        std::string("Tenant quota exceeded (") + reason + ")", reason,
+        retry_after_s);
+  }
+
+  if (st.quota.rate > 0.0) st.tokens -= audio_seconds;
+  ++st.active;
+  if (metrics_) {
+    metrics_->tenant_active_requests.Add({{"tenant", label(tenant)}})
+        .Increment();
+    metrics_->tenant_audio_seconds_total.Add({{"tenant", label(tenant)}})
+        .Increment(audio_seconds);
+  }
+  return Lease(this, tenant);
+}
+
+void TenantLimiter::charge(const std::string& tenant, double audio_seconds) {
+  if (!enabled_ || audio_seconds <= 0.0) return;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    TenantState& st = state_locked(tenant);
+    if (st.quota.rate > 0.0) {
+      refill_locked(st);
+      st.tokens -= audio_seconds;
+    }
+  }
+  if (metrics_)
+    metrics_->tenant_audio_seconds_total.Add({{"tenant", label(tenant)}})
+        .Increment(audio_seconds);
+}
+
+double TenantLimiter::weight(const std::string& tenant) const {
+  if (!enabled_) return 1.0;
+  auto it = quotas_.find(tenant);
+  return (it != quotas_.end()) ? it->second.weight : default_quota_.weight;
+}
+
+size_t TenantLimiter::tracked() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return tenants_.size();
+}
+
+void TenantLimiter::release(const std::string& tenant) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = tenants_.find(tenant);
+    if (it != tenants_.end() && it->second.active > 0) --it->second.active;
+  }
+  if (metrics_)
+    metrics_->tenant_active_requests.Add({{"tenant", label(tenant)}})
+        .Decrement();
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "config.h"
+#include "engine_metrics.h"
+
+// Tenant başına kota. 0 = sınırsız.
+struct TenantQuota {
+  int max_concurrent = 0;  // Aynı anda açık istek/stream
+  double rate = 0.0;       // Saniyede işlenebilecek ses saniyesi
+  double burst = 0.0;      // Kova kapasitesi (ses saniyesi)
+  double weight = 1.0;     // Havuz doluyken adil paylaşım ağırlığı
+};
+
+// "tenant=eşzamanlı,hız,burst,ağırlık;..." biçimini ayrıştırır. "*" girdisi
+// config'de olmayan tenant'ların her birine ayrı uygulanan varsayılan
+// kotadır. Eksik alanlar
+// varsayılanda kalır; burst verilmezse 10 saniyelik hız kullanılır.
+std::unordered_map<std::string, TenantQuota> parse_tenant_limits(
+    const std::string& spec);
+
+// [YENİ]: Tenant başına eşzamanlılık sınırı ve ses-saniyesi token kovası.
+// Sunucular (HTTP / gRPC) SttEngine::transcribe'dan önce admit() çağırır;
+// kota aşımı TenantQuotaException ile (sebep: concurrency / rate) döner.
+// Ağırlıklar, StateScheduler'ın havuz doluyken tenant'lar arası adil
+// sıralaması (WFQ) için de kullanılır.
+// Config'de adı geçmeyen her tenant "*" kotasıyla kendi durumunu alır; gürültülü
+// bir tenant diğerlerinin payını tüketemez. Durum haritası
+// tenant_max_tracked ile sınırlıdır (dolunca en eski boştaki durum atılır) ve
+// bu tenant'lar metriklerde tek "other" etiketini paylaşır.
+class TenantLimiter {
+ public:
+  // Kabul edilmiş isteğin eşzamanlılık payı; yok edilince iade edilir
+  class Lease {
+   public:
+    Lease() = default;
+    Lease(TenantLimiter* limiter, std::string tenant);
+    Lease(Lease&& other) noexcept;
+    Lease& operator=(Lease&& other) noexcept;
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    ~Lease();
+
+   private:
+    TenantLimiter* limiter_ = nullptr;
+    std::string tenant_;
+  };
+
+  TenantLimiter(const Settings& settings, EngineMetrics* metrics = nullptr);
+
+  bool enabled() const { return enabled_; }
+
+  // Eşzamanlılık ve kova borcunu kontrol eder, audio_seconds'ı kovadan düşer.
+  // Kova borçlanabilir: uzun bir dosya kabul edilir, sonraki istekler borç
+  // kapanana kadar reddedilir.
+  Lease admit(const std::string& tenant, double audio_seconds);
+
+  // Kabul edilmiş stream'e gelen sesi kovaya yazar (reddetmez)
+  void charge(const std::string& tenant, double audio_seconds);
+
+  double weight(const std::string& tenant) const;
+
+  // İzlenen tenant durumu sayısı
+  size_t tracked() const;
+
+ private:
+  struct TenantState {
+    TenantQuota quota;
+    int active = 0;
+    double tokens = 0.0;
+    std::chrono::steady_clock::time_point last_refill;
+    std::list<std::string>::iterator lru;
+  };
+
+  // Metrik etiketi: config'deki tenant ya da "other" (kardinalite sınırı)
+  const std::string& label(const std::string& tenant) const;
+  // Durumu bulur ya da açar; en son kullanılan yapar
+  TenantState& state_locked(const std::string& tenant);
+  // Sınır doluysa en eski, açık isteği olmayan durumu atar
+  void evict_locked();
+  void refill_locked(TenantState& st);
+  void release(const std::string& tenant);
+
+  bool enabled_;
+  EngineMetrics* metrics_;
+  std::unordered_map<std::string, TenantQuota> quotas_;
+  TenantQuota default_quota_;
+  size_t max_tracked_;
+
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, TenantState> tenants_;
+  std::list<std::string> lru_;  // Baş: en son kullanılan
+};
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <unistd.h>
+
 #include <algorithm>
 #include <array>
+#include <cerrno>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
@@ -19,46 +23,78 @@ namespace sentiric::utils {
 
 struct DecodedAudio {
   std::vector<int16_t> pcm_data;
+  // [YENİ]: Süreç içi çözücü (audio_decoder) doğrudan 16kHz mono float
+  // üretir; doluysa pcm_data boştur
+  std::vector<float> pcm_f32;
   int sample_rate = 16000;
   int channels = 1;
   bool is_valid = false;
+
+  size_t num_samples() const {
+    return pcm_f32.empty() ? pcm_data.size() : pcm_f32.size();
+  }
 };
 
-inline std::vector<int16_t> decode_with_ffmpeg(const std::string& input_data) {
+// Son çare: ffmpeg CLI. Giriş mkstemp ile benzersiz bir geçici dosyaya
+// yazılır (eşzamanlı isteklerde ad çakışmaz), çıktı stdout'tan okunur.
+// max_samples > 0 ise çıktı o kadar örneği aşınca okuma kesilir, boş döner
+// ve *too_long işaretlenir
+inline std::vector<int16_t> decode_with_ffmpeg(const std::string& input_data,
+                                               size_t max_samples = 0,
+                                               bool* too_long = nullptr) {
   std::vector<int16_t> output;
-  int rand_id = std::rand();
-  std::string temp_in = "/tmp/stt_in_" + std::to_string(rand_id) + ".bin";
-  std::string temp_out = "/tmp/stt_out_" + std::to_string(rand_id) + ".raw";
-
-  std::ofstream outfile(temp_in, std::ios::binary);
-  if (!outfile.is_open()) {
+  char temp_in[] = "/tmp/stt_in_XXXXXX";
+  int fd = mkstemp(temp_in);
+  if (fd < 0) {
+    spdlog::error("Temp file create failed: {}", std::strerror(errno));
+    return output;
+  }
+  size_t written = 0;
+  while (written < input_data.size()) {
+    ssize_t n = write(fd, input_data.data() + written,
+                      input_data.size() - written);
+    if (n <= 0) break;
+    written += static_cast<size_t>(n);
+  }
+  close(fd);
+  if (written != input_data.size()) {
     spdlog::error("Temp file write failed: {}", temp_in);
+    std::remove(temp_in);
     return output;
   }
-  outfile.write(input_data.data(), input_data.size());
-  outfile.close();
-
-  std::string cmd = "ffmpeg -y -hide_banner -loglevel error -i " + temp_in +
-                    " -f s16le -acodec pcm_s16le -ac 1 -ar 16000 " + temp_out;
-  int ret = std::system(cmd.c_str());
 
-  if (ret == 0) {
-    std::ifstream infile(temp_out, std::ios::binary | std::ios::ate);
-    if (infile.is_open()) {
-      std::streamsize size = infile.tellg();
-      infile.seekg(0, std::ios::beg);
-      if (size > 0) {
-        output.resize(size / 2);
-        infile.read(reinterpret_cast<char*>(output.data()), size);
-        spdlog::info("FFmpeg conversion success: {} bytes -> {} samples", size,
-                     output.size());
+  std::string cmd = "ffmpeg -y -hide_banner -loglevel error -i " +
+                    std::string(temp_in) +
+                    " -f s16le -acodec pcm_s16le -ac 1 -ar 16000 pipe:1";
+  FILE* pipe = popen(cmd.c_str(), "r");
+  if (pipe) {
+    std::string raw;
+    char buffer[64 * 1024];
+    size_t n;
+    bool exceeded = false;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+      raw.append(buffer, n);
+      if (max_samples > 0 && raw.size() / 2 > max_samples) {
+        exceeded = true;
+        break;
       }
     }
+    int ret = pclose(pipe);
+    if (exceeded) {
+      if (too_long) *too_long = true;
+      spdlog::warn("FFmpeg output exceeds {} samples; aborted", max_samples);
+    } else if (ret == 0 && raw.size() >= 2) {
+      output.resize(raw.size() / 2);
+      std::memcpy(output.data(), raw.data(), output.size() * 2);
+      spdlog::info("FFmpeg conversion success: {} bytes -> {} samples",
+                   raw.size(), output.size());
+    } else {
+      spdlog::error("FFmpeg conversion failed with return code: {}", ret);
+    }
   } else {
-    spdlog::error("FFmpeg conversion failed with return code: {}", ret);
+    spdlog::error("FFmpeg could not be started: {}", std::strerror(errno));
   }
-  std::remove(temp_in.c_str());
-  std::remove(temp_out.c_str());
+  std::remove(temp_in);
   return output;
 }
 
@@ -104,6 +140,24 @@ inline bool has_wav_header(const std::string& bytes) {
          (std::memcmp(bytes.data() + 8, "WAVE", 4) == 0);
 }
 
+// Başlıksız veri: 16kHz mono 16-bit PCM varsayılır
+inline DecodedAudio raw_pcm16_audio(const std::string& bytes) {
+  DecodedAudio result;
+  if (bytes.size() % 2 != 0) {
+    spdlog::warn("Raw PCM data size is odd ({}), truncating last byte.",
+                 bytes.size());
+  }
+  size_t samples = bytes.size() / 2;
+  result.pcm_data.resize(samples);
+  if (samples > 0) {
+    std::memcpy(result.pcm_data.data(), bytes.data(), samples * 2);
+  }
+  result.sample_rate = 16000;
+  result.channels = 1;
+  result.is_valid = true;
+  return result;
+}
+
 inline DecodedAudio parse_wav_robust(const std::string& bytes) {
   DecodedAudio result;
   result.is_valid = false;
@@ -121,19 +175,7 @@ inline DecodedAudio parse_wav_robust(const std::string& bytes) {
     spdlog::warn(
         "FFmpeg conversion returned empty. Falling back to Raw PCM "
         "assumption.");
-    if (bytes.size() % 2 != 0) {
-      spdlog::warn("Raw PCM data size is odd ({}), truncating last byte.",
-                   bytes.size());
-    }
-    size_t samples = bytes.size() / 2;
-    result.pcm_data.resize(samples);
-    if (samples > 0) {
-      std::memcpy(result.pcm_data.data(), bytes.data(), samples * 2);
-    }
-    result.sample_rate = 16000;
-    result.channels = 1;
-    result.is_valid = true;
-    return result;
+    return raw_pcm16_audio(bytes);
   }
 
   const uint8_t* data = reinterpret_cast<const uint8_t*>(bytes.data());
@@ -0,0 +1,94 @@
+#include "vad_session.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "stt_engine.h"
+
+VadSession::VadSession(SttEngine& engine) : engine_(engine) {}
+
+void VadSession::push(const int16_t* samples, size_t n_samples) {
+  for (size_t i = 0; i < n_samples; ++i)
+    history_.push_back(static_cast<float>(samples[i]) / 32768.0f);
+  pending_samples_ += n_samples;
+  total_samples_ += n_samples;
+
+  const size_t n_new_frames = pending_samples_ / SttEngine::kVadFrameSamples;
+  if (n_new_frames >= kHopFrames) evaluate(n_new_frames);
+}
+
+void VadSession::flush() {
+  const size_t n_new_frames = pending_samples_ / SttEngine::kVadFrameSamples;
+  if (n_new_frames > 0) evaluate(n_new_frames);
+}
+
+void VadSession::evaluate(size_t n_frames) {
+  const size_t frame = SttEngine::kVadFrameSamples;
+  const size_t new_samples = n_frames * frame;
+  const size_t leftover = pending_samples_ - new_samples;
+  const size_t end = history_.size() - leftover;
+  const size_t context = std::min(kContextFrames * frame, end - new_samples);
+  const size_t begin = end - new_samples - context;
+
+  std::vector<float> probs =
+      engine_.speech_probs(history_.data() + begin, end - begin);
+
+  // VAD hatasında çerçeveler konuşma (1.0) kabul edilir; böylece ses asla
+  // yanlışlıkla sessizlik diye atılmaz.
+  const size_t first = context / frame;
+  for (size_t i = 0; i < n_frames; ++i) {
+    size_t idx = first + i;
+    probs_.push_back(idx < probs.size() ? probs[idx] : 1.0f);
+  }
+
+  pending_samples_ = leftover;
+  const size_t keep =
+      std::min(history_.size(), kContextFrames * frame + leftover);
+  history_.erase(history_.begin(), history_.end() - keep);
+}
+
+void VadSession::assign(std::vector<float> probs) {
+  history_.clear();
+  pending_samples_ = 0;
+  probs_ = std::move(probs);
+  frame_base_ = 0;
+  total_samples_ = probs_.size() * SttEngine::kVadFrameSamples;
+}
+
+float VadSession::prob(size_t frame) const {
+  if (frame < frame_base_ || frame >= frame_end()) return 0.0f;
+  return probs_[frame - frame_base_];
+}
+
+bool VadSession::has_speech(size_t sample_begin, size_t sample_end,
+                            float threshold) const {
+  const size_t frame = SttEngine::kVadFrameSamples;
+  size_t f0 = std::max(sample_begin / frame, frame_base_);
+  size_t f1 = std::min((sample_end + frame - 1) / frame, frame_end());
+  if (f0 >= f1) return true;
+  for (size_t f = f0; f < f1; ++f)
+    if (probs_[f - frame_base_] >= threshold) return true;
+  return false;
+}
+
+std::vector<float> VadSession::probs_for(size_t sample_begin,
+                                         size_t sample_end) const {
+  const size_t frame = SttEngine::kVadFrameSamples;
+  std::vector<float> out;
+  if (sample_end <= sample_begin) return out;
+  out.reserve((sample_end - sample_begin + frame - 1) / frame);
+  for (size_t s = sample_begin; s < sample_end; s += frame) {
+    size_t f = s / frame;
+    out.push_back(f >= frame_base_ && f < frame_end() ? probs_[f - frame_base_]
+                                                      : 1.0f);
+  }
+  return out;
+}
+
+void VadSession::discard_before(size_t sample_pos) {
+  size_t target = sample_pos / SttEngine::kVadFrameSamples;
+  if (target <= frame_base_) return;
+  size_t n = std::min(target - frame_base_, probs_.size());
+  probs_.erase(probs_.begin(), probs_.begin() + n);
+  frame_base_ += n;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SttEngine;
+
+// [YENİ]: Stream başına artımlı VAD oturumu.
+// Gelen ses sadece bir kez, yeni tam çerçeveler halinde değerlendirilir ve
+// çerçeve olasılıkları mutlak (stream başından itibaren) indeksle saklanır.
+// Böylece her partial'da tüm tamponun yeniden taranması (O(n^2)) ortadan
+// kalkar. whisper.cpp VAD API'si LSTM durumunu her çağrıda sıfırladığı için
+// Silero durumu, yeni çerçevelerin önüne eklenen kısa bir bağlam penceresi
+// ile yeniden ısıtılarak taşınır.
+class VadSession {
+ public:
+  static constexpr size_t kContextFrames = 8;
+  static constexpr size_t kHopFrames = 4;  // ~128ms'de bir değerlendir
+  static constexpr int kFrameMs = 32;
+
+  explicit VadSession(SttEngine& engine);
+
+  // 16kHz PCM16 örnekleri ekler; kHopFrames dolunca değerlendirir
+  void push(const int16_t* samples, size_t n_samples);
+  // Bekleyen tüm tam çerçeveleri hemen değerlendirir (decode öncesi)
+  void flush();
+
+  size_t samples_pushed() const { return total_samples_; }
+  size_t frame_begin() const { return frame_base_; }
+  size_t frame_end() const { return frame_base_ + probs_.size(); }
+  float prob(size_t frame) const;
+
+  // [begin, end) mutlak örnek aralığında eşik üstü çerçeve var mı?
+  // Aralıkta hiç değerlendirilmiş çerçeve yoksa (bilinmiyor) true döner.
+  bool has_speech(size_t sample_begin, size_t sample_end,
+                  float threshold) const;
+
+  // [begin, end) aralığını, begin'den itibaren çerçevelere bölünmüş gibi
+  // olasılık dizisi olarak döner (değerlendirilmemiş çerçeveler 1.0)
+  std::vector<float> probs_for(size_t sample_begin, size_t sample_end) const;
+
+  // Tek geçişte hesaplanmış (0. örnekten başlayan) çerçeve olasılıklarını
+  // yükler; uzun tekil isteğin parçaları VAD'ı yeniden koşmaz
+  void assign(std::vector<float> probs);
+
+  // Bu örnek konumundan önceki olasılıkları bellekten atar
+  void discard_before(size_t sample_pos);
+
+ private:
+  void evaluate(size_t n_frames);
+
+  SttEngine& engine_;
+  std::vector<float> history_;  // bağlam + bekleyen örnekler
+  size_t pending_samples_ = 0;
+  size_t total_samples_ = 0;
+
+  std::vector<float> probs_;
+  size_t frame_base_ = 0;  // probs_[0]'ın mutlak çerçeve indeksi
+};
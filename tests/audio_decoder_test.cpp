@@ -0,0 +1,56 @@
+#include "audio_decoder.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace {
+// 16-bit PCM WAV; n_frames çerçeve, her çerçevede channels örnek
+std::string wav(uint16_t channels, uint32_t sample_rate, size_t n_frames) {
+  const uint32_t data_bytes =
+      static_cast<uint32_t>(n_frames * channels * sizeof(int16_t));
+  std::string out;
+  auto put = [&out](const void* p, size_t n) {
+    out.append(static_cast<const char*>(p), n);
+  };
+  auto put32 = [&put](uint32_t v) { put(&v, 4); };
+  auto put16 = [&put](uint16_t v) { put(&v, 2); };
+  out += "RIFF";
+  put32(36 + data_bytes);
+  out += "WAVEfmt ";
+  put32(16);
+  put16(1);
+  put16(channels);
+  put32(sample_rate);
+  put32(sample_rate * channels * 2);
+  put16(static_cast<uint16_t>(channels * 2));
+  put16(16);
+  out += "data";
+  put32(data_bytes);
+  out.append(data_bytes, '\0');
+  return out;
+}
+
+constexpr size_t kLimit = 16000;  // 1sn (16kHz örnek)
+}  // namespace
+
+TEST(AudioDecoderTest, MonoWavWithinLimitIsAccepted) {
+  const auto audio = decode_audio(wav(1, 16000, 16000), kLimit);
+  EXPECT_TRUE(audio.is_valid);
+  EXPECT_EQ(audio.num_samples(), 16000u);
+}
+
+TEST(AudioDecoderTest, StereoWavOverLimitIsRejected) {
+  // 1.1sn stereo: kanal sayısı süreyi kısaltmamalı
+  EXPECT_THROW(decode_audio(wav(2, 16000, 17600), kLimit),
+               AudioTooLongException);
+}
+
+TEST(AudioDecoderTest, LimitUsesWavSampleRate) {
+  // 8kHz'de 1.1sn = 8800 çerçeve
+  EXPECT_THROW(decode_audio(wav(2, 8000, 8800), kLimit),
+               AudioTooLongException);
+  EXPECT_NO_THROW(decode_audio(wav(2, 8000, 7200), kLimit));
+}
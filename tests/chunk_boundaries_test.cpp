@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "stt_engine.h"
+
+namespace {
+constexpr size_t kFrame = SttEngine::kVadFrameSamples;
+constexpr size_t kMaxChunk = 10 * kFrame;
+}  // namespace
+
+TEST(ChunkBoundariesTest, ShortAudioIsOneChunk) {
+  const std::vector<float> pcm(kMaxChunk, 0.1f);
+  EXPECT_EQ(SttEngine::find_chunk_boundaries(pcm.data(), pcm.size(), {},
+                                             kMaxChunk),
+            (std::vector<size_t>{0, kMaxChunk}));
+}
+
+TEST(ChunkBoundariesTest, CutsAtLeastSpeechFrame) {
+  const std::vector<float> pcm(12 * kFrame, 0.1f);
+  std::vector<float> probs(12, 0.9f);
+  probs[8] = 0.1f;
+  // Daha sessiz ama ilk üçte ikide kalan çerçeve seçilmez
+  probs[3] = 0.0f;
+  EXPECT_EQ(SttEngine::find_chunk_boundaries(pcm.data(), pcm.size(), probs,
+                                             kMaxChunk),
+            (std::vector<size_t>{0, 8 * kFrame + kFrame / 2, pcm.size()}));
+}
+
+TEST(ChunkBoundariesTest, FallsBackToEnergyWithoutVad) {
+  std::vector<float> pcm(12 * kFrame, 0.5f);
+  for (size_t i = 7 * kFrame; i < 8 * kFrame; ++i) pcm[i] = 0.0f;
+  EXPECT_EQ(SttEngine::find_chunk_boundaries(pcm.data(), pcm.size(), {},
+                                             kMaxChunk),
+            (std::vector<size_t>{0, 7 * kFrame + kFrame / 2, pcm.size()}));
+}
+
+TEST(ChunkBoundariesTest, EveryChunkFitsTheLimit) {
+  const std::vector<float> pcm(100 * kFrame + 123, 0.5f);
+  const std::vector<float> probs(100, 0.5f);
+  const std::vector<size_t> bounds = SttEngine::find_chunk_boundaries(
+      pcm.data(), pcm.size(), probs, kMaxChunk);
+
+  ASSERT_GE(bounds.size(), 11u);
+  EXPECT_EQ(bounds.front(), 0u);
+  EXPECT_EQ(bounds.back(), pcm.size());
+  for (size_t i = 1; i < bounds.size(); ++i) {
+    EXPECT_GT(bounds[i], bounds[i - 1]);
+    EXPECT_LE(bounds[i] - bounds[i - 1], kMaxChunk);
+  }
+}
+
+TEST(ChunkBoundariesTest, CutsAtLimitPastKnownFrames) {
+  // Olasılıklar sesin başını kapsıyorsa geri kalan sabit boyda kesilir
+  const std::vector<float> pcm(30 * kFrame, 0.5f);
+  const std::vector<float> probs(4, 0.5f);
+  const std::vector<size_t> bounds = SttEngine::find_chunk_boundaries(
+      pcm.data(), pcm.size(), probs, kMaxChunk);
+  EXPECT_EQ(bounds, (std::vector<size_t>{0, kMaxChunk, 2 * kMaxChunk,
+                                         pcm.size()}));
+}
+
+TEST(ChunkMergeTest, AllSilentChunksMatchSinglePassResult) {
+  const std::vector<size_t> bounds = {0, 160000, 240000};
+  const ProsodyOptions p_opts;
+  std::vector<std::vector<TranscriptionResult>> chunks(2);
+  chunks[0].push_back(SttEngine::silent_result(160000, p_opts));
+
+  const auto results =
+      SttEngine::merge_chunk_results(&chunks, bounds, 0.88f, p_opts);
+  const TranscriptionResult expected =
+      SttEngine::silent_result(240000, p_opts);
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].text, "");
+  EXPECT_EQ(results[0].language, expected.language);
+  EXPECT_EQ(results[0].speaker_id, expected.speaker_id);
+  EXPECT_EQ(results[0].t0, 0);
+  EXPECT_EQ(results[0].t1, expected.t1);
+}
+
+TEST(ChunkMergeTest, ShiftsTimesAndDropsSilentChunks) {
+  const std::vector<size_t> bounds = {0, 160000, 240000};
+  const ProsodyOptions p_opts;
+  std::vector<std::vector<TranscriptionResult>> chunks(2);
+  chunks[0].push_back(SttEngine::silent_result(160000, p_opts));
+  TranscriptionResult speech;
+  speech.text = "merhaba";
+  speech.t0 = 10;
+  speech.t1 = 50;
+  chunks[1].push_back(speech);
+
+  const auto results =
+      SttEngine::merge_chunk_results(&chunks, bounds, 0.88f, p_opts);
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].text, "merhaba");
+  EXPECT_EQ(results[0].t0, 1010);
+  EXPECT_EQ(results[0].t1, 1050);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "stt_engine.h"
+
+namespace {
+using DecodeStop = SttEngine::DecodeStop;
+
+// 2sn'lik segment; p tüm token'ların olasılığı
+DecodedSegment segment(const std::string& text, int64_t t0, float p) {
+  DecodedSegment seg;
+  seg.text = text;
+  seg.t0 = t0;
+  seg.t1 = t0 + 200;
+  seg.speaker_turn_next = false;
+  seg.tokens.push_back({text, p, t0, t0 + 200});
+  return seg;
+}
+
+std::vector<DecodedSegment> greedy() {
+  return {segment(" one", 0, 0.9f), segment(" two", 200, 0.3f),
+          segment(" three", 400, 0.9f), segment(" four", 600, 0.3f)};
+}
+
+const std::vector<bool> kUnsure = {false, true, false, true};
+
+std::vector<std::string> texts(const std::vector<DecodedSegment>& segments) {
+  std::vector<std::string> out;
+  for (const auto& seg : segments) out.push_back(seg.text);
+  return out;
+}
+}  // namespace
+
+TEST(ConfidenceGateTest, MoreConfidentBeamReplacesUnsureSpans) {
+  auto segments = greedy();
+  int calls = 0;
+  auto result = SttEngine::rescore_spans(
+      &segments, kUnsure,
+      [&](int64_t t0, int64_t, std::vector<DecodedSegment>* beam) {
+        ++calls;
+        beam->push_back(segment(" beam", t0, 0.8f));
+        return 0;
+      },
+      [] { return DecodeStop::kNone; });
+
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(result.n_unsure, 2u);
+  EXPECT_EQ(result.n_rescored, 2u);
+  EXPECT_EQ(texts(segments), (std::vector<std::string>{" one", " beam",
+                                                       " three", " beam"}));
+}
+
+TEST(ConfidenceGateTest, DeadlineDuringBeamKeepsGreedy) {
+  auto segments = greedy();
+  int calls = 0;
+  auto result = SttEngine::rescore_spans(
+      &segments, kUnsure,
+      [&](int64_t, int64_t, std::vector<DecodedSegment>*) {
+        ++calls;
+        return -6;  // whisper_full abort
+      },
+      [] { return DecodeStop::kDeadline; });
+
+  // Durdurulunca sonraki aralık denenmez; greedy sonucu eksiksiz kalır
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(result.stop, DecodeStop::kDeadline);
+  EXPECT_EQ(texts(segments), texts(greedy()));
+}
+
+TEST(ConfidenceGateTest, ClientAbortIsReportedWithSegmentsIntact) {
+  auto segments = greedy();
+  auto result = SttEngine::rescore_spans(
+      &segments, kUnsure,
+      [](int64_t, int64_t, std::vector<DecodedSegment>*) { return -6; },
+      [] { return DecodeStop::kClient; });
+
+  EXPECT_EQ(result.stop, DecodeStop::kClient);
+  EXPECT_EQ(texts(segments), texts(greedy()));
+}
+
+TEST(ConfidenceGateTest, FailedWindowKeepsGreedyAndContinues) {
+  auto segments = greedy();
+  int calls = 0;
+  auto result = SttEngine::rescore_spans(
+      &segments, kUnsure,
+      [&](int64_t t0, int64_t, std::vector<DecodedSegment>* beam) {
+        if (++calls == 1) return -1;  // Durdurma değil, hata
+        beam->push_back(segment(" beam", t0, 0.8f));
+        return 0;
+      },
+      [] { return DecodeStop::kNone; });
+
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(result.stop, DecodeStop::kNone);
+  EXPECT_EQ(result.n_kept, 1u);
+  EXPECT_EQ(texts(segments), (std::vector<std::string>{" one", " two",
+                                                       " three", " beam"}));
+}
@@ -0,0 +1,101 @@
+#include "decode_guard.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "stt_engine.h"
+
+namespace {
+DecodedSegment segment(const std::vector<std::string>& words) {
+  DecodedSegment seg{"", 0, 0, false, {}};
+  int64_t t = 0;
+  for (const auto& w : words) {
+    seg.tokens.push_back({w, 0.9f, t, t + 10});
+    seg.text += w;
+    t += 10;
+  }
+  seg.t1 = t;
+  return seg;
+}
+}  // namespace
+
+TEST(DecodeGuardTest, EndsWithLoopFindsRepeatedNgram) {
+  EXPECT_TRUE(DecodeGuard::ends_with_loop({1, 2, 3, 4, 4, 4}, 4, 3));
+  EXPECT_TRUE(DecodeGuard::ends_with_loop({5, 1, 2, 1, 2, 1, 2}, 4, 6));
+  EXPECT_FALSE(DecodeGuard::ends_with_loop({1, 2, 3, 4, 5, 6}, 4, 3));
+  // Döngü dizinin sonunda olmalı
+  EXPECT_FALSE(DecodeGuard::ends_with_loop({4, 4, 4, 1, 2}, 4, 3));
+}
+
+TEST(DecodeGuardTest, EndsWithLoopRespectsLimits) {
+  // 3 tekrar yetmez: min_tokens 8 için bigram 4 kez tekrar etmeli
+  EXPECT_FALSE(DecodeGuard::ends_with_loop({5, 1, 2, 1, 2, 1, 2}, 4, 8));
+  EXPECT_TRUE(DecodeGuard::ends_with_loop({1, 2, 1, 2, 1, 2, 1, 2}, 4, 8));
+  // max_ngram'dan uzun döngü aranmaz
+  const std::vector<whisper_token> trigram = {1, 2, 3, 1, 2, 3, 1, 2, 3};
+  EXPECT_FALSE(DecodeGuard::ends_with_loop(trigram, 2, 3));
+  EXPECT_TRUE(DecodeGuard::ends_with_loop(trigram, 3, 3));
+  EXPECT_FALSE(DecodeGuard::ends_with_loop({}, 4, 3));
+}
+
+TEST(DecodeGuardTest, CollapsesRepeatedToken) {
+  DecodeGuard guard(16000, 10.0f, 2, 3, nullptr);
+  DecodedSegment seg = segment({" a", " b", " b", " b", " b", " c"});
+
+  ASSERT_TRUE(guard.collapse_repetitions(&seg));
+  ASSERT_EQ(seg.tokens.size(), 3u);
+  EXPECT_EQ(seg.text, " a b c");
+  // Kalan örnek döngünün bitişini taşır
+  EXPECT_EQ(seg.tokens[1].t0, 10);
+  EXPECT_EQ(seg.tokens[1].t1, 50);
+}
+
+TEST(DecodeGuardTest, CollapsesRepeatedBigram) {
+  DecodeGuard guard(16000, 10.0f, 2, 3, nullptr);
+  DecodedSegment seg = segment({" x", " y", " x", " y", " x", " y"});
+
+  ASSERT_TRUE(guard.collapse_repetitions(&seg));
+  EXPECT_EQ(seg.text, " x y");
+  EXPECT_EQ(seg.tokens.back().t1, 60);
+}
+
+TEST(DecodeGuardTest, LeavesShortRepeatsAlone) {
+  DecodeGuard guard(16000, 10.0f, 2, 3, nullptr);
+  DecodedSegment seg = segment({" no", " no", " yes", " yes"});
+
+  EXPECT_FALSE(guard.collapse_repetitions(&seg));
+  EXPECT_EQ(seg.tokens.size(), 4u);
+  EXPECT_EQ(seg.text, " no no yes yes");
+}
+
+TEST(DecodeGuardTest, BudgetAbortsAfterRepetitionTrip) {
+  DecodeGuard guard(16000, 10.0f, 4, 12, nullptr);
+  whisper_full_params params{};
+  guard.install(&params);
+
+  // Tekrar kesimi tek başına decode'u durdurmaz
+  guard.trip(GuardTrip::kRepetition);
+  EXPECT_FALSE(guard.should_abort());
+  EXPECT_FALSE(params.abort_callback(params.abort_callback_user_data));
+
+  // Sonradan aşılan bütçe önceki nedeni ezmeden abort'u tetikler
+  guard.trip(GuardTrip::kTokenBudget);
+  EXPECT_TRUE(guard.budget_exceeded());
+  EXPECT_TRUE(guard.tripped(GuardTrip::kRepetition));
+  EXPECT_TRUE(guard.should_abort());
+  EXPECT_TRUE(params.abort_callback(params.abort_callback_user_data));
+}
+
+TEST(DecodeGuardTest, ForwardsOuterAbort) {
+  bool cancelled = false;
+  std::function<bool()> outer = [&cancelled] { return cancelled; };
+  DecodeGuard guard(16000, 10.0f, 4, 12, &outer);
+
+  EXPECT_FALSE(guard.should_abort());
+  cancelled = true;
+  EXPECT_TRUE(guard.should_abort());
+  EXPECT_FALSE(guard.tripped(GuardTrip::kTokenBudget));
+}
@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include <stdlib.h>
+
+#include "config.h"
+
+namespace {
+// Testin ortam değişkenlerini sonunda temizler
+class FastModelSettingsTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    unsetenv("STT_WHISPER_SERVICE_FAST_MODEL_SIZE");
+    unsetenv("STT_WHISPER_SERVICE_FAST_MODEL_FILENAME");
+    unsetenv("STT_WHISPER_SERVICE_FAST_PARALLEL_REQUESTS");
+  }
+};
+}  // namespace
+
+TEST_F(FastModelSettingsTest, DisabledByDefault) {
+  const Settings settings = load_settings();
+  EXPECT_TRUE(settings.fast_model_filename.empty());
+  EXPECT_EQ(settings.fast_parallel_requests, 1);
+}
+
+TEST_F(FastModelSettingsTest, SizeSelectsGgmlFile) {
+  setenv("STT_WHISPER_SERVICE_FAST_MODEL_SIZE", "base", 1);
+  setenv("STT_WHISPER_SERVICE_FAST_PARALLEL_REQUESTS", "3", 1);
+  const Settings settings = load_settings();
+  EXPECT_EQ(settings.fast_model_filename, "ggml-base.bin");
+  EXPECT_EQ(settings.fast_parallel_requests, 3);
+}
+
+TEST_F(FastModelSettingsTest, FilenameOverridesSize) {
+  setenv("STT_WHISPER_SERVICE_FAST_MODEL_SIZE", "base", 1);
+  setenv("STT_WHISPER_SERVICE_FAST_MODEL_FILENAME", "custom-q5.bin", 1);
+  EXPECT_EQ(load_settings().fast_model_filename, "custom-q5.bin");
+}
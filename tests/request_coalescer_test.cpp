@@ -0,0 +1,164 @@
+#include "request_coalescer.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr size_t kSecond = 16000;
+
+Settings coalesce_settings(int max_wait_ms) {
+  Settings settings;
+  settings.coalesce_max_wait_ms = max_wait_ms;
+  settings.coalesce_gap_ms = 500;
+  settings.coalesce_max_batch = 2;
+  return settings;
+}
+
+// Paketlenmiş tampon ve bağlamı kaydeder, sabit segmentler döner
+struct FakeDecoder {
+  std::mutex mu;
+  std::vector<size_t> calls;  // Her çağrının örnek sayısı
+  std::vector<std::pair<std::string, double>> members;
+  std::vector<DecodedSegment> segments;
+
+  RequestCoalescer::DecodeFn fn() {
+    return [this](const float*, size_t n_samples, const DecodeParams&,
+                  const CoalesceContext& context,
+                  std::vector<DecodedSegment>* out) {
+      std::lock_guard<std::mutex> lock(mu);
+      calls.push_back(n_samples);
+      members = context.members;
+      *out = segments;
+      return true;
+    };
+  }
+};
+
+CoalesceContext context_for(std::shared_ptr<LoadedModel> model,
+                            const std::string& tenant) {
+  CoalesceContext context;
+  context.model = std::move(model);
+  context.tenant_id = tenant;
+  return context;
+}
+}  // namespace
+
+TEST(RequestCoalescerTest, AcceptsOnlyShortAudio) {
+  Settings settings;
+  settings.coalesce_max_utterance_ms = 5000;
+  RequestCoalescer coalescer(nullptr, settings);
+  EXPECT_FALSE(coalescer.accepts(0));
+  EXPECT_TRUE(coalescer.accepts(5 * kSecond));
+  EXPECT_FALSE(coalescer.accepts(5 * kSecond + 1));
+}
+
+TEST(RequestCoalescerTest, LoneRequestDoesNotWaitForWindow) {
+  FakeDecoder decoder;
+  decoder.segments = {{" hi", 0, 50, false, {{" hi", 0.9f, 0, 50}}}};
+  RequestCoalescer coalescer(decoder.fn(), coalesce_settings(2000));
+
+  const std::vector<float> pcm(kSecond, 0.0f);
+  const auto t_start = std::chrono::steady_clock::now();
+  CoalescedResult res = coalescer.submit(
+      pcm.data(), pcm.size(), DecodeParams(),
+      context_for(std::make_shared<LoadedModel>(), "a"));
+
+  EXPECT_LT(std::chrono::steady_clock::now() - t_start,
+            std::chrono::milliseconds(1000));
+  EXPECT_EQ(res.batch_size, 1u);
+  ASSERT_EQ(res.segments.size(), 1u);
+  EXPECT_EQ(res.segments[0].text, " hi");
+  EXPECT_EQ(decoder.calls, std::vector<size_t>{kSecond});
+}
+
+TEST(RequestCoalescerTest, SplitsSharedWindowByTokenOwner) {
+  auto model = std::make_shared<LoadedModel>();
+  // İkinci ses 1s + 0.5s boşluktan sonra başlar (150cs). Tek segment iki
+  // isteğe yayılır; token ortası hangi sesteyse oraya gider.
+  FakeDecoder decoder;
+  decoder.segments = {{" a b",
+                       10,
+                       200,
+                       true,
+                       {{" a", 0.9f, 10, 50}, {" b", 0.8f, 160, 200}}}};
+
+  // Lider pencereyi açtığında state kuyruğunda bekleyen var: pencere açık
+  // kalır ve ikinci istek katılır
+  std::atomic<bool> leader_waiting{false};
+  RequestCoalescer coalescer(
+      decoder.fn(), coalesce_settings(5000), nullptr,
+      [&leader_waiting](const LoadedModel&) {
+        leader_waiting = true;
+        return true;
+      });
+
+  const std::vector<float> pcm(kSecond, 0.0f);
+  CoalescedResult first;
+  std::thread leader([&] {
+    first = coalescer.submit(pcm.data(), pcm.size(), DecodeParams(),
+                             context_for(model, "a"));
+  });
+  while (!leader_waiting)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  CoalescedResult second = coalescer.submit(
+      pcm.data(), pcm.size(), DecodeParams(), context_for(model, "b"));
+  leader.join();
+
+  ASSERT_EQ(decoder.calls.size(), 1u);
+  EXPECT_EQ(decoder.calls[0], 2 * kSecond + kSecond / 2);
+  // Her tenant kendi sesi kadar ödenir (lider ilk)
+  ASSERT_EQ(decoder.members.size(), 2u);
+  EXPECT_EQ(decoder.members[0].first, "a");
+  EXPECT_EQ(decoder.members[1].first, "b");
+  EXPECT_DOUBLE_EQ(decoder.members[1].second, 1.0);
+
+  EXPECT_EQ(first.batch_size, 2u);
+  ASSERT_EQ(first.segments.size(), 1u);
+  EXPECT_EQ(first.segments[0].text, " a");
+  EXPECT_EQ(first.segments[0].t0, 10);
+  EXPECT_EQ(first.segments[0].t1, 50);
+  // Segment isteğin sonunda kesildi; konuşmacı değişimi taşınmaz
+  EXPECT_FALSE(first.segments[0].speaker_turn_next);
+
+  ASSERT_EQ(second.segments.size(), 1u);
+  EXPECT_EQ(second.segments[0].text, " b");
+  EXPECT_EQ(second.segments[0].t0, 10);
+  EXPECT_EQ(second.segments[0].t1, 50);
+  EXPECT_TRUE(second.segments[0].speaker_turn_next);
+}
+
+TEST(RequestCoalescerTest, ClampsTokensToOwnAudio) {
+  // Token sesin sonunu aşarsa isteğin süresine kırpılır
+  FakeDecoder decoder;
+  decoder.segments = {{" x", 0, 180, false, {{" x", 0.9f, 20, 180}}}};
+  RequestCoalescer coalescer(decoder.fn(), coalesce_settings(0));
+
+  const std::vector<float> pcm(kSecond, 0.0f);
+  CoalescedResult res = coalescer.submit(
+      pcm.data(), pcm.size(), DecodeParams(),
+      context_for(std::make_shared<LoadedModel>(), "a"));
+  ASSERT_EQ(res.segments.size(), 1u);
+  EXPECT_EQ(res.segments[0].t0, 20);
+  EXPECT_EQ(res.segments[0].t1, 100);
+}
+
+TEST(RequestCoalescerTest, PropagatesDecodeErrors) {
+  RequestCoalescer coalescer(
+      [](const float*, size_t, const DecodeParams&, const CoalesceContext&,
+         std::vector<DecodedSegment>*) -> bool {
+        throw EngineBusyException("busy");
+      },
+      coalesce_settings(0));
+
+  const std::vector<float> pcm(kSecond, 0.0f);
+  EXPECT_THROW(coalescer.submit(pcm.data(), pcm.size(), DecodeParams(),
+                                context_for(nullptr, "a")),
+               EngineBusyException);
+}
@@ -0,0 +1,97 @@
+#include "speech_compactor.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+constexpr size_t kFrame = 160;  // 10ms @16kHz
+
+// Her örnek kendi indeksini taşır; kopyalanan aralık doğrudan okunur
+std::vector<float> ramp(size_t n) {
+  std::vector<float> pcm(n);
+  for (size_t i = 0; i < n; ++i) pcm[i] = static_cast<float>(i);
+  return pcm;
+}
+}  // namespace
+
+TEST(SpeechCompactorTest, DropsSilenceAndMapsBack) {
+  const std::vector<float> pcm = ramp(10 * kFrame);
+  const std::vector<float> probs = {1, 1, 0, 0, 0, 0, 0, 0, 1, 1};
+  const CompactedAudio c =
+      compact_speech(pcm.data(), pcm.size(), probs, kFrame, 0.5f, 0, 0);
+
+  ASSERT_EQ(c.spans.size(), 2u);
+  EXPECT_EQ(c.spans[0].orig_start, 0u);
+  EXPECT_EQ(c.spans[0].compact_start, 0u);
+  EXPECT_EQ(c.spans[0].length, 2 * kFrame);
+  EXPECT_EQ(c.spans[1].orig_start, 8 * kFrame);
+  EXPECT_EQ(c.spans[1].compact_start, 2 * kFrame);
+  ASSERT_EQ(c.pcm.size(), 4 * kFrame);
+  EXPECT_EQ(c.pcm[2 * kFrame], static_cast<float>(8 * kFrame));
+
+  EXPECT_EQ(c.to_original_sample(10), 10u);
+  EXPECT_EQ(c.to_original_sample(2 * kFrame + 10), 8 * kFrame + 10);
+  // 2cs = 320 örnek: ikinci parçanın başı
+  EXPECT_EQ(c.to_original_cs(2), 8);
+  EXPECT_EQ(c.to_original_cs(-5), 0);
+}
+
+TEST(SpeechCompactorTest, ClampsPastSpanEnd) {
+  const std::vector<float> pcm = ramp(10 * kFrame);
+  const std::vector<float> probs = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  const CompactedAudio c =
+      compact_speech(pcm.data(), pcm.size(), probs, kFrame, 0.5f, 0, 0);
+
+  ASSERT_EQ(c.spans.size(), 1u);
+  // Tampon sonundan sonrası parçanın sonuna sabitlenir
+  EXPECT_EQ(c.to_original_sample(5 * kFrame), kFrame);
+}
+
+TEST(SpeechCompactorTest, KeepsShortGapsAndPads) {
+  const std::vector<float> pcm = ramp(20 * kFrame);
+  std::vector<float> probs(20, 0.0f);
+  probs[1] = probs[3] = probs[12] = 1.0f;
+  const CompactedAudio c = compact_speech(pcm.data(), pcm.size(), probs,
+                                          kFrame, 0.5f, 80, 2 * kFrame);
+
+  // 1 ve 3 arasındaki kısa boşluk birleşir; pad her iki yana eklenir
+  ASSERT_EQ(c.spans.size(), 2u);
+  EXPECT_EQ(c.spans[0].orig_start, kFrame - 80);
+  EXPECT_EQ(c.spans[0].length, 3 * kFrame + 160);
+  EXPECT_EQ(c.spans[1].orig_start, 12 * kFrame - 80);
+  EXPECT_EQ(c.spans[1].compact_start, c.spans[0].length);
+  EXPECT_EQ(c.pcm.size(), c.spans[0].length + c.spans[1].length);
+}
+
+TEST(SpeechCompactorTest, PadClampsToBufferEdges) {
+  const std::vector<float> pcm = ramp(10 * kFrame);
+  const std::vector<float> probs = {1, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+  const CompactedAudio c =
+      compact_speech(pcm.data(), pcm.size(), probs, kFrame, 0.5f, 100, 0);
+
+  ASSERT_EQ(c.spans.size(), 2u);
+  EXPECT_EQ(c.spans[0].orig_start, 0u);
+  EXPECT_EQ(c.spans[1].orig_start + c.spans[1].length, pcm.size());
+}
+
+TEST(SpeechCompactorTest, ReturnsEmptyWhenGainIsSmall) {
+  const std::vector<float> pcm = ramp(10 * kFrame);
+  const std::vector<float> probs(10, 1.0f);
+  const CompactedAudio c =
+      compact_speech(pcm.data(), pcm.size(), probs, kFrame, 0.5f, 0, 0);
+
+  EXPECT_TRUE(c.empty());
+  // Boş tablo zamanları olduğu gibi geçirir
+  EXPECT_EQ(c.to_original_sample(1234), 1234u);
+  EXPECT_EQ(c.to_original_cs(7), 7);
+}
+
+TEST(SpeechCompactorTest, ReturnsEmptyWithoutSpeech) {
+  const std::vector<float> pcm = ramp(10 * kFrame);
+  const std::vector<float> probs(10, 0.1f);
+  EXPECT_TRUE(compact_speech(pcm.data(), pcm.size(), probs, kFrame, 0.5f, 0,
+                             0)
+                  .empty());
+  EXPECT_TRUE(compact_speech(nullptr, 0, probs, kFrame, 0.5f, 0, 0).empty());
+}
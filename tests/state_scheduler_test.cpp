@@ -0,0 +1,290 @@
+#include "state_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stt_engine.h"
+#include "tenant_limiter.h"
+
+namespace {
+// Zamanlayıcı state'lere dokunmaz; sahte adresler yeterlidir
+std::vector<struct whisper_state*> fake_states(std::vector<int>* storage) {
+  std::vector<struct whisper_state*> states;
+  for (int& slot : *storage)
+    states.push_back(reinterpret_cast<struct whisper_state*>(&slot));
+  return states;
+}
+
+void wait_for_depth(const StateScheduler& scheduler, size_t depth) {
+  while (scheduler.queue_depth() < depth)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+// Sırayla kuyruğa girip state'i alan ve hemen iade eden bekleyenler;
+// alım sırasını kaydeder
+class WaiterGroup {
+ public:
+  explicit WaiterGroup(StateScheduler& scheduler) : scheduler_(scheduler) {}
+  ~WaiterGroup() { join(); }
+
+  void add(RequestPriority priority, const std::string& tenant,
+           const std::string& label, double cost = 1.0) {
+    const size_t depth = scheduler_.queue_depth() + 1;
+    threads_.emplace_back([this, priority, tenant, label, cost] {
+      struct whisper_state* state = scheduler_.acquire(priority, tenant, cost);
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        order_.push_back(label);
+      }
+      scheduler_.release(state);
+    });
+    wait_for_depth(scheduler_, depth);
+  }
+
+  std::vector<std::string> join() {
+    for (auto& t : threads_)
+      if (t.joinable()) t.join();
+    return order_;
+  }
+
+ private:
+  StateScheduler& scheduler_;
+  std::vector<std::thread> threads_;
+  std::mutex mu_;
+  std::vector<std::string> order_;
+};
+}  // namespace
+
+TEST(StateSchedulerTest, FastPathHandsOutLowestFreeSlot) {
+  std::vector<int> storage(3);
+  const auto states = fake_states(&storage);
+  StateScheduler scheduler(states, Settings());
+
+  size_t i0 = 9, i1 = 9;
+  struct whisper_state* a = scheduler.acquire(RequestPriority::kUnary, "", 1.0,
+                                              &i0);
+  struct whisper_state* b = scheduler.acquire(RequestPriority::kUnary, "", 1.0,
+                                              &i1);
+  EXPECT_EQ(a, states[0]);
+  EXPECT_EQ(b, states[1]);
+  EXPECT_EQ(i0, 0u);
+  EXPECT_EQ(i1, 1u);
+
+  // İade edilen düşük slot yeniden ilk verilir
+  scheduler.release(a);
+  size_t again = 9;
+  EXPECT_EQ(scheduler.acquire(RequestPriority::kUnary, "", 1.0, &again), a);
+  EXPECT_EQ(again, 0u);
+  EXPECT_EQ(scheduler.size(), 3u);
+  EXPECT_EQ(scheduler.queue_depth(), 0u);
+}
+
+TEST(StateSchedulerTest, TimesOutWhenPoolIsBusy) {
+  std::vector<int> storage(1);
+  Settings settings;
+  settings.state_timeout_unary_ms = 20;
+  StateScheduler scheduler(fake_states(&storage), settings);
+
+  struct whisper_state* held = scheduler.acquire(RequestPriority::kUnary);
+  EXPECT_THROW(scheduler.acquire(RequestPriority::kUnary),
+               EngineBusyException);
+  EXPECT_EQ(scheduler.queue_depth(), 0u);
+  scheduler.release(held);
+  EXPECT_EQ(scheduler.acquire(RequestPriority::kUnary), held);
+}
+
+TEST(StateSchedulerTest, HigherClassIsServedFirst) {
+  std::vector<int> storage(1);
+  StateScheduler scheduler(fake_states(&storage), Settings());
+  struct whisper_state* held = scheduler.acquire(RequestPriority::kUnary);
+
+  WaiterGroup group(scheduler);
+  group.add(RequestPriority::kBatch, "", "batch");
+  group.add(RequestPriority::kUnary, "", "unary");
+  group.add(RequestPriority::kRealtimeFinal, "", "final");
+  scheduler.release(held);
+
+  EXPECT_EQ(group.join(),
+            (std::vector<std::string>{"final", "unary", "batch"}));
+}
+
+TEST(StateSchedulerTest, FinalDropsWaitingPartials) {
+  std::vector<int> storage(1);
+  StateScheduler scheduler(fake_states(&storage), Settings());
+  struct whisper_state* held = scheduler.acquire(RequestPriority::kUnary);
+
+  bool dropped = false;
+  std::thread partial([&] {
+    try {
+      scheduler.acquire(RequestPriority::kRealtimePartial);
+    } catch (const PartialDroppedException&) {
+      dropped = true;
+    }
+  });
+  wait_for_depth(scheduler, 1);
+
+  struct whisper_state* granted = nullptr;
+  std::thread final_waiter([&] {
+    granted = scheduler.acquire(RequestPriority::kRealtimeFinal);
+    scheduler.release(granted);
+  });
+  // Final kuyruğa girince bekleyen partial bırakılır
+  partial.join();
+  EXPECT_TRUE(dropped);
+  EXPECT_EQ(scheduler.queue_depth(), 1u);
+  // Final beklerken yeni partial kuyruğa hiç girmez
+  EXPECT_THROW(scheduler.acquire(RequestPriority::kRealtimePartial),
+               PartialDroppedException);
+
+  scheduler.release(held);
+  final_waiter.join();
+  EXPECT_EQ(granted, held);
+}
+
+TEST(StateSchedulerTest, FairQueuingInterleavesTenants) {
+  std::vector<int> storage(1);
+  StateScheduler scheduler(fake_states(&storage), Settings());
+  struct whisper_state* held = scheduler.acquire(RequestPriority::kUnary);
+
+  // Düz FIFO a,a,a,b verirdi; b'nin başlangıç etiketi a'nın ikincisinden önce
+  WaiterGroup group(scheduler);
+  group.add(RequestPriority::kUnary, "a", "a1");
+  group.add(RequestPriority::kUnary, "a", "a2");
+  group.add(RequestPriority::kUnary, "a", "a3");
+  group.add(RequestPriority::kUnary, "b", "b1");
+  scheduler.release(held);
+
+  EXPECT_EQ(group.join(),
+            (std::vector<std::string>{"a1", "b1", "a2", "a3"}));
+}
+
+TEST(StateSchedulerTest, WeightsScaleTenantShare) {
+  Settings settings;
+  settings.tenant_limits = "heavy=0,0,0,4";
+  TenantLimiter tenants(settings);
+  std::vector<int> storage(1);
+  StateScheduler scheduler(fake_states(&storage), settings, nullptr,
+                           &tenants);
+  struct whisper_state* held = scheduler.acquire(RequestPriority::kUnary);
+
+  // heavy'nin her isteği 1/4 ilerler: ilk dört istek light'tan önce biter
+  WaiterGroup group(scheduler);
+  group.add(RequestPriority::kUnary, "light", "l1");
+  group.add(RequestPriority::kUnary, "light", "l2");
+  for (int i = 1; i <= 4; ++i)
+    group.add(RequestPriority::kUnary, "heavy", "h" + std::to_string(i));
+  scheduler.release(held);
+
+  EXPECT_EQ(group.join(), (std::vector<std::string>{"l1", "h1", "h2", "h3",
+                                                    "h4", "l2"}));
+}
+
+TEST(StateSchedulerTest, ChargeDefersTenantWithoutWaiting) {
+  std::vector<int> storage(1);
+  StateScheduler scheduler(fake_states(&storage), Settings());
+  struct whisper_state* held = scheduler.acquire(RequestPriority::kUnary);
+
+  // Birleştirilmiş pencere üyesi payını öder; sıradaki isteği geri düşer
+  scheduler.charge(RequestPriority::kUnary, "a", 5.0);
+  WaiterGroup group(scheduler);
+  group.add(RequestPriority::kUnary, "a", "a1");
+  group.add(RequestPriority::kUnary, "b", "b1");
+  scheduler.release(held);
+
+  EXPECT_EQ(group.join(), (std::vector<std::string>{"b1", "a1"}));
+}
+
+TEST(StateSchedulerTest, ElasticGrowDoesNotBlockWaiterTimeout) {
+  std::vector<int> storage(1);
+  Settings settings;
+  settings.elastic_state_pool = true;
+  settings.state_pool_max = 1;
+  settings.state_timeout_unary_ms = 20;
+  StateScheduler scheduler(fake_states(&storage), settings);
+
+  int grown = 0;
+  ElasticPoolConfig pool;
+  pool.max_states = 2;
+  pool.create = [&grown]() {
+    // Yeni state'in açılışı + ısınması
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    return reinterpret_cast<struct whisper_state*>(&grown);
+  };
+  pool.destroy = [](struct whisper_state*) {};
+  scheduler.enable_elastic(std::move(pool));
+
+  struct whisper_state* held = scheduler.acquire(RequestPriority::kUnary);
+  const auto t_start = std::chrono::steady_clock::now();
+  // Büyüme havuz thread'inde sürerken bekleyen kendi süresinde düşer
+  EXPECT_THROW(scheduler.acquire(RequestPriority::kUnary),
+               EngineBusyException);
+  EXPECT_LT(std::chrono::steady_clock::now() - t_start,
+            std::chrono::milliseconds(250));
+  scheduler.release(held);
+}
+
+TEST(StateSchedulerTest, GrownStateGoesToNextWaiter) {
+  std::vector<int> storage(1);
+  Settings settings;
+  settings.elastic_state_pool = true;
+  settings.state_pool_max = 1;
+  StateScheduler scheduler(fake_states(&storage), settings);
+
+  int grown = 0;
+  ElasticPoolConfig pool;
+  pool.max_states = 2;
+  pool.create = [&grown]() {
+    return reinterpret_cast<struct whisper_state*>(&grown);
+  };
+  pool.destroy = [](struct whisper_state*) {};
+  scheduler.enable_elastic(std::move(pool));
+
+  struct whisper_state* held = scheduler.acquire(RequestPriority::kUnary);
+  size_t index = 0;
+  struct whisper_state* extra =
+      scheduler.acquire(RequestPriority::kUnary, "", 1.0, &index);
+  EXPECT_EQ(extra, reinterpret_cast<struct whisper_state*>(&grown));
+  EXPECT_EQ(index, 1u);
+  EXPECT_EQ(scheduler.size(), 2u);
+  EXPECT_EQ(scheduler.capacity(), 2u);
+  scheduler.release(extra);
+  scheduler.release(held);
+}
+
+TEST(StateSchedulerTest, ReleasedStateBeatsPendingGrow) {
+  std::vector<int> storage(1);
+  Settings settings;
+  settings.elastic_state_pool = true;
+  settings.state_pool_max = 1;
+  StateScheduler scheduler(fake_states(&storage), settings);
+
+  int grown = 0;
+  ElasticPoolConfig pool;
+  pool.max_states = 2;
+  pool.create = [&grown]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    return reinterpret_cast<struct whisper_state*>(&grown);
+  };
+  pool.destroy = [](struct whisper_state*) {};
+  scheduler.enable_elastic(std::move(pool));
+
+  struct whisper_state* held = scheduler.acquire(RequestPriority::kUnary);
+  struct whisper_state* granted = nullptr;
+  std::thread waiter([&] {
+    granted = scheduler.acquire(RequestPriority::kUnary);
+  });
+  wait_for_depth(scheduler, 1);
+  const auto t_start = std::chrono::steady_clock::now();
+  scheduler.release(held);
+  waiter.join();
+  // Bekleyen büyümeyi beklemeden boşalan state'i alır
+  EXPECT_EQ(granted, held);
+  EXPECT_LT(std::chrono::steady_clock::now() - t_start,
+            std::chrono::milliseconds(250));
+  scheduler.release(granted);
+}
@@ -0,0 +1,137 @@
+#include "streaming_decoder.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<TokenData> tokens(const std::vector<std::string>& texts) {
+  std::vector<TokenData> out;
+  int64_t t = 0;
+  for (const auto& text : texts) {
+    out.push_back({text, 0.9f, t, t + 20});
+    t += 20;
+  }
+  return out;
+}
+
+// SttEngine yerine geçer: hızlı model yüklüyken kRealtimePartial decode'ları
+// küçük modele, diğerleri ana modele gider. Her 0.5sn ses, hangi modelde
+// çözüldüğünü ve mutlak konumunu taşıyan bir kelime olur.
+struct FakeEngine {
+  bool fast_model = false;
+  std::vector<RequestPriority> priorities;
+  std::vector<size_t> sizes;
+
+  std::vector<TranscriptionResult> transcribe(
+      const std::vector<int16_t>& pcm, const RequestOptions& options) {
+    priorities.push_back(options.priority);
+    sizes.push_back(pcm.size());
+    const bool fast =
+        fast_model && options.priority == RequestPriority::kRealtimePartial;
+    TranscriptionResult res{};
+    for (size_t i = 0; i < pcm.size() / 8000; ++i) {
+      const size_t word = options.vad_sample_offset / 8000 + i;
+      const int64_t t0 = static_cast<int64_t>(i) * 50;
+      res.tokens.push_back({(fast ? " fast" : " main") + std::to_string(word),
+                            0.9f, t0, t0 + 50});
+    }
+    return {res};
+  }
+
+  StreamingDecoder decoder(const Settings& settings) {
+    return StreamingDecoder(
+        settings, fast_model,
+        [this](const std::vector<int16_t>& pcm, const RequestOptions& options,
+               SttEngine::PerformanceMetrics*) {
+          return transcribe(pcm, options);
+        },
+        RequestOptions{});
+  }
+};
+
+const std::vector<int16_t> kOneSecond(16000, 1000);
+}  // namespace
+
+TEST(StreamingDecoderTest, NothingIsStableWithoutHistory) {
+  EXPECT_EQ(StreamingDecoder::stable_prefix({}, tokens({" hello", " world"})),
+            0u);
+  EXPECT_EQ(StreamingDecoder::stable_prefix(tokens({" hello"}), {}), 0u);
+}
+
+TEST(StreamingDecoderTest, CommitsAgreedWords) {
+  const auto prev = tokens({" hello", " world", " fo"});
+  const auto hyp = tokens({" hello", " world", " foo", " bar"});
+  EXPECT_EQ(StreamingDecoder::stable_prefix(prev, hyp), 2u);
+}
+
+TEST(StreamingDecoderTest, HoldsBackLastWordWhenAllAgree) {
+  // Son kelime sonraki seste uzayabilir ("world" -> "worldwide")
+  const auto hyp = tokens({" hello", " world"});
+  EXPECT_EQ(StreamingDecoder::stable_prefix(hyp, hyp), 1u);
+  const auto single = tokens({" hello"});
+  EXPECT_EQ(StreamingDecoder::stable_prefix(single, single), 0u);
+}
+
+TEST(StreamingDecoderTest, NeverSplitsAWord) {
+  // " hel" + "lo" tek kelime: ikinci parça değiştiyse ikisi de bekler
+  const auto prev = tokens({" good", " hel", "lo", " there"});
+  const auto hyp = tokens({" good", " hel", "p", " me"});
+  EXPECT_EQ(StreamingDecoder::stable_prefix(prev, hyp), 1u);
+
+  // Tamamı ortak ve son kelime çok token'lı: kelimenin başına kadar
+  const auto same = tokens({" good", " hel", "lo"});
+  EXPECT_EQ(StreamingDecoder::stable_prefix(same, same), 1u);
+}
+
+TEST(StreamingDecoderTest, DivergenceAtStartCommitsNothing) {
+  const auto prev = tokens({" hello", " world"});
+  const auto hyp = tokens({" yellow", " world"});
+  EXPECT_EQ(StreamingDecoder::stable_prefix(prev, hyp), 0u);
+}
+
+TEST(StreamingDecoderTest, FinalComesFromMainModelWithFastModel) {
+  const Settings settings;
+  FakeEngine engine;
+  engine.fast_model = true;
+  StreamingDecoder decoder = engine.decoder(settings);
+
+  decoder.append(kOneSecond.data(), kOneSecond.size());
+  decoder.decode_partial();
+  decoder.append(kOneSecond.data(), kOneSecond.size());
+  StreamUpdate partial = decoder.decode_partial();
+  // Partial'da kesinleşen önek hızlı modelden gelir
+  ASSERT_EQ(partial.committed_tokens.size(), 2u);
+  EXPECT_EQ(partial.committed_tokens[0].text, " fast0");
+  EXPECT_EQ(partial.text, "fast0 fast1 fast2 fast3");
+
+  StreamUpdate final_update = decoder.finalize();
+  // Final, kesinleşen önek dahil cümlenin tamamını ana modelde çözer
+  EXPECT_EQ(engine.priorities.back(), RequestPriority::kRealtimeFinal);
+  EXPECT_EQ(engine.sizes.back(), 2 * kOneSecond.size());
+  EXPECT_EQ(final_update.text, "main0 main1 main2 main3");
+  ASSERT_EQ(final_update.committed_tokens.size(), 4u);
+  for (const auto& tok : final_update.committed_tokens)
+    EXPECT_EQ(tok.text.rfind(" main", 0), 0u) << tok.text;
+  EXPECT_EQ(final_update.committed_tokens[3].t1, 200);
+  EXPECT_TRUE(decoder.empty());
+}
+
+TEST(StreamingDecoderTest, FinalDecodesOnlyTailWithoutFastModel) {
+  const Settings settings;
+  FakeEngine engine;
+  StreamingDecoder decoder = engine.decoder(settings);
+
+  decoder.append(kOneSecond.data(), kOneSecond.size());
+  decoder.decode_partial();
+  decoder.append(kOneSecond.data(), kOneSecond.size());
+  decoder.decode_partial();
+
+  StreamUpdate final_update = decoder.finalize();
+  // Tek model: kesinleşen önek yeniden çözülmez
+  EXPECT_EQ(engine.sizes.back(), kOneSecond.size());
+  EXPECT_EQ(final_update.text, "main0 main1 main2 main3");
+  ASSERT_EQ(final_update.committed_tokens.size(), 4u);
+  EXPECT_EQ(final_update.committed_tokens[3].t1, 200);
+}
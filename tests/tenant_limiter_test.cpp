@@ -0,0 +1,115 @@
+#include "tenant_limiter.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "stt_engine.h"
+
+namespace {
+Settings with_limits(const std::string& spec) {
+  Settings settings;
+  settings.tenant_limits = spec;
+  return settings;
+}
+
+// Kabul reddedilirse nedeni döner; kabul edilirse boş
+std::string rejection(TenantLimiter& limiter, const std::string& tenant,
+                      double audio_seconds) {
+  try {
+    limiter.admit(tenant, audio_seconds);
+  } catch (const TenantQuotaException& e) {
+    return e.reason();
+  }
+  return "";
+}
+}  // namespace
+
+TEST(TenantLimiterTest, ParsesFieldsAndDefaults) {
+  auto quotas = parse_tenant_limits(
+      " acme = 2, 5, 20, 3 ; beta=1;*=0,1; bad=x,1; noeq; zero=0,0,0,0");
+
+  ASSERT_EQ(quotas.count("acme"), 1u);
+  EXPECT_EQ(quotas["acme"].max_concurrent, 2);
+  EXPECT_DOUBLE_EQ(quotas["acme"].rate, 5.0);
+  EXPECT_DOUBLE_EQ(quotas["acme"].burst, 20.0);
+  EXPECT_DOUBLE_EQ(quotas["acme"].weight, 3.0);
+
+  EXPECT_EQ(quotas["beta"].max_concurrent, 1);
+  EXPECT_DOUBLE_EQ(quotas["beta"].rate, 0.0);
+  // burst verilmezse 10 saniyelik hız
+  EXPECT_DOUBLE_EQ(quotas["*"].burst, 10.0);
+  // Geçersiz ağırlık 1'e döner; bozuk girdiler atlanır
+  EXPECT_DOUBLE_EQ(quotas["zero"].weight, 1.0);
+  EXPECT_EQ(quotas.count("bad"), 0u);
+  EXPECT_EQ(quotas.count("noeq"), 0u);
+}
+
+TEST(TenantLimiterTest, DisabledWithoutRules) {
+  TenantLimiter limiter(with_limits(""));
+  EXPECT_FALSE(limiter.enabled());
+  EXPECT_EQ(rejection(limiter, "any", 1e6), "");
+  EXPECT_DOUBLE_EQ(limiter.weight("any"), 1.0);
+}
+
+TEST(TenantLimiterTest, LeaseBoundsConcurrency) {
+  TenantLimiter limiter(with_limits("acme=1"));
+  {
+    TenantLimiter::Lease lease = limiter.admit("acme", 1.0);
+    EXPECT_EQ(rejection(limiter, "acme", 1.0), "concurrency");
+    // Taşınan lease payı bir kez iade eder
+    TenantLimiter::Lease moved = std::move(lease);
+    EXPECT_EQ(rejection(limiter, "acme", 1.0), "concurrency");
+  }
+  EXPECT_EQ(rejection(limiter, "acme", 1.0), "");
+}
+
+TEST(TenantLimiterTest, LongRequestLeavesDebt) {
+  TenantLimiter limiter(with_limits("acme=0,1,2"));
+  // Kova 2 saniyelik ama uzun dosya kabul edilir ve borç bırakır
+  EXPECT_EQ(rejection(limiter, "acme", 10.0), "");
+  try {
+    limiter.admit("acme", 1.0);
+    FAIL() << "expected rate rejection";
+  } catch (const TenantQuotaException& e) {
+    EXPECT_EQ(e.reason(), "rate");
+    EXPECT_GT(e.retry_after_s(), 7.0);
+  }
+}
+
+TEST(TenantLimiterTest, StreamChargeDrainsBucket) {
+  TenantLimiter limiter(with_limits("acme=0,1,2"));
+  limiter.charge("acme", 5.0);
+  EXPECT_EQ(rejection(limiter, "acme", 0.1), "rate");
+}
+
+TEST(TenantLimiterTest, UnconfiguredTenantsGetOwnDefaultQuota) {
+  TenantLimiter limiter(with_limits("acme=1,0,0,4;*=1,0,0,2"));
+  TenantLimiter::Lease lease = limiter.admit("client-a", 1.0);
+  // "*" her tenant'a ayrı uygulanır: client-a diğerlerini engellemez
+  EXPECT_EQ(rejection(limiter, "client-a", 1.0), "concurrency");
+  EXPECT_EQ(rejection(limiter, "client-b", 1.0), "");
+  EXPECT_EQ(rejection(limiter, "acme", 1.0), "");
+  EXPECT_DOUBLE_EQ(limiter.weight("acme"), 4.0);
+  EXPECT_DOUBLE_EQ(limiter.weight("client-b"), 2.0);
+}
+
+TEST(TenantLimiterTest, NoisyTenantKeepsItsDebtAlone) {
+  TenantLimiter limiter(with_limits("*=0,1,2"));
+  limiter.charge("noisy", 5.0);
+  EXPECT_EQ(rejection(limiter, "noisy", 0.1), "rate");
+  EXPECT_EQ(rejection(limiter, "quiet", 0.1), "");
+}
+
+TEST(TenantLimiterTest, EvictsLeastRecentIdleTenant) {
+  Settings settings = with_limits("*=1");
+  settings.tenant_max_tracked = 2;
+  TenantLimiter limiter(settings);
+
+  TenantLimiter::Lease busy = limiter.admit("busy", 1.0);
+  EXPECT_EQ(rejection(limiter, "idle", 1.0), "");
+  EXPECT_EQ(rejection(limiter, "new", 1.0), "");
+  EXPECT_EQ(limiter.tracked(), 2u);
+  // Açık isteği olan tenant atılmaz; payı hala sayılır
+  EXPECT_EQ(rejection(limiter, "busy", 1.0), "concurrency");
+}